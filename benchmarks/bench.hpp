@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2016 Shanghai Jiao Tong University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://ipads.se.sjtu.edu.cn/projects/wukong
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <regex>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+
+// utils
+#include "timer.hpp"
+
+using namespace std;
+
+// the commit generated on every build (see benchmarks/git_commit.cmake)
+#ifdef HAS_GIT_COMMIT_H
+#include "git_commit.h"
+#endif
+
+#ifndef WUKONG_GIT_COMMIT
+#define WUKONG_GIT_COMMIT "unknown"
+#endif
+
+/**
+ * The state of a benchmark on a thread, in the style of Google Benchmark, e.g.,
+ *
+ *   void bench_foo(BenchState &state) {
+ *       ... // setup (not timed)
+ *       while (state.next())
+ *           foo();
+ *   }
+ *
+ * Only the loop is timed, and all threads start the loop after everyone has
+ * arrived (i.e., finished its setup).
+ */
+class BenchState {
+private:
+    uint64_t max_iters;
+    uint64_t iters = 0;
+    atomic<int> *arrived;   // the start barrier shared by all threads
+
+public:
+    int thread_id;
+    int threads;
+
+    uint64_t items = 0;     // items processed per iteration (0 means 1)
+    uint64_t start_ns = 0;
+    uint64_t end_ns = 0;
+
+    BenchState(int thread_id, int threads, uint64_t max_iters, atomic<int> *arrived)
+        : max_iters(max_iters), arrived(arrived), thread_id(thread_id), threads(threads) { }
+
+    inline bool next() {
+        if (iters < max_iters) {
+            if (iters++ == 0) {
+                arrived->fetch_add(1);
+                while (arrived->load() < threads)
+                    this_thread::yield();  // wait for others
+                start_ns = timer::get_nsec();
+            }
+            return true;
+        }
+        end_ns = timer::get_nsec();
+        return false;
+    }
+
+    uint64_t iterations() const { return max_iters; }
+
+    void set_items_per_iteration(uint64_t n) { items = n; }
+};
+
+// prevent the compiler from optimizing away the result
+template <typename T>
+inline void do_not_optimize(T const &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * A minimal runner of microbenchmarks.
+ *
+ * Each benchmark runs with each given number of threads. The iterations are
+ * calibrated until a run takes at least min_time, and the run is repeated to
+ * report the median, so that the results are comparable across commits.
+ */
+class BenchRunner {
+private:
+    struct bench_t {
+        string name;
+        function<void(BenchState &)> fn;
+        vector<int> threads;
+    };
+
+    struct result_t {
+        string name;
+        int threads;
+        uint64_t iters;
+        double ns_per_op;     // per thread
+        double items_per_sec; // all threads
+    };
+
+    vector<bench_t> benchs;
+    vector<result_t> results;
+
+    result_t run_once(const bench_t &b, int nthreads, uint64_t iters) {
+        atomic<int> arrived(0);
+        vector<BenchState> states;
+        for (int t = 0; t < nthreads; t++)
+            states.push_back(BenchState(t, nthreads, iters, &arrived));
+
+        // start all threads at the same time (setup excluded, see BenchState::next)
+        vector<thread> ths;
+        for (int t = 1; t < nthreads; t++)
+            ths.push_back(thread(b.fn, ref(states[t])));
+        b.fn(states[0]);
+        for (auto &th : ths) th.join();
+
+        uint64_t start = UINT64_MAX, end = 0, sum_ns = 0, items = 0;
+        for (auto const &s : states) {
+            start = min(start, s.start_ns);
+            end = max(end, s.end_ns);
+            sum_ns += s.end_ns - s.start_ns;
+            items += iters * (s.items ? s.items : 1);
+        }
+
+        result_t r;
+        r.name = b.name;
+        r.threads = nthreads;
+        r.iters = iters;
+        r.ns_per_op = (double)sum_ns / nthreads / iters;
+        r.items_per_sec = items * 1e9 / max(end - start, (uint64_t)1);
+        return r;
+    }
+
+    void print(const result_t &r) {
+        char buf[256];
+        snprintf(buf, sizeof(buf), "%-48s %12lu %14.1f %16.0f",
+                 (r.name + "/threads:" + to_string(r.threads)).c_str(),
+                 r.iters, r.ns_per_op, r.items_per_sec);
+        cout << buf << endl;
+    }
+
+public:
+    double min_time = 0.5;  // sec
+    int repetitions = 3;
+    int max_threads = thread::hardware_concurrency();
+
+    // @threads: run with each number of threads (not larger than max_threads)
+    void add(string name, function<void(BenchState &)> fn, vector<int> threads = {1}) {
+        benchs.push_back({name, fn, threads});
+    }
+
+    void run(string filter = "") {
+        regex re(filter.empty() ? ".*" : filter);
+        char buf[256];
+        snprintf(buf, sizeof(buf), "%-48s %12s %14s %16s",
+                 "benchmark", "iterations", "ns/op", "items/sec");
+        cout << buf << endl;
+
+        for (auto const &b : benchs) {
+            if (!regex_search(b.name, re)) continue;
+
+            for (int nthreads : b.threads) {
+                if (nthreads > max_threads) continue;
+
+                // calibrate the number of iterations
+                uint64_t iters = 1;
+                while (true) {
+                    result_t r = run_once(b, nthreads, iters);
+                    double sec = r.ns_per_op * iters / 1e9;
+                    if (sec >= min_time || iters >= 1000000000ull) break;
+
+                    double scale = (sec > 0) ? min_time * 1.4 / sec : 10;
+                    iters = max(iters + 1, (uint64_t)(iters * min(max(scale, 2.0), 10.0)));
+                }
+
+                // report the median of repetitions
+                vector<result_t> reps;
+                for (int i = 0; i < repetitions; i++)
+                    reps.push_back(run_once(b, nthreads, iters));
+                sort(reps.begin(), reps.end(), [](const result_t &x, const result_t &y) {
+                    return x.ns_per_op < y.ns_per_op;
+                });
+                results.push_back(reps[reps.size() / 2]);
+                print(results.back());
+            }
+        }
+    }
+
+    // dump the results to CSV (or JSON if fname ends with .json) w/ the commit
+    void dump(string fname) {
+        ofstream ofs(fname.c_str());
+        if (!ofs.good()) {
+            logstream(LOG_ERROR) << "Can't open/create output file: " << fname << LOG_endl;
+            return;
+        }
+
+        bool json = fname.size() >= 5 && fname.compare(fname.size() - 5, 5, ".json") == 0;
+        if (json) {
+            ofs << "{\"commit\": \"" << WUKONG_GIT_COMMIT << "\", \"benchmarks\": [";
+            for (size_t i = 0; i < results.size(); i++) {
+                const result_t &r = results[i];
+                ofs << (i ? "," : "") << "\n  {\"name\": \"" << r.name << "\""
+                    << ", \"threads\": " << r.threads
+                    << ", \"iterations\": " << r.iters
+                    << ", \"ns_per_op\": " << r.ns_per_op
+                    << ", \"items_per_sec\": " << r.items_per_sec << "}";
+            }
+            ofs << "\n]}\n";
+        } else {
+            ofs << "commit,name,threads,iterations,ns_per_op,items_per_sec\n";
+            for (auto const &r : results)
+                ofs << WUKONG_GIT_COMMIT << "," << r.name << "," << r.threads << ","
+                    << r.iters << "," << r.ns_per_op << "," << r.items_per_sec << "\n";
+        }
+        logstream(LOG_INFO) << results.size() << " results are stored in " << fname << LOG_endl;
+    }
+};
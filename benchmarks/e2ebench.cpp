@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2016 Shanghai Jiao Tong University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://ipads.se.sjtu.edu.cn/projects/wukong
+ *
+ */
+
+#include <unistd.h>
+#include <pthread.h>
+#include <regex>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+
+#include "global.hpp"
+#include "mem.hpp"
+#include "string_server.hpp"
+#include "dgraph.hpp"
+#include "stats.hpp"
+#include "proxy.hpp"
+#include "metrics.hpp"
+#include "engine/engine.hpp"
+#include "comm/adaptor.hpp"
+
+#include "bench.hpp"
+#include "lubm.hpp"
+
+// utils
+#include "histogram.hpp"
+#include "timer.hpp"
+
+using namespace std;
+
+/**
+ * An end-to-end benchmark of SPARQL queries in a single process w/o MPI.
+ *
+ * It builds the RDF graph of a single server from LUBM-like data in memory,
+ * launches the engines which pass (sub-)queries through the local queues of
+ * Adaptor (w/o TCP and RDMA), and runs a fixed suite of queries (LUBM Q1-Q7)
+ * through Parser, Planner and a proxy to report per-query latency and
+ * throughput. So regressions of the query engine can be caught on any machine.
+ *
+ * W/ DYNAMIC_GSTORE, a part of the data can be inserted after the statistics are
+ * generated (-l), and the suite runs w/ the stale statistics, the statistics
+ * updated incrementally (Stats::update_stat) and the ones generated again
+ * from scratch, which measures the plan quality after a large dynamic load.
+ */
+
+// a single server, so that no metadata is exchanged (see GStore::sync_metadata)
+TCP_Adaptor *con_adaptor = NULL;
+
+static const string PREFIX =
+    "PREFIX rdf: <http://www.w3.org/1999/02/22-rdf-syntax-ns#>\n"
+    "PREFIX ub: <http://swat.cse.lehigh.edu/onto/univ-bench.owl#>\n";
+
+// the same as scripts/sparql_query/lubm/basic/lubm_q{1-7}
+static const vector<pair<string, string>> lubm_suite = {
+    {
+        "lubm_q1",
+        "SELECT ?X ?Y ?Z WHERE {\n"
+        "  ?Y rdf:type ub:University .\n"
+        "  ?X ub:undergraduateDegreeFrom ?Y .\n"
+        "  ?X rdf:type ub:GraduateStudent .\n"
+        "  ?X ub:memberOf ?Z .\n"
+        "  ?Z ub:subOrganizationOf ?Y .\n"
+        "  ?Z rdf:type ub:Department .\n"
+        "}"
+    },
+    {
+        "lubm_q2",
+        "SELECT ?X ?Y WHERE {\n"
+        "  ?X rdf:type ub:Course .\n"
+        "  ?X ub:name ?Y .\n"
+        "}"
+    },
+    {
+        "lubm_q3",
+        "SELECT ?X ?Y ?Z WHERE {\n"
+        "  ?X ub:undergraduateDegreeFrom ?Y .\n"
+        "  ?X rdf:type ub:UndergraduateStudent .\n"
+        "  ?X ub:memberOf ?Z .\n"
+        "  ?Z rdf:type ub:Department .\n"
+        "  ?Z ub:subOrganizationOf ?Y .\n"
+        "  ?Y rdf:type ub:University .\n"
+        "}"
+    },
+    {
+        "lubm_q4",
+        "SELECT ?X ?Y1 ?Y2 ?Y3 WHERE {\n"
+        "  ?X ub:worksFor <http://www.Department0.University0.edu> .\n"
+        "  ?X rdf:type ub:FullProfessor .\n"
+        "  ?X ub:name ?Y1 .\n"
+        "  ?X ub:emailAddress ?Y2 .\n"
+        "  ?X ub:telephone ?Y3 .\n"
+        "}"
+    },
+    {
+        "lubm_q5",
+        "SELECT ?X WHERE {\n"
+        "  ?X ub:subOrganizationOf <http://www.Department0.University0.edu> .\n"
+        "  ?X rdf:type ub:ResearchGroup .\n"
+        "}"
+    },
+    {
+        "lubm_q6",
+        "SELECT ?X ?Y WHERE {\n"
+        "  ?Y ub:subOrganizationOf <http://www.University0.edu> .\n"
+        "  ?Y rdf:type ub:Department .\n"
+        "  ?X ub:worksFor ?Y .\n"
+        "  ?X rdf:type ub:FullProfessor .\n"
+        "}"
+    },
+    {
+        "lubm_q7",
+        "SELECT ?X ?Y ?Z WHERE {\n"
+        "  ?Y rdf:type ub:FullProfessor .\n"
+        "  ?X ub:advisor ?Y .\n"
+        "  ?X rdf:type ub:UndergraduateStudent .\n"
+        "  ?X ub:takesCourse ?Z .\n"
+        "  ?Z rdf:type ub:Course .\n"
+        "  ?Y ub:teacherOf ?Z .\n"
+        "}"
+    },
+};
+
+struct result_t {
+    string name;
+    uint64_t rows;
+    Histogram lat;  // usec
+    double qps;
+};
+
+static void *engine_thread(void *arg)
+{
+    Engine *engine = (Engine *)arg;
+    engine->run();
+    return NULL;
+}
+
+// run a query one by one (i.e., latency) and then w/ @nflights in flight for @dur seconds
+// (i.e., throughput), return false if the query fails
+static bool run_query(Proxy *proxy, SPARQLQuery &request, int nruns, int nflights,
+                      double dur, result_t &res)
+{
+    auto send = [&]() {
+        SPARQLQuery r = request;
+        proxy->setpid(r);
+        proxy->send_request(r);
+    };
+
+    for (int i = 0; i < nruns; i++) {
+        uint64_t start = timer::get_usec();
+        send();
+        SPARQLQuery reply = proxy->recv_reply();
+        res.lat.record(timer::get_usec() - start);
+
+        if (reply.result.status_code != SUCCESS) {
+            logstream(LOG_ERROR) << res.name << " failed [ERRNO " << reply.result.status_code
+                                 << "]: " << ERR_MSG(reply.result.status_code) << LOG_endl;
+            return false;
+        }
+        res.rows = reply.result.row_num;
+    }
+
+    // closed-loop, keep @nflights queries in flight
+    res.qps = 0;
+    if (dur <= 0) return true;
+
+    uint64_t nsent = 0, ndone = 0;
+    for (; nsent < nflights; nsent++) send();
+
+    uint64_t start = timer::get_usec();
+    uint64_t end = start + dur * 1000000;
+    while (timer::get_usec() < end) {
+        proxy->recv_reply();
+        ndone++;
+        send();
+        nsent++;
+    }
+    res.qps = ndone * 1000000.0 / (timer::get_usec() - start);
+
+    // drain the queries in flight
+    for (; ndone < nsent; ndone++) proxy->recv_reply();
+    return true;
+}
+
+static void print(const result_t &r)
+{
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%-20s %10lu %10lu %10lu %10lu %12.1f",
+             r.name.c_str(), r.rows, r.lat.percentile(0.5), r.lat.percentile(0.99),
+             (uint64_t)r.lat.mean(), r.qps);
+    cout << buf << endl;
+}
+
+// dump the results to CSV (or JSON if fname ends with .json) w/ the commit
+static void dump(string fname, const vector<result_t> &results)
+{
+    ofstream ofs(fname.c_str());
+    if (!ofs.good()) {
+        logstream(LOG_ERROR) << "Can't open/create output file: " << fname << LOG_endl;
+        return;
+    }
+
+    bool json = fname.size() >= 5 && fname.compare(fname.size() - 5, 5, ".json") == 0;
+    if (json) {
+        ofs << "{\"commit\": \"" << WUKONG_GIT_COMMIT << "\", \"queries\": [";
+        for (size_t i = 0; i < results.size(); i++) {
+            const result_t &r = results[i];
+            ofs << (i ? "," : "") << "\n  {\"name\": \"" << r.name << "\""
+                << ", \"rows\": " << r.rows
+                << ", \"p50_usec\": " << r.lat.percentile(0.5)
+                << ", \"p99_usec\": " << r.lat.percentile(0.99)
+                << ", \"mean_usec\": " << r.lat.mean()
+                << ", \"qps\": " << r.qps << "}";
+        }
+        ofs << "\n]}\n";
+    } else {
+        ofs << "commit,name,rows,p50_usec,p99_usec,mean_usec,qps\n";
+        for (auto const &r : results)
+            ofs << WUKONG_GIT_COMMIT << "," << r.name << "," << r.rows << ","
+                << r.lat.percentile(0.5) << "," << r.lat.percentile(0.99) << ","
+                << r.lat.mean() << "," << r.qps << "\n";
+    }
+    logstream(LOG_INFO) << results.size() << " results are stored in " << fname << LOG_endl;
+}
+
+// run the queries matching @re, the results are named by the query and @tag
+static void run_suite(Proxy *proxy, const regex &re, string tag, int nruns, int nflights,
+                      double dur, int mt_factor, vector<result_t> &results)
+{
+    for (auto const &q : lubm_suite) {
+        if (!regex_search(q.first, re)) continue;
+
+        result_t res;
+        res.name = q.first + tag;
+        res.rows = 0;
+        res.qps = 0;
+
+        SPARQLQuery request;
+        istringstream is(PREFIX + q.second);
+        if (!proxy->parser.parse(is, request)) {
+            logstream(LOG_ERROR) << q.first << ": parsing failed" << LOG_endl;
+            continue;
+        }
+
+        // a contradictory query (e.g., empty result) is not executed
+        if (proxy->planner.generate_plan(request)) {
+            request.mt_factor = min(mt_factor, Global::mt_threshold);
+            request.dev_type = SPARQLQuery::DeviceType::CPU;
+            request.result.blind = true;
+            if (!run_query(proxy, request, nruns, nflights, dur, res))
+                continue;
+        }
+
+        print(res);
+        results.push_back(res);
+    }
+}
+
+static void usage(char *fn)
+{
+    cout << "usage: " << fn << " [options]" << endl;
+    cout << "options:" << endl;
+    cout << "  -u num    : the number of LUBM-like universities (default: 1)" << endl;
+    cout << "  -e num    : the number of engines (default: 4)" << endl;
+    cout << "  -f regex  : only run the queries matching <regex>" << endl;
+    cout << "  -n num    : run each query <num> times one by one for latency (default: 100)" << endl;
+    cout << "  -d sec    : run each query for <sec> seconds for throughput (default: 1, 0 means skip)" << endl;
+    cout << "  -p num    : keep <num> queries in flight for throughput (default: #engines)" << endl;
+    cout << "  -m factor : the multi-threading factor of queries (default: 1)" << endl;
+    cout << "  -g gb     : the size (GB) of in-memory store (default: 1)" << endl;
+    cout << "  -l pct    : insert the last <pct>% of triples after generating statistics (DYNAMIC_GSTORE)" << endl;
+    cout << "  -b size   : the max number of selectivities fed back to planner (default: 4096, 0 means disabled)" << endl;
+    cout << "  -r        : run the suite again w/ the plans corrected by the feedback of the first run" << endl;
+    cout << "  -o fname  : output results into <fname> (CSV, or JSON if ends with .json)" << endl;
+}
+
+int
+main(int argc, char *argv[])
+{
+    string filter, fname;
+    int univs = 1, nengines = 4, nruns = 100, nflights = 0, mt_factor = 1, mem_gb = 1;
+    double dur = 1.0;
+    int dyn_pct = 0;
+    bool rerun = false;
+
+    int c;
+    while ((c = getopt(argc, argv, "u:e:f:n:d:p:m:g:l:b:ro:h")) != -1) {
+        switch (c) {
+        case 'u': univs = atoi(optarg); break;
+        case 'e': nengines = atoi(optarg); break;
+        case 'f': filter = optarg; break;
+        case 'n': nruns = atoi(optarg); break;
+        case 'd': dur = atof(optarg); break;
+        case 'p': nflights = atoi(optarg); break;
+        case 'm': mt_factor = atoi(optarg); break;
+        case 'g': mem_gb = atoi(optarg); break;
+        case 'l': dyn_pct = atoi(optarg); break;
+        case 'b': Global::plan_feedback_size = atoi(optarg); break;
+        case 'r': rerun = true; break;
+        case 'o': fname = optarg; break;
+        default:
+            usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (nflights <= 0) nflights = nengines;
+    ASSERT(univs > 0 && nengines > 0 && nruns > 0 && mt_factor > 0 && mem_gb > 0);
+    ASSERT(dyn_pct >= 0 && dyn_pct < 100);
+    ASSERT(Global::plan_feedback_size >= 0);
+#ifndef DYNAMIC_GSTORE
+    if (dyn_pct > 0) {
+        logstream(LOG_ERROR) << "Can't insert data into static graph store." << LOG_endl;
+        exit(EXIT_FAILURE);
+    }
+#endif
+
+    // a single server w/ one proxy (this thread) and engines, w/o RDMA and TCP
+    Global::num_servers = 1;
+    Global::num_proxies = 1;
+    Global::num_engines = nengines;
+    Global::num_threads = 1 + nengines;
+    Global::use_rdma = false;
+    Global::rdma_buf_size_mb = Global::rdma_rbf_size_mb = 0;
+    Global::enable_local_shortcut = true;
+    Global::enable_planner = true;
+    Global::silent = true;
+    Global::memstore_size_gb = mem_gb;
+
+    // generate the data and the ID mapping
+    uint64_t start = timer::get_usec();
+    LUBMGen lubm(univs);
+    StringServer str_server;
+    for (sid_t id = 0; id < lubm.index_str.size(); id++)
+        str_server.add(lubm.index_str[id], id);
+    for (sid_t i = 0; i < lubm.normal_str.size(); i++)
+        str_server.add(lubm.normal_str[i], (1 << NBITS_IDX) + i);
+    str_server.next_index_id = lubm.index_str.size();
+    str_server.next_normal_id = (1 << NBITS_IDX) + lubm.normal_str.size();
+    logstream(LOG_INFO) << "generate " << lubm.triples.size() << " triples of " << univs
+                        << " universities in " << (timer::get_usec() - start) / 1000
+                        << " ms (commit: " << WUKONG_GIT_COMMIT << ")" << LOG_endl;
+
+    // the triples inserted after generating statistics
+    size_t nstatic = lubm.triples.size() * (100 - dyn_pct) / 100;
+    vector<triple_t> dyn_triples(lubm.triples.begin() + nstatic, lubm.triples.end());
+    lubm.triples.resize(nstatic);
+
+    // build the RDF graph and the statistics for planner
+    Mem *mem = new Mem(Global::num_servers, Global::num_threads);
+    vector<vector<triple_t>> triple_pso, triple_pos;
+    vector<vector<triple_attr_t>> triple_sav(Global::num_engines);
+    lubm.split(Global::num_engines, triple_pso, triple_pos);
+    DGraph dgraph(0, mem, &str_server, lubm.num_preds(), triple_pso, triple_pos, triple_sav);
+
+    Stats stats(0);
+    stats.generate_statistics(dgraph.gstore);
+    stats.gather_stat(NULL);
+
+    // create the proxy and engines, which only use the local queues of adaptor
+    Proxy *proxy = new Proxy(0, 0, &str_server, &dgraph, new Adaptor(0, 0, NULL, NULL), &stats);
+    pthread_t *threads = new pthread_t[Global::num_engines];
+    for (int tid = Global::num_proxies; tid < Global::num_threads; tid++)
+        engines.push_back(new Engine(0, tid, &str_server, &dgraph, new Adaptor(0, tid, NULL, NULL)));
+    for (int i = 0; i < Global::num_engines; i++)
+        pthread_create(&threads[i], NULL, engine_thread, (void *)engines[i]);
+
+    logstream(LOG_INFO) << "run queries w/ " << nengines << " engines (latency: " << nruns
+                        << " runs, throughput: " << dur << " sec w/ " << nflights
+                        << " in flight)" << LOG_endl;
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%-20s %10s %10s %10s %10s %12s",
+             "query", "rows", "p50(us)", "p99(us)", "mean(us)", "qps");
+    cout << buf << endl;
+
+    regex re(filter.empty() ? ".*" : filter);
+    vector<result_t> results;
+    if (dyn_triples.empty()) {
+        run_suite(proxy, re, "", nruns, nflights, dur, mt_factor, results);
+        if (rerun)
+            run_suite(proxy, re, "/feedback", nruns, nflights, dur, mt_factor, results);
+    } else {
+#ifdef DYNAMIC_GSTORE
+        // insert the triples like DynamicLoader (all vertices are local)
+        DynamicGStore *gstore = static_cast<DynamicGStore *>(dgraph.gstore);
+        start = timer::get_usec();
+        for (auto const &t : dyn_triples) {
+            gstore->insert_triple_out(t, true, 0);
+            gstore->insert_triple_in(t, true, 0);
+        }
+        logstream(LOG_INFO) << "insert " << dyn_triples.size() << " triples in "
+                            << (timer::get_usec() - start) / 1000 << " ms" << LOG_endl;
+        run_suite(proxy, re, "/stale", nruns, nflights, dur, mt_factor, results);
+
+        stats.update_stat(gstore, 0, NULL);
+        run_suite(proxy, re, "/incremental", nruns, nflights, dur, mt_factor, results);
+
+        // the statistics generated from scratch as the baseline
+        start = timer::get_usec();
+        Stats *full = new Stats(0);
+        full->generate_statistics(dgraph.gstore);
+        full->gather_stat(NULL);
+        logstream(LOG_INFO) << "generate statistics in " << (timer::get_usec() - start) / 1000
+                            << " ms" << LOG_endl;
+        proxy = new Proxy(0, 0, &str_server, &dgraph, new Adaptor(0, 0, NULL, NULL), full);
+        run_suite(proxy, re, "/rescan", nruns, nflights, dur, mt_factor, results);
+#endif
+    }
+
+    proxy->planner.print_plan_cache();
+    if (!fname.empty())
+        dump(fname, results);
+
+    // engines never exit
+    exit(EXIT_SUCCESS);
+}
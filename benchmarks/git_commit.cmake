@@ -0,0 +1,22 @@
+## Generate the header of the current commit for benchmarks (see CMakeLists.txt)
+## usage: cmake -DROOT=<repo> -DOUTPUT=<header> -P git_commit.cmake
+##
+## It runs on every build, so the results are tagged with the commit actually built
+## (w/ "-dirty" for uncommitted changes), and only rewrites the header if changed.
+
+execute_process(COMMAND git describe --always --dirty
+                WORKING_DIRECTORY ${ROOT}
+                OUTPUT_VARIABLE GIT_COMMIT
+                OUTPUT_STRIP_TRAILING_WHITESPACE)
+if("${GIT_COMMIT}" STREQUAL "")
+  set(GIT_COMMIT "unknown")
+endif()
+
+set(CONTENT "#define WUKONG_GIT_COMMIT \"${GIT_COMMIT}\"\n")
+set(OLD "")
+if(EXISTS ${OUTPUT})
+  file(READ ${OUTPUT} OLD)
+endif()
+if(NOT "${CONTENT}" STREQUAL "${OLD}")
+  file(WRITE ${OUTPUT} "${CONTENT}")
+endif()
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2016 Shanghai Jiao Tong University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://ipads.se.sjtu.edu.cn/projects/wukong
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <unordered_map>
+
+#include "type.hpp"
+#include "store/vertex.hpp"
+
+using namespace std;
+
+/**
+ * A deterministic (by seed) in-memory generator of LUBM-like data for benchmarks.
+ *
+ * It follows the schema and the IRIs of LUBM (e.g., universities, departments,
+ * professors, students and courses), so that the LUBM queries in
+ * scripts/sparql_query/lubm/basic can run on the generated data. The sizes are
+ * drawn from the ranges of LUBM (e.g., 15-25 departments per university), and
+ * each university is generated from its own seed.
+ */
+class LUBMGen {
+private:
+    static const string UB;   // the prefix of the ontology
+    static const string RDF;
+
+    mt19937_64 rng;
+    unordered_map<string, sid_t> str2id;  // normal vertices
+
+    // predicates and types (index vertices)
+    sid_t p_sub_org, p_works_for, p_member_of, p_takes_course, p_teacher_of,
+          p_advisor, p_ug_degree, p_doc_degree, p_name, p_email, p_telephone;
+    sid_t t_univ, t_dept, t_group, t_full, t_assoc, t_assist,
+          t_course, t_gcourse, t_ugstudent, t_gstudent;
+
+    sid_t index(const string &str) {
+        index_str.push_back(str);
+        return index_str.size() - 1;
+    }
+
+    sid_t normal(const string &str) {
+        auto it = str2id.find(str);
+        if (it != str2id.end()) return it->second;
+
+        sid_t id = (1 << NBITS_IDX) + normal_str.size();
+        normal_str.push_back(str);
+        str2id[str] = id;
+        return id;
+    }
+
+    sid_t literal(const string &str) { return normal("\"" + str + "\""); }
+
+    int rand_in(int lo, int hi) { return lo + (int)(rng() % (hi - lo + 1)); }
+
+    void add(sid_t s, sid_t p, sid_t o) { triples.push_back(triple_t(s, p, o)); }
+
+    // <x, name, "x">, <x, emailAddress, "x@dept">, <x, telephone, "xxx-xxx-xxxx">
+    void add_person(sid_t x, const string &local, const string &dept) {
+        add(x, p_name, literal(local));
+        add(x, p_email, literal(local + "@" + dept));
+        add(x, p_telephone, literal("xxx-xxx-xxxx"));
+    }
+
+    // pick k distinct elements of v
+    vector<sid_t> pick(const vector<sid_t> &v, int k) {
+        vector<sid_t> r;
+        k = min(k, (int)v.size());
+        while ((int)r.size() < k) {
+            sid_t x = v[rng() % v.size()];
+            if (find(r.begin(), r.end(), x) == r.end()) r.push_back(x);
+        }
+        return r;
+    }
+
+    void gen_department(int u, int d, int univs) {
+        string dept = "Department" + to_string(d) + ".University" + to_string(u) + ".edu";
+        string base = "<http://www." + dept + "/";
+        sid_t univ = normal("<http://www.University" + to_string(u) + ".edu>");
+        sid_t x = normal("<http://www." + dept + ">");
+        add(x, TYPE_ID, t_dept);
+        add(x, p_sub_org, univ);
+        add(x, p_name, literal("Department" + to_string(d)));
+
+        auto rand_univ = [&]() {
+            return normal("<http://www.University" + to_string(rng() % univs) + ".edu>");
+        };
+
+        int ngroups = rand_in(10, 20);
+        for (int i = 0; i < ngroups; i++) {
+            sid_t g = normal(base + "ResearchGroup" + to_string(i) + ">");
+            add(g, TYPE_ID, t_group);
+            add(g, p_sub_org, x);
+        }
+
+        // faculty teach courses (1-2) and graduate courses (1-2)
+        vector<sid_t> faculty, courses, gcourses;
+        const char *ranks[] = { "FullProfessor", "AssociateProfessor", "AssistantProfessor" };
+        sid_t rank_types[] = { t_full, t_assoc, t_assist };
+        int nranks[] = { rand_in(7, 10), rand_in(10, 14), rand_in(8, 11) };
+        for (int r = 0; r < 3; r++) {
+            for (int i = 0; i < nranks[r]; i++) {
+                string local = ranks[r] + to_string(i);
+                sid_t f = normal(base + local + ">");
+                faculty.push_back(f);
+                add(f, TYPE_ID, rank_types[r]);
+                add(f, p_works_for, x);
+                add_person(f, local, dept);
+                add(f, p_ug_degree, rand_univ());
+                add(f, p_doc_degree, rand_univ());
+
+                for (int c = rand_in(1, 2); c > 0; c--) {
+                    string name = "Course" + to_string(courses.size());
+                    sid_t cs = normal(base + name + ">");
+                    add(cs, TYPE_ID, t_course);
+                    add(cs, p_name, literal(name));
+                    add(f, p_teacher_of, cs);
+                    courses.push_back(cs);
+                }
+                for (int c = rand_in(1, 2); c > 0; c--) {
+                    string name = "GraduateCourse" + to_string(gcourses.size());
+                    sid_t cs = normal(base + name + ">");
+                    add(cs, TYPE_ID, t_gcourse);
+                    add(cs, p_name, literal(name));
+                    add(f, p_teacher_of, cs);
+                    gcourses.push_back(cs);
+                }
+            }
+        }
+
+        // undergraduate students (8-14 per faculty), 1/5 of them have an advisor
+        int nug = faculty.size() * rand_in(8, 14);
+        for (int i = 0; i < nug; i++) {
+            string local = "UndergraduateStudent" + to_string(i);
+            sid_t s = normal(base + local + ">");
+            add(s, TYPE_ID, t_ugstudent);
+            add(s, p_member_of, x);
+            add_person(s, local, dept);
+            for (auto c : pick(courses, rand_in(2, 4)))
+                add(s, p_takes_course, c);
+            if (rng() % 5 == 0)
+                add(s, p_advisor, faculty[rng() % faculty.size()]);
+        }
+
+        // graduate students (3-4 per faculty)
+        int ngs = faculty.size() * rand_in(3, 4);
+        for (int i = 0; i < ngs; i++) {
+            string local = "GraduateStudent" + to_string(i);
+            sid_t s = normal(base + local + ">");
+            add(s, TYPE_ID, t_gstudent);
+            add(s, p_member_of, x);
+            add_person(s, local, dept);
+            for (auto c : pick(gcourses, rand_in(1, 3)))
+                add(s, p_takes_course, c);
+            add(s, p_advisor, faculty[rng() % faculty.size()]);
+            add(s, p_ug_degree, rand_univ());
+        }
+    }
+
+public:
+    vector<string> index_str;   // IRIs of index vertices (ID = index)
+    vector<string> normal_str;  // IRIs and literals of normal vertices (ID = 2^NBITS_IDX + index)
+    vector<triple_t> triples;
+
+    LUBMGen(int univs, uint64_t seed = 0) {
+        index("__PREDICATE__");  // PREDICATE_ID
+        index(RDF + "type>");    // TYPE_ID
+
+        p_sub_org = index(UB + "subOrganizationOf>");
+        p_works_for = index(UB + "worksFor>");
+        p_member_of = index(UB + "memberOf>");
+        p_takes_course = index(UB + "takesCourse>");
+        p_teacher_of = index(UB + "teacherOf>");
+        p_advisor = index(UB + "advisor>");
+        p_ug_degree = index(UB + "undergraduateDegreeFrom>");
+        p_doc_degree = index(UB + "doctoralDegreeFrom>");
+        p_name = index(UB + "name>");
+        p_email = index(UB + "emailAddress>");
+        p_telephone = index(UB + "telephone>");
+
+        t_univ = index(UB + "University>");
+        t_dept = index(UB + "Department>");
+        t_group = index(UB + "ResearchGroup>");
+        t_full = index(UB + "FullProfessor>");
+        t_assoc = index(UB + "AssociateProfessor>");
+        t_assist = index(UB + "AssistantProfessor>");
+        t_course = index(UB + "Course>");
+        t_gcourse = index(UB + "GraduateCourse>");
+        t_ugstudent = index(UB + "UndergraduateStudent>");
+        t_gstudent = index(UB + "GraduateStudent>");
+
+        for (int u = 0; u < univs; u++) {
+            rng.seed(seed * 1000003 + u);
+            sid_t univ = normal("<http://www.University" + to_string(u) + ".edu>");
+            add(univ, TYPE_ID, t_univ);
+            add(univ, p_name, literal("University" + to_string(u)));
+
+            int ndepts = rand_in(15, 25);
+            for (int d = 0; d < ndepts; d++)
+                gen_department(u, d, univs);
+        }
+    }
+
+    // the number of predicates and types w/o PREDICATE_ID (i.e., GStore::num_normal_preds)
+    int num_preds() const { return index_str.size() - 1; }
+
+    string id2str(sid_t id) const {
+        return is_vid(id) ? normal_str[id - (1 << NBITS_IDX)] : index_str[id];
+    }
+
+    /**
+     * split the triples to engines like the loader does on a single server,
+     * i.e., by subject (pso) and object (pos), sorted for GStore::init()
+     */
+    void split(int num_engines, vector<vector<triple_t>> &triple_pso,
+               vector<vector<triple_t>> &triple_pos) const {
+        triple_pso.assign(num_engines, vector<triple_t>());
+        triple_pos.assign(num_engines, vector<triple_t>());
+        for (auto const &t : triples) {
+            triple_pso[t.s % num_engines].push_back(t);
+            triple_pos[t.o % num_engines].push_back(t);
+        }
+
+        for (int tid = 0; tid < num_engines; tid++) {
+#ifdef VERSATILE
+            sort(triple_pso[tid].begin(), triple_pso[tid].end(), triple_sort_by_spo());
+            sort(triple_pos[tid].begin(), triple_pos[tid].end(), triple_sort_by_ops());
+#else
+            sort(triple_pso[tid].begin(), triple_pso[tid].end(), triple_sort_by_pso());
+            sort(triple_pos[tid].begin(), triple_pos[tid].end(), triple_sort_by_pos());
+#endif
+        }
+    }
+};
+
+const string LUBMGen::UB = "<http://swat.cse.lehigh.edu/onto/univ-bench.owl#";
+const string LUBMGen::RDF = "<http://www.w3.org/1999/02/22-rdf-syntax-ns#";
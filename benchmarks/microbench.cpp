@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2016 Shanghai Jiao Tong University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://ipads.se.sjtu.edu.cn/projects/wukong
+ *
+ */
+
+#include <unistd.h>
+#include <iostream>
+
+#include "global.hpp"
+#include "mem.hpp"
+#include "string_server.hpp"
+#include "dgraph.hpp"
+#include "query.hpp"
+#include "engine/sparql.hpp"
+
+#include "bench.hpp"
+#include "lubm.hpp"
+
+// utils
+#include "bitrie.hpp"
+#include "math.hpp"
+
+using namespace std;
+
+/**
+ * Microbenchmarks of the kernels of Wukong on synthetic LUBM-like data,
+ * which run in a single process w/o MPI, RDMA and networking.
+ */
+
+// a single server, so that no metadata is exchanged (see GStore::sync_metadata)
+TCP_Adaptor *con_adaptor = NULL;
+
+static LUBMGen *lubm;
+static GStore *gstore;
+static vector<ikey_t> normal_keys;  // all local (vid, pid, d) keys
+static vector<ikey_t> index_keys;   // all (0, pid/tid, d) keys
+
+// a fast per-thread random number (xorshift)
+static inline uint64_t next_rand(uint64_t &x) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return x;
+}
+
+static void build_gstore() {
+    Mem *mem = new Mem(1, Global::num_threads);
+#ifdef DYNAMIC_GSTORE
+    gstore = new DynamicGStore(0, mem);
+#else
+    gstore = new StaticGStore(0, mem);
+#endif
+    gstore->num_normal_preds = lubm->num_preds();
+
+    vector<vector<triple_t>> triple_pso, triple_pos;
+    vector<vector<triple_attr_t>> triple_sav(Global::num_engines);
+    lubm->split(Global::num_engines, triple_pso, triple_pos);
+
+    uint64_t start = timer::get_usec();
+    gstore->refresh();
+    gstore->init(triple_pso, triple_pos, triple_sav);
+    logstream(LOG_INFO) << "build gstore with " << lubm->triples.size() << " triples in "
+                        << (timer::get_usec() - start) / 1000 << " ms" << LOG_endl;
+
+    for (auto const &t : lubm->triples) {
+        normal_keys.push_back(ikey_t(t.s, t.p, OUT));
+        if (is_vid(t.o)) normal_keys.push_back(ikey_t(t.o, t.p, IN));
+    }
+    sort(normal_keys.begin(), normal_keys.end(), [](const ikey_t &a, const ikey_t &b) {
+        return make_tuple(a.vid, a.pid, a.dir) < make_tuple(b.vid, b.pid, b.dir);
+    });
+    normal_keys.erase(unique(normal_keys.begin(), normal_keys.end()), normal_keys.end());
+    shuffle(normal_keys.begin(), normal_keys.end(), mt19937(0));
+
+    for (sid_t id = 2; id < lubm->index_str.size(); id++) {
+        uint64_t sz = 0;
+        for (dir_t d : {IN, OUT})
+            if (gstore->get_edges(0, 0, id, d, sz) != NULL && sz > 0)
+                index_keys.push_back(ikey_t(0, id, d));
+    }
+}
+
+// lookup the key of a vertex (i.e., get_vertex_local) w/o reading its edges
+static void bench_get_edges_local(BenchState &state) {
+    uint64_t x = 88172645463325252ull + state.thread_id;
+    uint64_t n = normal_keys.size(), sum = 0;
+    while (state.next()) {
+        const ikey_t &k = normal_keys[next_rand(x) % n];
+        uint64_t sz = 0;
+        gstore->get_edges(state.thread_id, k.vid, k.pid, (dir_t)k.dir, sz);
+        sum += sz;
+    }
+    do_not_optimize(sum);
+}
+
+static void bench_scan_edges_local(BenchState &state) {
+    uint64_t x = 88172645463325252ull + state.thread_id;
+    uint64_t n = normal_keys.size(), sum = 0;
+    while (state.next()) {
+        const ikey_t &k = normal_keys[next_rand(x) % n];
+        uint64_t sz = 0;
+        edge_t *edges = gstore->get_edges(state.thread_id, k.vid, k.pid, (dir_t)k.dir, sz);
+        for (uint64_t i = 0; i < sz; i++) sum += edges[i].val;
+    }
+    do_not_optimize(sum);
+}
+
+// read the whole (predicate or type) index, e.g., ?X rdf:type ub:Course
+static void bench_get_index(BenchState &state) {
+    uint64_t n = index_keys.size(), i = state.thread_id, sum = 0, edges = 0;
+    for (auto const &k : index_keys) {
+        uint64_t sz = 0;
+        gstore->get_edges(state.thread_id, 0, k.pid, (dir_t)k.dir, sz);
+        edges += sz;
+    }
+    state.set_items_per_iteration(max(edges / n, (uint64_t)1));  // edges
+
+    while (state.next()) {
+        const ikey_t &k = index_keys[i++ % n];
+        uint64_t sz = 0;
+        edge_t *e = gstore->get_edges(state.thread_id, 0, k.pid, (dir_t)k.dir, sz);
+        for (uint64_t j = 0; j < sz; j++) sum += e[j].val;
+    }
+    do_not_optimize(sum);
+}
+
+static RDMA_Cache *rdma_cache;
+
+static void bench_cache_lookup(BenchState &state) {
+    uint64_t x = 88172645463325252ull + state.thread_id;
+    uint64_t n = normal_keys.size(), hits = 0;
+    vertex_t v;
+    while (state.next())
+        hits += rdma_cache->lookup(normal_keys[next_rand(x) % n], v);
+    do_not_optimize(hits);
+}
+
+static void bench_cache_insert(BenchState &state) {
+    uint64_t x = 88172645463325252ull + state.thread_id;
+    uint64_t n = normal_keys.size();
+    while (state.next()) {
+        vertex_t v;
+        v.key = normal_keys[next_rand(x) % n];
+        v.ptr = iptr_t(1, 0, 0);
+        rdma_cache->insert(v);
+    }
+}
+
+static bitrie<char, sid_t> *strings;
+
+// a bitrie is not thread-safe for insertion (single thread only)
+static void bench_bitrie_insert(BenchState &state) {
+    bitrie<char, sid_t> bt;
+    uint64_t n = lubm->normal_str.size();
+    vector<string> keys;
+    for (uint64_t i = 0; i < state.iterations(); i++)
+        keys.push_back(i < n ? lubm->normal_str[i]
+                       : lubm->normal_str[i % n] + "#" + to_string(i / n));
+
+    uint64_t i = 0;
+    while (state.next()) {
+        bt.insert_kv(keys[i], i);
+        i++;
+    }
+}
+
+static void bench_bitrie_str2id(BenchState &state) {
+    uint64_t x = 88172645463325252ull + state.thread_id;
+    uint64_t n = lubm->normal_str.size(), sum = 0;
+    while (state.next())
+        sum += (*strings)[lubm->normal_str[next_rand(x) % n]];
+    do_not_optimize(sum);
+}
+
+static void bench_bitrie_id2str(BenchState &state) {
+    uint64_t x = 88172645463325252ull + state.thread_id;
+    uint64_t n = lubm->normal_str.size(), sum = 0;
+    while (state.next())
+        sum += (*strings)[(sid_t)((1 << NBITS_IDX) + next_rand(x) % n)].size();
+    do_not_optimize(sum);
+}
+
+// a random table of #rows x #cols IDs w/ about half of the rows duplicated
+static vector<sid_t> random_table(int rows, int cols) {
+    mt19937 rng(rows);
+    vector<sid_t> table(rows * cols);
+    for (int i = 0; i < rows; i++)
+        for (int j = 0; j < cols; j++)
+            table[i * cols + j] = (1 << NBITS_IDX) + rng() % (rows / 2 + 1);
+    return table;
+}
+
+// sort a copy of the table per iteration (the copy is timed)
+static function<void(BenchState &)> bench_qsort_tuple(int rows, int cols) {
+    return [rows, cols](BenchState & state) {
+        vector<sid_t> table = random_table(rows, cols), copy;
+        state.set_items_per_iteration(rows);
+        while (state.next()) {
+            copy = table;
+            wukong::tuple::qsort_tuple(cols, copy);
+        }
+        do_not_optimize(copy.data());
+    };
+}
+
+// SELECT DISTINCT on a table (w/ a projection), the copy is timed
+static function<void(BenchState &)> bench_final_process(int rows, int cols) {
+    return [rows, cols](BenchState & state) {
+        SPARQLEngine engine(0, state.thread_id, NULL, NULL, NULL, NULL);
+        SPARQLQuery q;
+        q.distinct = true;
+        q.result.nvars = cols;
+        for (int j = 0; j < cols; j++) {
+            q.result.add_var2col(-(j + 1), j);
+            if (j < cols - 1) q.result.required_vars.push_back(-(j + 1));
+        }
+        q.result.set_col_num(cols);
+        q.result.result_table = random_table(rows, cols);
+
+        state.set_items_per_iteration(rows);
+        while (state.next()) {
+            SPARQLQuery r = q;
+            engine.final_process(r);
+            do_not_optimize(r.result.result_table.data());
+        }
+    };
+}
+
+static void usage(char *fn)
+{
+    cout << "usage: " << fn << " [options]" << endl;
+    cout << "options:" << endl;
+    cout << "  -f regex  : only run the benchmarks matching <regex>" << endl;
+    cout << "  -u num    : the number of LUBM-like universities (default: 1)" << endl;
+    cout << "  -T num    : the max number of threads (default: #cores)" << endl;
+    cout << "  -t sec    : the min time of a run (default: 0.5)" << endl;
+    cout << "  -r num    : the repetitions of a run (default: 3)" << endl;
+    cout << "  -m gb     : the size (GB) of in-memory store (default: 1)" << endl;
+    cout << "  -o fname  : output results into <fname> (CSV, or JSON if ends with .json)" << endl;
+}
+
+int
+main(int argc, char *argv[])
+{
+    BenchRunner runner;
+    string filter, fname;
+    int univs = 1, mem_gb = 1;
+
+    int c;
+    while ((c = getopt(argc, argv, "f:u:T:t:r:m:o:h")) != -1) {
+        switch (c) {
+        case 'f': filter = optarg; break;
+        case 'u': univs = atoi(optarg); break;
+        case 'T': runner.max_threads = atoi(optarg); break;
+        case 't': runner.min_time = atof(optarg); break;
+        case 'r': runner.repetitions = atoi(optarg); break;
+        case 'm': mem_gb = atoi(optarg); break;
+        case 'o': fname = optarg; break;
+        default:
+            usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    ASSERT(univs > 0 && mem_gb > 0 && runner.max_threads > 0 && runner.repetitions > 0);
+
+    // a single server w/o RDMA, each benchmark thread acts as an engine
+    Global::num_servers = 1;
+    Global::num_proxies = 0;
+    Global::num_engines = runner.max_threads;
+    Global::num_threads = runner.max_threads;
+    Global::use_rdma = false;
+    Global::rdma_buf_size_mb = Global::rdma_rbf_size_mb = 0;
+    Global::enable_caching = true;
+    Global::memstore_size_gb = mem_gb;
+
+    uint64_t start = timer::get_usec();
+    lubm = new LUBMGen(univs);
+    logstream(LOG_INFO) << "generate " << lubm->triples.size() << " triples of " << univs
+                        << " universities in " << (timer::get_usec() - start) / 1000
+                        << " ms (commit: " << WUKONG_GIT_COMMIT << ")" << LOG_endl;
+    build_gstore();
+
+    rdma_cache = new RDMA_Cache();
+    for (auto const &k : normal_keys) {
+        vertex_t v;
+        v.key = k;
+        v.ptr = iptr_t(1, 0, 0);
+        rdma_cache->insert(v);
+    }
+
+    strings = new bitrie<char, sid_t>();
+    for (size_t i = 0; i < lubm->normal_str.size(); i++)
+        strings->insert_kv(lubm->normal_str[i], (1 << NBITS_IDX) + i);
+
+    vector<int> scaling;
+    for (int t = 1; t < runner.max_threads; t *= 2) scaling.push_back(t);
+    scaling.push_back(runner.max_threads);
+
+    runner.add("gstore/get_edges_local", bench_get_edges_local, scaling);
+    runner.add("gstore/get_edges_local/scan", bench_scan_edges_local, scaling);
+    runner.add("gstore/get_index", bench_get_index, scaling);
+    runner.add("cache/lookup", bench_cache_lookup, scaling);
+    runner.add("cache/insert", bench_cache_insert, scaling);
+    runner.add("bitrie/insert", bench_bitrie_insert);
+    runner.add("bitrie/str2id", bench_bitrie_str2id, scaling);
+    runner.add("bitrie/id2str", bench_bitrie_id2str, scaling);
+    runner.add("tuple/qsort_tuple/1K", bench_qsort_tuple(1000, 3));
+    runner.add("tuple/qsort_tuple/64K", bench_qsort_tuple(64000, 3));
+    runner.add("sparql/final_process/distinct/1K", bench_final_process(1000, 3));
+    runner.add("sparql/final_process/distinct/64K", bench_final_process(64000, 3), scaling);
+
+    runner.run(filter);
+    if (!fname.empty())
+        runner.dump(fname);
+    return 0;
+}
@@ -22,7 +22,11 @@
 
 #pragma once
 
+#include <vector>
+#include <tbb/concurrent_queue.h>
+
 #include "global.hpp"
+#include "metrics.hpp"
 #include "query.hpp"
 
 // comm
@@ -31,27 +35,104 @@
 
 /// TODO: define adaptor as a C++ interface and make tcp and rdma implement it
 class Adaptor {
+private:
+    // in-memory queues of proxies and engines on the same server (one per thread),
+    // which pass SPARQL queries between local threads w/o (de)serialization
+    static vector<tbb::concurrent_queue<SPARQLQuery>> &local_queues() {
+        static vector<tbb::concurrent_queue<SPARQLQuery>> queues(Global::num_proxies + Global::num_engines);
+        return queues;
+    }
+
+    inline bool count_sent(bool ok, uint64_t sz) {
+        if (ok) {
+            Metrics::get_metrics().inc(tid, ADAPTOR_MSGS_SENT);
+            Metrics::get_metrics().inc(tid, ADAPTOR_BYTES_SENT, sz);
+        }
+        return ok;
+    }
+
+    inline bool count_recv(bool ok, uint64_t sz) {
+        if (ok) {
+            Metrics::get_metrics().inc(tid, ADAPTOR_MSGS_RECV);
+            Metrics::get_metrics().inc(tid, ADAPTOR_BYTES_RECV, sz);
+        }
+        return ok;
+    }
+
 public:
+    int sid; // server id
     int tid; // thread id
 
     TCP_Adaptor *tcp;   // communicaiton by TCP/IP
     RDMA_Adaptor *rdma; // communicaiton by RDMA
 
-    Adaptor(int tid, TCP_Adaptor *tcp, RDMA_Adaptor *rdma)
-        : tid(tid), tcp(tcp), rdma(rdma) { }
+    Adaptor(int sid, int tid, TCP_Adaptor *tcp, RDMA_Adaptor *rdma)
+        : sid(sid), tid(tid), tcp(tcp), rdma(rdma) { }
 
     ~Adaptor() { }
 
+    // w/o TCP and RDMA (e.g., the single-process benchmark), only the local queues are used
+    bool in_process() { return (tcp == NULL && rdma == NULL); }
+
+    // NOTE: the GPU agent only polls TCP/RDMA, so it never uses the local queues
+    bool is_local(int dst_sid, int dst_tid) {
+        return (Global::enable_local_shortcut && dst_sid == sid
+                && dst_tid < Global::num_proxies + Global::num_engines);
+    }
+
     bool send(int dst_sid, int dst_tid, const string &str) {
+        ASSERT_MSG(!in_process(), "TCP or RDMA is required to send msgs.");
+        if (Global::use_rdma && rdma->init)
+            return count_sent(rdma->send(tid, dst_sid, dst_tid, str), str.size());
+        else
+            return count_sent(tcp->send(tid, dst_sid, dst_tid, str), str.size());
+    }
+
+    // The msg is moved (instead of copied) to TCP (or a large msg to RDMA) w/o copy.
+    // NOTE: the msg is moved only if sent, so the caller can keep it to retry
+    bool send(int dst_sid, int dst_tid, string &&str) {
+        ASSERT_MSG(!in_process(), "TCP or RDMA is required to send msgs.");
+        uint64_t sz = str.size();
         if (Global::use_rdma && rdma->init)
-            return rdma->send(tid, dst_sid, dst_tid, str);
+            return count_sent(rdma->send(tid, dst_sid, dst_tid, std::move(str)), sz);
         else
-            return tcp->send(dst_sid, dst_tid, str);
+            return count_sent(tcp->send(tid, dst_sid, dst_tid, std::move(str)), sz);
     }
 
     bool send(int dst_sid, int dst_tid, const Bundle &b) {
-        string str = b.to_str();
-        return send(dst_sid, dst_tid, str);
+        return send(dst_sid, dst_tid, b.to_str());
+    }
+
+    // send a query to the thread on the same server or (serialized) to a remote one
+    bool send(int dst_sid, int dst_tid, const SPARQLQuery &r) {
+        if (is_local(dst_sid, dst_tid)) {
+            local_queues()[dst_tid].push(r);
+            return true;
+        }
+        return send(dst_sid, dst_tid, Bundle(r));
+    }
+
+    // the query will be moved (instead of copied) to the local queue
+    bool send(int dst_sid, int dst_tid, SPARQLQuery &&r) {
+        if (is_local(dst_sid, dst_tid)) {
+            local_queues()[dst_tid].push(std::move(r));
+            return true;
+        }
+        return send(dst_sid, dst_tid, Bundle(r));
+    }
+
+    // A stamp changed only if (dst_sid, dst_tid) may accept more msgs than before
+    // (i.e., the head of remote ring buffer has been moved).
+    // Return 0 if unknown (e.g., TCP), so that the sender should always retry.
+    // NOTE: the msgs behind a msg being sent in chunks should always be retried,
+    //       since the chunks may be sent by recv w/o the move of (lazy) head.
+    uint64_t send_stamp(int dst_sid, int dst_tid) {
+        if (Global::use_rdma && rdma->init) {
+            if (rdma->sending(tid, dst_sid, dst_tid))
+                return 0;
+            return rdma->ring_head(dst_sid, dst_tid) + 1;
+        }
+        return 0;
     }
 
     // gpu-direct send, from gpu mem to remote ring buffer
@@ -75,6 +156,7 @@ public:
             str = rdma->recv(tid);
         else
             str = tcp->recv(tid);
+        count_recv(true, str.size());
         return Bundle(str);
     }
 
@@ -85,14 +167,26 @@ public:
             str = rdma->recv(tid, specified);
         else
             str = tcp->recv(tid, specified);
+        count_recv(true, str.size());
         return str;
     }
 
+    // receive a query from the threads on the same server
+    bool tryrecv_local(SPARQLQuery &r) {
+        if (tid >= Global::num_proxies + Global::num_engines)
+            return false;
+        return local_queues()[tid].try_pop(r);
+    }
+
     bool tryrecv(string &str) {
+        if (in_process()) return false;
+
+        bool ok;
         if (Global::use_rdma && rdma->init)
-            return rdma->tryrecv(tid, str);
+            ok = rdma->tryrecv(tid, str);
         else
-            return tcp->tryrecv(tid, str);
+            ok = tcp->tryrecv(tid, str);
+        return count_recv(ok, str.size());
     }
 
     bool tryrecv(Bundle &b) {
@@ -104,10 +198,14 @@ public:
 
     // Receive msg and return the sender
     bool tryrecv(string &str, int &sender) {
+        if (in_process()) return false;
+
+        bool ok;
         if (Global::use_rdma && rdma->init)
-            return rdma->tryrecv(tid, str, sender);
+            ok = rdma->tryrecv(tid, str, sender);
         else
-            return tcp->tryrecv(tid, str, sender);
+            ok = tcp->tryrecv(tid, str, sender);
+        return count_recv(ok, str.size());
     }
 
     // Receive msg and return the sender
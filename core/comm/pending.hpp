@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2016 Shanghai Jiao Tong University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://ipads.se.sjtu.edu.cn/projects/wukong
+ *
+ */
+
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "global.hpp"
+#include "query.hpp"
+
+// comm
+#include "adaptor.hpp"
+
+using namespace std;
+
+// the sender stops issuing new work beyond this #pending msgs (backpressure)
+#define MAX_PENDING_MSGS 1024
+
+/**
+ * Msgs failed to send (e.g., the remote ring buffer is full) by a thread.
+ * There is a FIFO queue per destination (server, thread), which is retried
+ * from the front and stops at the first failure. A blocked queue is skipped
+ * until the destination may accept more msgs (see Adaptor::send_stamp).
+ */
+class PendingMsgs {
+private:
+    struct queue_t {
+        deque<string> msgs;
+        uint64_t stamp = 0ull;  // the stamp of destination at the last failure
+    };
+
+    Adaptor *adaptor;
+
+    vector<queue_t> queues;  // #servers x #threads
+    vector<int> blocked;     // the destinations with pending msgs
+
+    uint64_t depth = 0ull;      // #pending msgs
+    uint64_t max_depth = 0ull;
+
+    inline int qid_of(int sid, int tid) { return sid * Global::num_threads + tid; }
+
+    void push(int id, string &&str, uint64_t stamp) {
+        queue_t &q = queues[id];
+        if (q.msgs.empty()) {
+            q.stamp = stamp;
+            blocked.push_back(id);
+        }
+        q.msgs.push_back(std::move(str));
+
+        depth++;
+        max_depth = max(max_depth, depth);
+    }
+
+public:
+    PendingMsgs(Adaptor *adaptor)
+        : adaptor(adaptor), queues(Global::num_servers * Global::num_threads) { }
+
+    // Send the msg unless there are earlier msgs to the same destination.
+    // The msg is moved to the adaptor (w/o copy) if sent, or to the queue otherwise.
+    // Return false if the msg is pending.
+    bool send(int dst_sid, int dst_tid, string &&str) {
+        int id = qid_of(dst_sid, dst_tid);
+        if (queues[id].msgs.empty()) {
+            // NOTE: read the stamp before sending to never miss the move of head
+            uint64_t stamp = adaptor->send_stamp(dst_sid, dst_tid);
+            if (adaptor->send(dst_sid, dst_tid, std::move(str)))  // moved only if sent
+                return true;
+            push(id, std::move(str), stamp);
+        } else {
+            push(id, std::move(str), 0ull);  // keep the order
+        }
+        return false;
+    }
+
+    bool send(int dst_sid, int dst_tid, const Bundle &bundle) {
+        return send(dst_sid, dst_tid, bundle.to_str());
+    }
+
+    // Send the msg only if it will not be pending.
+    // NOTE: the msg is moved only if sent, so it can be retried by the caller
+    bool try_send(int dst_sid, int dst_tid, string &&str) {
+        if (!queues[qid_of(dst_sid, dst_tid)].msgs.empty())
+            return false;
+        return adaptor->send(dst_sid, dst_tid, std::move(str));
+    }
+
+    // Retry the pending msgs of the destinations that may be ready.
+    void sweep() {
+        for (int i = 0; i < blocked.size();) {
+            int id = blocked[i];
+            int dst_sid = id / Global::num_threads, dst_tid = id % Global::num_threads;
+            queue_t &q = queues[id];
+
+            uint64_t stamp = adaptor->send_stamp(dst_sid, dst_tid);
+            if (q.stamp == 0 || q.stamp != stamp) {
+                // NOTE: refresh the stamp before each msg, since a sent msg may be
+                //       still being sent in chunks and block the rest ones
+                while (!q.msgs.empty()) {
+                    stamp = adaptor->send_stamp(dst_sid, dst_tid);
+                    if (!adaptor->send(dst_sid, dst_tid, std::move(q.msgs.front())))
+                        break;
+                    q.msgs.pop_front();
+                    depth--;
+                }
+                q.stamp = stamp;
+            }
+
+            if (q.msgs.empty()) {
+                blocked[i] = blocked.back();
+                blocked.pop_back();
+            } else {
+                i++;
+            }
+        }
+    }
+
+    // producers should not issue new work (e.g., queries) if backlogged
+    bool backlogged() { return depth >= MAX_PENDING_MSGS; }
+
+    uint64_t size() { return depth; }
+
+    uint64_t max_size() { return max_depth; }
+
+    void reset_max_size() { max_depth = depth; }
+};
@@ -23,6 +23,9 @@
 #pragma once
 
 #include <string>
+#include <deque>
+#include <list>
+#include <vector>
 #include <iostream>
 #include <unistd.h>
 #include <unordered_map>
@@ -30,6 +33,7 @@
 #include <errno.h>
 #include <sstream>
 #include <assert.h>
+#include <emmintrin.h>
 
 #include "global.hpp"
 #include "rdma.hpp"
@@ -48,6 +52,13 @@ using namespace std;
 
 #define WK_CLINE 64
 
+// max #msgs fetched from a ring buffer per poll
+#define RDMA_FETCH_BATCH 8
+
+// the flag in the header (and footer) of a msg in ring buffer to mark a chunk,
+// which is a piece of a msg too large to send at once (see send())
+#define RDMA_CHUNK_FLAG (1ull << 63)
+
 // The communication over RDMA-based ring buffer
 class RDMA_Adaptor {
 private:
@@ -71,6 +82,8 @@ private:
     struct rbf_rmeta_t {
         uint64_t tail;
         pthread_spinlock_t lock;
+        uint64_t doorbell;  // the last value written to the doorbell of reader
+        pthread_spinlock_t dlock;
     } __attribute__ ((aligned (WK_CLINE)));
 
     // track head of ring buffer for local reader
@@ -89,6 +102,39 @@ private:
 
     scheduler_t *schedulers;
 
+    // msgs fetched in batch but not returned yet, <src_sid, msg> (per thread)
+    vector<deque<pair<int, string>>> stashes;
+
+    // a contiguous copy of lmeta.head (#threads x #servers) to compare with doorbells
+    uint64_t *dbl_heads = NULL;
+
+    // layout of chunk: [chunk_hdr_t | piece of msg]
+    struct chunk_hdr_t {
+        uint32_t tid;   // tid of writer
+        uint32_t last;  // the last chunk of msg
+    };
+
+    // a large msg being sent in chunks by a thread
+    struct chunked_msg_t {
+        int dst_sid;
+        int dst_tid;
+        string data;
+        uint64_t off;   // bytes of data have been sent
+    };
+
+    // msgs being sent in chunks (per thread)
+    vector<list<chunked_msg_t>> outgoings;
+
+    // msgs being reassembled from chunks (#threads x #servers x #threads),
+    // indexed by reader thread and writer (server and thread)
+    vector<string> partials;
+
+    // the max size of a msg sent at once
+    uint64_t chunk_size() {
+        // keep the ring buffer and RDMA buffer available to the other msgs
+        return min(mem->buffer_size(), mem->ring_size()) / 4;
+    }
+
     // Align given value down to given alignment
     uint64_t inline floor(uint64_t val, uint64_t alignment) {
         ASSERT(alignment != 0);
@@ -111,8 +157,17 @@ private:
         return *(volatile uint64_t *)(rbf + lmeta->head % rbf_sz);  // header (data size)
     }
 
+    // Check if the doorbell of ring buffer (from threads in src_sid to tid) is ringing.
+    // NOTE: it keeps ringing until all msgs before the doorbell have been fetched
+    bool ringing(int tid, int src_sid) {
+        uint64_t doorbell = *(volatile uint64_t *)mem->doorbell(tid, src_sid);
+        return doorbell > dbl_heads[tid * num_servers + src_sid];
+    }
+
     // Fetch data from threads in dst_sid to tid
-    bool fetch(int tid, int dst_sid, std::string &data, uint64_t data_sz) {
+    bool fetch(int tid, int dst_sid, std::string &data, uint64_t hdr) {
+        uint64_t data_sz = hdr & ~RDMA_CHUNK_FLAG;
+
         // 1. validate and acquire the message
         char * rbf = mem->ring(tid, dst_sid);
         uint64_t rbf_sz = mem->ring_size();
@@ -121,9 +176,9 @@ private:
         rbf_lmeta_t *lmeta = &lmetas[tid * num_servers + dst_sid];
         uint64_t *head_ptr = (uint64_t *)(rbf + lmeta->head % rbf_sz);
 
-        // validate: data_sz is not changed; acquire: zeroing the size in header
-        // (NOTE: data_sz is read in check())
-        if (wukong::atomic::compare_and_swap(head_ptr, data_sz, 0) != data_sz)
+        // validate: header is not changed; acquire: zeroing the size in header
+        // (NOTE: header is read in check())
+        if (wukong::atomic::compare_and_swap(head_ptr, hdr, 0) != hdr)
             return false; // msg has been acquired by another concurrent engine
 
         // 2. wait the entire msg has been written
@@ -131,10 +186,10 @@ private:
         volatile uint64_t * footer = (volatile uint64_t *)(rbf + (lmeta->head + to_footer) % rbf_sz); // footer
 
         // spin-wait RDMA WRITE done
-        while (*footer != data_sz) {
+        while (*footer != hdr) {
             _mm_pause();
-            // If RDMA-WRITE is done, then footer == header == size. Otherwise, footer == 0
-            ASSERT(*footer == 0 || *footer == data_sz);
+            // If RDMA-WRITE is done, then footer == header. Otherwise, footer == 0
+            ASSERT(*footer == 0 || *footer == hdr);
         }
         *footer = 0;  // clean footer
 
@@ -170,10 +225,154 @@ private:
 
         // 5. update the metadata of ring buffer (done)
         lmeta->head += 2 * sizeof(uint64_t) + ceil(data_sz, sizeof(uint64_t));
+        dbl_heads[tid * num_servers + dst_sid] = lmeta->head;
 
         return true;
     } // end of fetch
 
+    // Append a chunk fetched by thread(tid) from src_sid to its msg.
+    // Return true and move the entire msg to @data if the chunk is the last one.
+    bool reassemble(int tid, int src_sid, std::string &data) {
+        ASSERT(data.size() >= sizeof(chunk_hdr_t));
+        chunk_hdr_t *chdr = (chunk_hdr_t *)data.data();
+        ASSERT(chdr->tid < num_threads);
+
+        // NOTE: chunks of a msg are written to the same ring buffer in order
+        string &partial = partials[(tid * num_servers + src_sid) * num_threads + chdr->tid];
+        partial.append(data, sizeof(chunk_hdr_t), string::npos);
+        if (!chdr->last) return false;
+
+        data = std::move(partial);
+        partial.clear();
+        return true;
+    }
+
+    // Fetch a msg from threads in src_sid to tid, which may be a chunk.
+    // Return true and fill @data only if an entire msg is fetched.
+    bool fetch_msg(int tid, int src_sid, std::string &data, uint64_t hdr, bool &fetched) {
+        fetched = fetch(tid, src_sid, data, hdr);
+        if (!fetched) return false;
+        return !(hdr & RDMA_CHUNK_FLAG) || reassemble(tid, src_sid, data);
+    }
+
+    // Ring the doorbell of (dst_sid, dst_tid) with the end of a msg written by thread(tid).
+    // NOTE: the doorbell only moves forward, since msgs reserved by concurrent writers
+    //       may be done out of order (the reader will check the header anyway)
+    void ring_doorbell(int tid, int dst_sid, int dst_tid, uint64_t end) {
+        rbf_rmeta_t *rmeta = &rmetas[dst_sid * num_threads + dst_tid];
+
+        pthread_spin_lock(&rmeta->dlock);
+        if (end > rmeta->doorbell) {
+            rmeta->doorbell = end;
+            if (sid == dst_sid) {  // direct update local doorbell
+                *(volatile uint64_t *)mem->doorbell(dst_tid, sid) = end;
+            } else {  // update remote doorbell via RDMA (the msg has been written)
+                // NOTE: not use the RDMA buffer of thread, which may hold a msg
+                //       (e.g., the rest chunks) being written
+                char *local = mem->doorbell_buffer(tid);
+                *(uint64_t *)local = end;
+
+                RDMA &rdma = RDMA::get_rdma();
+                rdma.dev->RdmaWrite(tid, dst_sid, local, mem->doorbell_size(),
+                                    mem->doorbell_offset(dst_tid, sid));
+            }
+        }
+        pthread_spin_unlock(&rmeta->dlock);
+    }
+
+    // Send a msg (or chunk) to (dst_sid, dst_tid) at once by thread(tid)
+    bool send_raw(int tid, int dst_sid, int dst_tid, const char *data, uint64_t data_sz,
+                  uint64_t flag = 0) {
+        // 1. calculate msg size
+        // struct of msg: [size | data | size] (use size of data as header and footer)
+        uint64_t msg_sz = sizeof(uint64_t) + ceil(data_sz, sizeof(uint64_t)) + sizeof(uint64_t);
+        ASSERT(msg_sz <= chunk_size());
+
+        // 2. reserve space in ring-buffer
+        rbf_rmeta_t *rmeta = &rmetas[dst_sid * num_threads + dst_tid];
+
+        pthread_spin_lock(&rmeta->lock);
+        if (rbf_full(tid, dst_sid, dst_tid, msg_sz)) { // detect overflow
+            pthread_spin_unlock(&rmeta->lock);
+            return false;
+        }
+        uint64_t off = rmeta->tail;
+        rmeta->tail += msg_sz;
+        pthread_spin_unlock(&rmeta->lock);
+
+
+        // 3. (real) send data
+        // local data:  <tid, data, data_sz>; remote buffer: <dst_sid, dst_tid, off, msg_sz>
+        native_send(tid, data, data_sz, dst_sid, dst_tid, off, msg_sz, flag);
+
+        // 4. notify the reader
+        ring_doorbell(tid, dst_sid, dst_tid, off + msg_sz);
+
+        return true;
+    }
+
+    // Send the rest chunks of msgs being sent by thread(tid) as many as possible.
+    // Return true if the msg to (dst_sid, dst_tid) is still being sent.
+    bool progress(int tid, int dst_sid = -1, int dst_tid = -1) {
+        bool busy = false;
+        uint64_t max_sz = chunk_size() - 2 * sizeof(uint64_t) - sizeof(chunk_hdr_t);
+
+        list<chunked_msg_t> &msgs = outgoings[tid];
+        for (auto it = msgs.begin(); it != msgs.end();) {
+            string chunk;
+            while (it->off < it->data.length()) {
+                uint64_t sz = min(max_sz, it->data.length() - it->off);
+                chunk_hdr_t chdr;
+                chdr.tid = tid;
+                chdr.last = (it->off + sz == it->data.length());
+
+                chunk.assign((const char *)&chdr, sizeof(chunk_hdr_t));
+                chunk.append(it->data, it->off, sz);
+                if (!send_raw(tid, it->dst_sid, it->dst_tid, chunk.c_str(), chunk.length(),
+                              RDMA_CHUNK_FLAG))
+                    break;  // retry later
+                it->off += sz;
+            }
+
+            if (it->off == it->data.length()) {
+                it = msgs.erase(it);
+            } else {
+                if (it->dst_sid == dst_sid && it->dst_tid == dst_tid)
+                    busy = true;
+                ++it;
+            }
+        }
+        return busy;
+    }
+
+    // Fetch (at most RDMA_FETCH_BATCH) msgs from the ring buffers whose doorbells are
+    // ringing into the stash of thread(tid). The ring buffers are polled in a rotating
+    // order to be fair to all servers. Return false if there is no msg (or chunk).
+    bool poll(int tid) {
+        scheduler_t *sched = &schedulers[tid];
+        int src_sid = sched->rr_cnt % num_servers;
+        for (int i = 0; i < num_servers; i++, src_sid = (src_sid + 1) < num_servers ? (src_sid + 1) : 0) {
+            if (!ringing(tid, src_sid)) continue;
+
+            int cnt = 0;
+            uint64_t hdr;
+            bool fetched;
+            while (cnt < RDMA_FETCH_BATCH && (hdr = check(tid, src_sid)) != 0) {
+                std::string data;
+                if (fetch_msg(tid, src_sid, data, hdr, fetched))
+                    stashes[tid].push_back(make_pair(src_sid, std::move(data)));
+                if (!fetched) break;
+                cnt++;  // count the chunks as well
+            }
+
+            if (cnt > 0) {
+                sched->rr_cnt = src_sid + 1; // start from the next server
+                return true;
+            }
+        }
+        return false;
+    }
+
     /* Check whether overflow occurs if given msg is sent
      * @tid tid of writer
      * @dst_sid, @dst_tid sid and tid of reader
@@ -191,14 +390,14 @@ private:
     }
 
     void native_send(int tid, const char *data, uint64_t data_sz,
-                     int dst_sid, int dst_tid, uint64_t off, uint64_t sz) {
+                     int dst_sid, int dst_tid, uint64_t off, uint64_t sz, uint64_t flag = 0) {
         if (sid == dst_sid) {                                    // send to local server
             // write msg to local ring buffer
             char *ptr = mem->ring(dst_tid, sid);
             uint64_t rbf_sz = mem->ring_size();
             ASSERT(sz < rbf_sz); // enough space (remote ring buffer)
 
-            *((uint64_t *)(ptr + off % rbf_sz)) = data_sz;       // header
+            *((uint64_t *)(ptr + off % rbf_sz)) = data_sz | flag; // header
 
             off += sizeof(uint64_t);
             if (off / rbf_sz == (off + data_sz - 1) / rbf_sz ) { // data
@@ -210,20 +409,20 @@ private:
             }
 
             off += ceil(data_sz, sizeof(uint64_t));
-            *((uint64_t *)(ptr + off % rbf_sz)) = data_sz;       // footer
+            *((uint64_t *)(ptr + off % rbf_sz)) = data_sz | flag; // footer
         } else {                                                 // send to remote server
             // copy msg to local RDMA buffer
             uint64_t buf_sz = mem->buffer_size();
             ASSERT(sz < buf_sz); // enough space (local RDMA buffer)
 
             char *rdma_buf = mem->buffer(tid);
-            *((uint64_t *)rdma_buf) = data_sz;                   // header
+            *((uint64_t *)rdma_buf) = data_sz | flag;            // header
 
             rdma_buf += sizeof(uint64_t);
             memcpy(rdma_buf, data, data_sz);                     // data
 
             rdma_buf += ceil(data_sz, sizeof(uint64_t));
-            *((uint64_t*)rdma_buf) = data_sz;                    // footer
+            *((uint64_t*)rdma_buf) = data_sz | flag;             // footer
 
 
             // write msg to remote ring buffer
@@ -318,6 +517,8 @@ public:
         for (int i = 0; i < nrbfs; i++) {
             rmetas[i].tail = 0;
             pthread_spin_init(&rmetas[i].lock, 0);
+            rmetas[i].doorbell = 0;
+            pthread_spin_init(&rmetas[i].dlock, 0);
         }
 
         lmetas = (rbf_lmeta_t *)malloc(sizeof(rbf_lmeta_t) * nrbfs);
@@ -330,6 +531,14 @@ public:
         schedulers = (scheduler_t *)malloc(sizeof(scheduler_t) * num_threads);
         memset(schedulers, 0, sizeof(scheduler_t) * num_threads);
 
+        stashes.resize(num_threads);
+
+        outgoings.resize(num_threads);
+        partials.resize(num_threads * num_servers * num_threads);
+
+        dbl_heads = (uint64_t *)malloc(sizeof(uint64_t) * nrbfs);
+        memset(dbl_heads, 0, sizeof(uint64_t) * nrbfs);
+
         init = true;
     }
 
@@ -360,79 +569,105 @@ public:
         // local data:  <tid, data, data_sz>; remote buffer: <dst_sid, dst_tid, off, msg_sz>
         gdr_send(tid, data, data_sz, dst_sid, dst_tid, off);
 
+        // 4. notify the reader
+        ring_doorbell(tid, dst_sid, dst_tid, off + msg_sz);
+
         return true;
     }
 #endif
 
     // Send given string to (dst_sid, dst_tid) by thread(tid)
     // Return false if failed . Otherwise, return true.
+    // NOTE: a msg larger than chunk_size() is split into chunks, and the rest chunks
+    //       are sent by the following send() and recv() of the same thread.
     bool send(int tid, int dst_sid, int dst_tid, const string &str) {
         ASSERT(init);
 
-        const char *data = str.c_str();
-        uint64_t data_sz = str.length();
+        // only the msg sent in chunks is copied
+        uint64_t max_sz = chunk_size() - 2 * sizeof(uint64_t);
+        if (str.length() > max_sz)
+            return send(tid, dst_sid, dst_tid, string(str));
 
-        // 1. calculate msg size
-        // struct of msg: [size | data | size] (use size of data as header and footer)
-        uint64_t msg_sz = sizeof(uint64_t) + ceil(data_sz, sizeof(uint64_t)) + sizeof(uint64_t);
-
-
-        // 2. reserve space in ring-buffer
-        rbf_rmeta_t *rmeta = &rmetas[dst_sid * num_threads + dst_tid];
+        // the msgs to (dst_sid, dst_tid) must wait for the msg being sent in chunks
+        if (!outgoings[tid].empty() && progress(tid, dst_sid, dst_tid))
+            return false;
 
-        pthread_spin_lock(&rmeta->lock);
-        if (rbf_full(tid, dst_sid, dst_tid, msg_sz)) { // detect overflow
-            pthread_spin_unlock(&rmeta->lock);
+        return send_raw(tid, dst_sid, dst_tid, str.c_str(), str.length());
+    }
 
-            //avoid not enough space (remote ring buffer)
-            //without this, it will always fail, and retry,
-            //which will cause dead loop
-            uint64_t rbf_sz = mem->ring_size();
-            if ( msg_sz > rbf_sz ) {
-                logstream(LOG_ERROR) << "Size of ring buffer is smaller than message, please check your configure" << LOG_endl;
-                ASSERT(false);
-            }
+    // The msg sent in chunks is moved (instead of copied) to be sent later.
+    // NOTE: the msg is moved only if it returns true
+    bool send(int tid, int dst_sid, int dst_tid, string &&str) {
+        ASSERT(init);
 
-            // enough space (remote ring buffer)
+        // the msgs to (dst_sid, dst_tid) must wait for the msg being sent in chunks
+        if (!outgoings[tid].empty() && progress(tid, dst_sid, dst_tid))
             return false;
-        }
-        uint64_t off = rmeta->tail;
-        rmeta->tail += msg_sz;
-        pthread_spin_unlock(&rmeta->lock);
 
+        uint64_t max_sz = chunk_size() - 2 * sizeof(uint64_t);
+        if (str.length() <= max_sz)
+            return send_raw(tid, dst_sid, dst_tid, str.c_str(), str.length());
 
-        // 3. (real) send data
-        // local data:  <tid, data, data_sz>; remote buffer: <dst_sid, dst_tid, off, msg_sz>
-        native_send(tid, data, data_sz, dst_sid, dst_tid, off, msg_sz);
+        chunked_msg_t msg;
+        msg.dst_sid = dst_sid;
+        msg.dst_tid = dst_tid;
+        msg.data = std::move(str);
+        msg.off = 0;
+        outgoings[tid].push_back(std::move(msg));
 
+        progress(tid, dst_sid, dst_tid);
         return true;
     }
 
+    // Check if a msg to (dst_sid, dst_tid) is being sent in chunks by thread(tid).
+    // NOTE: the msgs to the destination are refused until the rest chunks are sent,
+    //       which may be done by recv() and tryrecv() w/o moving the head below.
+    bool sending(int tid, int dst_sid, int dst_tid) {
+        ASSERT(init);
+        for (auto &msg : outgoings[tid])
+            if (msg.dst_sid == dst_sid && msg.dst_tid == dst_tid)
+                return true;
+        return false;
+    }
+
+    // The head of remote ring buffer of (dst_sid, dst_tid) known by this server,
+    // which is moved (lazily) by the reader after fetching msgs (see fetch()).
+    uint64_t ring_head(int dst_sid, int dst_tid) {
+        ASSERT(init);
+        return *(volatile uint64_t *)mem->remote_ring_head(dst_tid, dst_sid);
+    }
+
     std::string recv(int tid) {
         ASSERT(init);
 
-        while (true) {
-            // each thread has a logical-queue (#servers physical-queues)
-            int src_sid = (schedulers[tid].rr_cnt++) % num_servers; // round-robin
-            uint64_t data_sz = check(tid, src_sid);
-            if (data_sz != 0) {
-                std::string data;
-                if (fetch(tid, src_sid, data, data_sz))
-                    return data;
-            }
-        }
+        std::string data;
+        while (!tryrecv(tid, data)) ;
+        return data;
     }
 
     std::string recv(int tid, int src_sid) {
         ASSERT(init);
         ASSERT(src_sid >= 0);
 
+        // the msgs from src_sid may have been fetched in batch
+        deque<pair<int, string>> &stash = stashes[tid];
+        for (auto it = stash.begin(); it != stash.end(); it++) {
+            if (it->first == src_sid) {
+                std::string data = std::move(it->second);
+                stash.erase(it);
+                return data;
+            }
+        }
+
         while (true) {
+            if (!outgoings[tid].empty()) progress(tid);
+
             // each thread has a logical-queue (#servers physical-queues)
-            uint64_t data_sz = check(tid, src_sid);
-            if (data_sz != 0) {
+            uint64_t hdr = check(tid, src_sid);
+            if (hdr != 0) {
                 std::string data;
-                if (fetch(tid, src_sid, data, data_sz))
+                bool fetched;
+                if (fetch_msg(tid, src_sid, data, hdr, fetched))
                     return data;
             }
         }
@@ -440,33 +675,23 @@ public:
 
     // try to recv data of given thread
     bool tryrecv(int tid, std::string &data) {
-        ASSERT(init);
-
-        // check all physical-queues of tid once
-        for (int sid = 0; sid < num_servers; sid++) {
-            uint64_t data_sz = check(tid, sid);
-            if (data_sz != 0)
-                if (fetch(tid, sid, data, data_sz))
-                    return true;
-        }
-
-        return false;
+        int src_sid;
+        return tryrecv(tid, data, src_sid);
     }
 
     // try to recv data of given thread and retrieve the server ID
     bool tryrecv(int tid, std::string &data, int &src_sid) {
         ASSERT(init);
 
-        // check all physical-queues of tid once
-        for (int sid = 0; sid < num_servers; sid++) {
-            uint64_t data_sz = check(tid, sid);
-            if (data_sz != 0) {
-                src_sid = sid;
-                if (fetch(tid, sid, data, data_sz))
-                    return true;
-            }
-        }
+        if (!outgoings[tid].empty()) progress(tid);
 
-        return false;
+        deque<pair<int, string>> &stash = stashes[tid];
+        if (stash.empty() && (!poll(tid) || stash.empty()))
+            return false;
+
+        src_sid = stash.front().first;
+        data = std::move(stash.front().second);
+        stash.pop_front();
+        return true;
     }
 };
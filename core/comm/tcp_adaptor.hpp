@@ -33,16 +33,21 @@
 #include <fstream>
 #include <sstream>
 
-#include <tbb/concurrent_unordered_map.h>
+#include <deque>
+#include <vector>
 
 #include "global.hpp"
 
 // utils
 #include "logger2.hpp"
 #include "assertion.hpp"
+#include "unit.hpp"
 
 using namespace std;
 
+// only the msgs smaller than it are batched (see Global::tcp_batch_size)
+#define TCP_BATCH_MSG_SZ KiB2B(4)
+
 class TCP_Adaptor {
 private:
 
@@ -52,16 +57,31 @@ private:
 
     int port_base;
 
-    typedef tbb::concurrent_unordered_map<int, zmq::socket_t *> socket_map;
-    typedef vector<zmq::socket_t *> socket_vector;
+    int pool_size;      // #sockets to each (dst_sid, dst_tid)
+
+    // A pooled socket to a destination, which is used by the sender threads
+    // with the same (tid % pool_size). Therefore, the lock is not contended
+    // if pool_size >= #sender threads.
+    struct sender_t {
+        zmq::socket_t *socket = NULL;
+        pthread_spinlock_t lock;
+
+        vector<string> batch;   // small msgs not sent yet (see flush())
+        vector<bool> dirty;     // in the flush list of each thread (#threads)
+    };
 
     // The communication over zeromq, a socket library.
-    socket_vector receivers;     // static allocation
-    socket_map senders;          // dynamic allocation
+    vector<zmq::socket_t *> receivers;  // (#threads)
+    vector<sender_t> senders;           // (#servers x #threads x pool_size), pre-connected
+
+    // the senders with batched msgs (per thread)
+    vector<vector<sender_t *>> dirties;
+
+    // the rest msgs of a batch received by a thread (per thread)
+    vector<deque<zmq::message_t *>> inboxes;
 
     zmq::context_t context;
 
-    pthread_spinlock_t *send_locks;
     pthread_spinlock_t *receive_locks;
 
     vector<string> ipset;
@@ -69,10 +89,114 @@ private:
     inline int port_code(int dst_tid) { return port_base + dst_tid; }
     inline int socket_code(int dst_sid, int dst_tid) { return dst_sid * num_threads + dst_tid; }
 
+    // the socket used by thread(tid) to send msgs to (dst_sid, dst_tid)
+    inline sender_t &sender_of(int tid, int dst_sid, int dst_tid) {
+        return senders[socket_code(dst_sid, dst_tid) * pool_size + tid % pool_size];
+    }
+
+    // the msg owns the string, which is deleted by zeromq after sent
+    static void free_string(void * /* data */, void *hint) { delete (string *)hint; }
+
+    // Send a msg (or a part of multi-part msg) by given socket w/o copy.
+    // The ownership of string is transferred to zeromq only if succeeded.
+    // NOTE: the caller should hold the lock of sender
+    bool send_part(sender_t &s, string &str, int flags) {
+        string *buf = new string(std::move(str));
+        zmq::message_t msg((void *)buf->data(), buf->length(), free_string, buf);
+        if (s.socket->send(msg, ZMQ_DONTWAIT | flags))
+            return true;
+
+        // the queue is full (EAGAIN), and other errors are thrown by zeromq
+        // take back the string (the empty one is deleted with msg)
+        str = std::move(*buf);
+        return false;
+    }
+
+    // send a batch of msgs as a multi-part msg
+    bool send_batch(sender_t &s) {
+        for (size_t i = 0; i < s.batch.size(); i++) {
+            if (!send_part(s, s.batch[i],
+                           (i < s.batch.size() - 1) ? ZMQ_SNDMORE : 0)) {
+                // only the first part fails if the queue is full (a multi-part msg is atomic)
+                ASSERT(i == 0);
+                return false;
+            }
+        }
+        s.batch.clear();
+        return true;
+    }
+
+    // receive a msg (or a part of batched msgs) of thread(tid)
+    // NOTE: the caller should hold the receive lock of thread(tid)
+    bool recv_msg(int tid, string &str, int flags) {
+        deque<zmq::message_t *> &inbox = inboxes[tid];
+        if (inbox.empty()) {
+            zmq::message_t *msg = new zmq::message_t();
+            if (!receivers[tid]->recv(msg, flags)) {
+                delete msg;
+                return false;
+            }
+            inbox.push_back(msg);
+
+            // all parts of a batch have arrived together
+            while (inbox.back()->more()) {
+                msg = new zmq::message_t();
+                bool success = receivers[tid]->recv(msg);
+                ASSERT(success);
+                inbox.push_back(msg);
+            }
+        }
+
+        zmq::message_t *msg = inbox.front();
+        inbox.pop_front();
+        str.assign((char *)msg->data(), msg->size());  // reuse the space of str
+        delete msg;
+        return true;
+    }
+
+    // send a msg (moved on success) by thread(tid), see send()
+    bool send_msg(int tid, int dst_sid, int dst_tid, string &str, bool batchable) {
+        // check parameters
+        ASSERT_MSG((dst_sid >= 0 && dst_sid < num_servers),
+                   "server ID: %d (#servers: %d)\n", dst_sid, num_servers);
+        ASSERT_MSG((dst_tid >= 0 && dst_tid < num_threads),
+                   "thread ID: %d (#threads: %d)\n", dst_tid, num_threads);
+
+        sender_t &s = sender_of(tid, dst_sid, dst_tid);
+
+        pthread_spin_lock(&s.lock);
+        if (batchable && Global::tcp_batch_size > 1 && str.length() < TCP_BATCH_MSG_SZ) {
+            s.batch.push_back(std::move(str));
+            if (!s.dirty[tid]) {
+                s.dirty[tid] = true;
+                dirties[tid].push_back(&s);
+            }
+
+            // send the batch once it is full
+            if (s.batch.size() >= (size_t)Global::tcp_batch_size)
+                send_batch(s);
+            pthread_spin_unlock(&s.lock);
+            return true;
+        }
+
+        // keep the order with the batched msgs
+        if (!s.batch.empty() && !send_batch(s)) {
+            pthread_spin_unlock(&s.lock);
+            return false;
+        }
+
+        bool result = send_part(s, str, 0);
+        pthread_spin_unlock(&s.lock);
+        return result;
+    }
+
 public:
     TCP_Adaptor(int sid, string fname, int port_base, int nsrvs, int nthds)
-        : sid(sid), port_base(port_base), context(1),
-          num_servers(nsrvs), num_threads(nthds) {
+        : sid(sid), num_servers(nsrvs), num_threads(nthds),
+          port_base(port_base),
+          pool_size(min(Global::tcp_pool_size, nthds)),
+          context(1, max(ZMQ_MAX_SOCKETS_DFLT,
+                         nthds + nsrvs * nthds * min(Global::tcp_pool_size, nthds))) {
 
         ifstream hostfile(fname);
         string ip;
@@ -87,9 +211,25 @@ public:
             receivers[tid]->bind(address);
         }
 
-        send_locks = (pthread_spinlock_t *)malloc(sizeof(pthread_spinlock_t) * num_threads);
-        for (int i = 0; i < num_threads; i++)
-            pthread_spin_init(&send_locks[i], 0);
+        // connect to all threads at startup (zeromq will re-connect in the background
+        // if the peer is not ready), instead of on-demand in the critical path
+        senders = vector<sender_t>(num_servers * num_threads * pool_size);
+        for (int dst_sid = 0; dst_sid < num_servers; dst_sid++) {
+            for (int dst_tid = 0; dst_tid < num_threads; dst_tid++) {
+                char address[32] = "";
+                snprintf(address, 32, "tcp://%s:%d", ipset[dst_sid].c_str(), port_code(dst_tid));
+                for (int i = 0; i < pool_size; i++) {
+                    sender_t &s = sender_of(i, dst_sid, dst_tid);
+                    s.socket = new zmq::socket_t(context, ZMQ_PUSH);
+                    s.socket->connect(address);
+                    s.dirty.resize(num_threads, false);
+                    pthread_spin_init(&s.lock, 0);
+                }
+            }
+        }
+
+        dirties.resize(num_threads);
+        inboxes.resize(num_threads);
 
         receive_locks = (pthread_spinlock_t *)malloc(sizeof(pthread_spinlock_t) * num_threads);
         for (int i = 0; i < num_threads; i++)
@@ -101,67 +241,79 @@ public:
             if (r != NULL) delete r;
 
         for (auto &s : senders) {
-            if (s.second != NULL) {
-                delete s.second;
-                s.second = NULL;
+            if (s.socket != NULL) {
+                delete s.socket;
+                s.socket = NULL;
             }
         }
+
+        for (auto &inbox : inboxes)
+            for (auto msg : inbox)
+                delete msg;
     }
 
     string ip_of(int dst_sid) { return ipset[dst_sid]; }
 
-    bool send(int dst_sid, int dst_tid, const string &str) {
-        // check parameters
-        ASSERT_MSG((dst_sid >= 0 && dst_sid < num_servers),
-                   "server ID: %d (#servers: %d)\n", dst_sid, num_servers);
-        ASSERT_MSG((dst_tid >= 0 && dst_tid < num_threads),
-                   "thread ID: %d (#threads: %d)\n", dst_tid, num_threads);
-
-        int pid = port_code(dst_tid);
-        int id = socket_code(dst_sid, dst_tid); // socket id
+    // Send given string to (dst_sid, dst_tid) by thread(tid)
+    // The ownership of string is transferred to zeromq w/o copy (zero-copy).
+    // The small msgs may be batched until flush() if Global::tcp_batch_size > 1.
+    bool send(int tid, int dst_sid, int dst_tid, string &&str) {
+        return send_msg(tid, dst_sid, dst_tid, str, true);
+    }
 
-        zmq::message_t msg(str.length());
-        memcpy((void *)msg.data(), str.c_str(), str.length());
+    bool send(int tid, int dst_sid, int dst_tid, const string &str) {
+        string copy(str);
+        return send_msg(tid, dst_sid, dst_tid, copy, true);
+    }
 
-        // avoid two contentions
-        // 1) add the 'equal' sockets to the set (overwrite)
-        // 2) use the same socket by multiple proxy threads simultaneously.
-        pthread_spin_lock(&send_locks[dst_tid]);
-        if (senders.find(id) == senders.end()) {
-            // new socket on-demand
-            char address[32] = "";
-            snprintf(address, 32, "tcp://%s:%d", ipset[dst_sid].c_str(), pid);
-            senders[id] = new zmq::socket_t(context, ZMQ_PUSH);
-            senders[id]->connect(address);
-        }
+    // send w/o the ID of sender thread (e.g., control msgs), which is never batched
+    bool send(int dst_sid, int dst_tid, const string &str) {
+        string copy(str);
+        return send_msg(0, dst_sid, dst_tid, copy, false);
+    }
 
-        int result = senders[id]->send(msg, ZMQ_DONTWAIT);
-        if (result < 0) {
-            logstream(LOG_ERROR) << "failed to send msg to ["
-                                 << dst_sid << ", " << dst_tid << "] "
-                                 << strerror(errno) << LOG_endl;
+    // Send the batched msgs by thread(tid), which is called by recv() and tryrecv()
+    // of the thread. The batch failed to send is kept to retry in the next time.
+    // NOTE: a batch shared by threads (pooled sender) is flushed by any of them
+    //       that has batched msgs, so it never waits for the first one to poll.
+    // Return true if all batched msgs have been sent.
+    bool flush(int tid) {
+        vector<sender_t *> &dirty = dirties[tid];
+        for (size_t i = 0; i < dirty.size();) {
+            sender_t &s = *dirty[i];
+
+            pthread_spin_lock(&s.lock);
+            if (s.batch.empty() || send_batch(s)) {
+                s.dirty[tid] = false;
+                dirty[i] = dirty.back();
+                dirty.pop_back();
+            } else {
+                i++;
+            }
+            pthread_spin_unlock(&s.lock);
         }
-        pthread_spin_unlock(&send_locks[dst_tid]);
-
-        return result;
+        return dirty.empty();
     }
 
     string recv(int tid) {
         ASSERT_MSG((tid >= 0 && tid < num_threads),
                    "thread ID: %d (#threads: %d)\n", tid, num_threads);
 
-        zmq::message_t msg;
+        // keep sending the batched msgs until recv a msg
+        string str;
+        while (!dirties[tid].empty())
+            if (tryrecv(tid, str)) return str;
 
         // multiple engine threads may recv the same msg simultaneously (no case)
         pthread_spin_lock(&receive_locks[tid]);
-        if (receivers[tid]->recv(&msg) < 0) {
+        if (!recv_msg(tid, str, 0)) {
             logstream(LOG_ERROR) << "failed to recv msg ("
                                  << strerror(errno) << ")" << LOG_endl;
             assert(false);
         }
         pthread_spin_unlock(&receive_locks[tid]);
 
-        return string((char *)msg.data(), msg.size());
+        return str;
     }
 
 
@@ -176,14 +328,14 @@ public:
         ASSERT_MSG((tid >= 0 && tid < num_threads),
                    "thread ID: %d (#threads: %d)\n", tid, num_threads);
 
-        zmq::message_t msg;
+        if (!dirties[tid].empty()) flush(tid);
+
         bool success = false;
 
         // multiple engine threads may recv the same msg simultaneously
         // (work-stealing is the only case now)
         pthread_spin_lock(&receive_locks[tid]);
-        if (success = receivers[tid]->recv(&msg, ZMQ_NOBLOCK))
-            str = string((char *)msg.data(), msg.size());
+        success = recv_msg(tid, str, ZMQ_NOBLOCK);
         pthread_spin_unlock(&receive_locks[tid]);
 
         return success;
@@ -60,18 +60,33 @@ static bool set_immutable_config(string cfg_name, string value)
         // force a "/" at the end of Global::input_folder.
         if (Global::input_folder[Global::input_folder.length() - 1] != '/')
             Global::input_folder = Global::input_folder + "/";
+    } else if (cfg_name == "global_partition_file") {
+        Global::partition_file = value;
+    } else if (cfg_name == "global_hot_vertex_degree") {
+        Global::hot_vertex_degree = atoi(value.c_str());
+        ASSERT(Global::hot_vertex_degree >= 0);
     } else if (cfg_name == "global_data_port_base") {
         Global::data_port_base = atoi(value.c_str());
         ASSERT(Global::data_port_base > 0);
     } else if (cfg_name == "global_ctrl_port_base") {
         Global::ctrl_port_base = atoi(value.c_str());
         ASSERT(Global::ctrl_port_base > 0);
+    } else if (cfg_name == "global_tcp_pool_size") {
+        Global::tcp_pool_size = atoi(value.c_str());
+        ASSERT(Global::tcp_pool_size > 0);
+    } else if (cfg_name == "global_metrics_port") {
+        Global::metrics_port = atoi(value.c_str());
+        ASSERT(Global::metrics_port >= 0 && Global::metrics_port < 65536);
     } else if (cfg_name == "global_memstore_size_gb") {
         Global::memstore_size_gb = atoi(value.c_str());
         ASSERT(Global::memstore_size_gb > 0);
     } else if (cfg_name == "global_est_load_factor") {
         Global::est_load_factor = atoi(value.c_str());
         ASSERT(Global::est_load_factor > 0 && Global::est_load_factor < 100);
+    } else if (cfg_name == "global_compress_index") {
+        Global::compress_index = atoi(value.c_str());
+    } else if (cfg_name == "global_enable_bitmap_index") {
+        Global::enable_bitmap_index = atoi(value.c_str());
     } else if (cfg_name == "global_rdma_buf_size_mb") {
         if (RDMA::get_rdma().has_rdma())
             Global::rdma_buf_size_mb = atoi(value.c_str());
@@ -86,6 +101,9 @@ static bool set_immutable_config(string cfg_name, string value)
         ASSERT(Global::rdma_rbf_size_mb >= 0);
     } else if (cfg_name == "global_generate_statistics") {
         Global::generate_statistics = atoi(value.c_str());
+    } else if (cfg_name == "global_stat_sample_ratio") {
+        Global::stat_sample_ratio = atoi(value.c_str());
+        ASSERT(Global::stat_sample_ratio >= 1);
     } else if (cfg_name == "global_num_gpus") {
         Global::num_gpus = atoi(value.c_str());
     } else if (cfg_name == "global_gpu_rdma_buf_size_mb") {
@@ -126,6 +144,14 @@ static bool set_mutable_config(string cfg_name, string value)
         }
     } else if (cfg_name == "global_rdma_threshold") {
         Global::rdma_threshold = atoi(value.c_str());
+    } else if (cfg_name == "global_enable_local_shortcut") {
+        Global::enable_local_shortcut = atoi(value.c_str());
+    } else if (cfg_name == "global_msg_batch_size") {
+        Global::msg_batch_size = atoi(value.c_str());
+        ASSERT(Global::msg_batch_size > 0);
+    } else if (cfg_name == "global_tcp_batch_size") {
+        Global::tcp_batch_size = atoi(value.c_str());
+        ASSERT(Global::tcp_batch_size > 0);
     } else if (cfg_name == "global_mt_threshold") {
         Global::mt_threshold = atoi(value.c_str());
         ASSERT(Global::mt_threshold > 0);
@@ -139,10 +165,26 @@ static bool set_mutable_config(string cfg_name, string value)
         Global::silent = atoi(value.c_str());
     } else if (cfg_name == "global_enable_planner") {
         Global::enable_planner = atoi(value.c_str());
+    } else if (cfg_name == "global_enable_plan_cache") {
+        Global::enable_plan_cache = atoi(value.c_str());
+    } else if (cfg_name == "global_plan_replan_factor") {
+        Global::plan_replan_factor = atoi(value.c_str());
+        ASSERT(Global::plan_replan_factor >= 1);
+    } else if (cfg_name == "global_plan_feedback_size") {
+        Global::plan_feedback_size = atoi(value.c_str());
+        ASSERT(Global::plan_feedback_size >= 0);
+    } else if (cfg_name == "global_incremental_stats") {
+        Global::incremental_stats = atoi(value.c_str());
     } else if (cfg_name == "global_enable_vattr") {
         Global::enable_vattr = atoi(value.c_str());
     } else if (cfg_name == "global_gpu_enable_pipeline") {
         Global::gpu_enable_pipeline = atoi(value.c_str());
+    } else if (cfg_name == "global_query_timeout_ms") {
+        Global::query_timeout_ms = atoi(value.c_str());
+        ASSERT(Global::query_timeout_ms >= 0);
+    } else if (cfg_name == "global_result_cache_size_mb") {
+        Global::result_cache_size_mb = atoi(value.c_str());
+        ASSERT(Global::result_cache_size_mb >= 0);
     } else {
         return false;
     }
@@ -247,10 +289,17 @@ void print_config(void)
     cout << "the number of proxies: "        << Global::num_proxies           << LOG_endl;
     cout << "the number of engines: "        << Global::num_engines           << LOG_endl;
     cout << "global_input_folder: "          << Global::input_folder          << LOG_endl;
+    cout << "global_partition_file: "        << (Global::partition_file.empty() ? "(hash)" : Global::partition_file) << LOG_endl;
+    cout << "global_hot_vertex_degree: "     << Global::hot_vertex_degree     << LOG_endl;
     cout << "global_memstore_size_gb: "      << Global::memstore_size_gb      << LOG_endl;
     cout << "global_est_load_factor: "       << Global::est_load_factor       << LOG_endl;
+    cout << "global_compress_index: "        << Global::compress_index        << LOG_endl;
+    cout << "global_enable_bitmap_index: "   << Global::enable_bitmap_index   << LOG_endl;
     cout << "global_data_port_base: "        << Global::data_port_base        << LOG_endl;
     cout << "global_ctrl_port_base: "        << Global::ctrl_port_base        << LOG_endl;
+    cout << "global_tcp_pool_size: "         << Global::tcp_pool_size         << LOG_endl;
+    cout << "global_tcp_batch_size: "        << Global::tcp_batch_size        << LOG_endl;
+    cout << "global_metrics_port: "          << Global::metrics_port          << LOG_endl;
     cout << "global_rdma_buf_size_mb: "      << Global::rdma_buf_size_mb      << LOG_endl;
     cout << "global_rdma_rbf_size_mb: "      << Global::rdma_rbf_size_mb      << LOG_endl;
     cout << "global_use_rdma: "              << Global::use_rdma              << LOG_endl;
@@ -258,11 +307,20 @@ void print_config(void)
     cout << "global_enable_workstealing: "   << Global::enable_workstealing   << LOG_endl;
     cout << "global_stealing_pattern: "      << Global::stealing_pattern      << LOG_endl;
     cout << "global_rdma_threshold: "        << Global::rdma_threshold        << LOG_endl;
+    cout << "global_enable_local_shortcut: " << Global::enable_local_shortcut << LOG_endl;
+    cout << "global_msg_batch_size: "        << Global::msg_batch_size        << LOG_endl;
     cout << "global_mt_threshold: "          << Global::mt_threshold          << LOG_endl;
     cout << "global_silent: "                << Global::silent                << LOG_endl;
     cout << "global_enable_planner: "        << Global::enable_planner        << LOG_endl;
     cout << "global_generate_statistics: "   << Global::generate_statistics   << LOG_endl;
+    cout << "global_stat_sample_ratio: "     << Global::stat_sample_ratio     << LOG_endl;
+    cout << "global_enable_plan_cache: "     << Global::enable_plan_cache     << LOG_endl;
+    cout << "global_plan_replan_factor: "    << Global::plan_replan_factor    << LOG_endl;
+    cout << "global_plan_feedback_size: "    << Global::plan_feedback_size    << LOG_endl;
+    cout << "global_incremental_stats: "     << Global::incremental_stats     << LOG_endl;
     cout << "global_enable_vattr: "          << Global::enable_vattr          << LOG_endl;
+    cout << "global_query_timeout_ms: "      << Global::query_timeout_ms      << LOG_endl;
+    cout << "global_result_cache_size_mb: "  << Global::result_cache_size_mb  << LOG_endl;
     cout << "global_num_gpus: "              << Global::num_gpus              << LOG_endl;
     cout << "global_gpu_rdma_buf_size_mb: "  << Global::gpu_rdma_buf_size_mb  << LOG_endl;
     cout << "global_gpu_rbuf_size_mb: "      << Global::gpu_rbuf_size_mb      << LOG_endl;
@@ -37,6 +37,7 @@
 #include "errors.hpp"
 #include "proxy.hpp"
 #include "monitor.hpp"
+#include "metrics.hpp"
 
 using namespace std;
 using namespace boost;
@@ -106,6 +107,7 @@ options_description       load_desc("load <args>         load RDF data into dyna
 options_description       gsck_desc("gsck <args>         check the integrity of (in-memmory) graph storage");
 options_description  load_stat_desc("load-stat           load statistics of SPARQL query optimizer");
 options_description store_stat_desc("store-stat          store statistics of SPARQL query optimizer");
+options_description      stats_desc("stats <args>        print the metrics of all servers");
 
 
 /*
@@ -148,6 +150,7 @@ void init_options_desc()
     (",v", value<int>()->default_value(0)->value_name("<lines>"), "print at most <lines> of results")
     (",o", value<string>()->value_name("<fname>"), "output results into <fname>")
     (",g", "leverage GPU to accelerate heavy query processing ")
+    (",a", "print the execution profile of the (last) query, i.e., EXPLAIN ANALYZE")
     (",b", value<string>()->value_name("<fname>"), "run a [batch] of SPARQL queries configured by <fname>")
     ("help,h", "help message about sparql")
     ;
@@ -160,6 +163,10 @@ void init_options_desc()
     (",d", value<int>()->default_value(10)->value_name("<sec>"), "eval <sec> seconds (default: 10)")
     (",w", value<int>()->default_value(5)->value_name("<sec>"), "warmup <sec> seconds (default: 5)")
     (",n", value<int>()->default_value(20)->value_name("<num>"), "keep <num> queries being processed (default: 20)")
+    (",o", value<string>()->value_name("<fname>"), "output latency statistics into <fname> (CSV, or JSON if ends with .json)")
+    (",r", value<double>()->value_name("<qps>"), "send queries open-loop at <qps> queries/sec in total")
+    (",a", value<string>()->default_value("poisson")->value_name("<dist>"), "inter-arrival times of open-loop: poisson or const (default: poisson)")
+    (",s", value<int>()->value_name("<usec>"), "sweep the rate from <qps> to find the saturation throughput with p99 <= <usec>")
     ("help,h", "help message about sparql-emu")
     ;
     all_desc.add(sparql_emu_desc);
@@ -193,6 +200,14 @@ void init_options_desc()
     ("help,h", "help message about store-stat")
     ;
     all_desc.add(store_stat_desc);
+
+    // e.g., wukong> stats <args>
+    stats_desc.add_options()
+    (",p", "print in Prometheus text format (w/ HELP and TYPE lines)")
+    (",o", value<string>()->value_name("<fname>"), "output the metrics into <fname>")
+    ("help,h", "help message about stats")
+    ;
+    all_desc.add(stats_desc);
 }
 
 
@@ -414,6 +429,7 @@ static void run_logger(Proxy *proxy, int argc, char **argv)
  *   -v <lines>   print at most <lines> of results
  *   -o <fname>   output results into <fname>
  *   -g           leverage GPU to accelerate heavy query processing
+ *   -a           print the execution profile of the (last) query (EXPLAIN ANALYZE)
  *
  * sparql -b <fname>
  */
@@ -519,12 +535,15 @@ static void run_sparql(Proxy * proxy, int argc, char **argv)
         }
 #endif
 
+        // option: -a
+        bool analyze = sparql_vm.count("-a");
+
         /// do sparql
         SPARQLQuery reply;
         Monitor monitor;
         try {
             proxy->run_single_query(ifs, fmt_stream, nopts, mfactor, snd2gpu,
-                                    cnt, nlines, ofname, reply, monitor);
+                                    cnt, nlines, ofname, reply, monitor, analyze);
         } catch (WukongException &ex) {
             logstream(LOG_ERROR) << "Query failed [ERRNO " << ex.code()
                                  << "]: " << ex.what() << LOG_endl;
@@ -576,6 +595,10 @@ static void run_sparql(Proxy * proxy, int argc, char **argv)
  *   -d <sec>   eval <sec> seconds (default: 10)
  *   -w <sec>   warmup <sec> seconds (default: 5)
  *   -p <num>   send <num> queries in parallel (default: 20)
+ *   -o <fname> output latency statistics into <fname> (CSV or JSON)
+ *   -r <qps>   send queries open-loop at <qps> queries/sec in total
+ *   -a <dist>  inter-arrival times of open-loop: poisson or const (default: poisson)
+ *   -s <usec>  sweep the rate to find the saturation throughput with p99 <= <usec>
  */
 static void run_sparql_emu(Proxy * proxy, int argc, char **argv)
 {
@@ -619,13 +642,10 @@ static void run_sparql_emu(Proxy * proxy, int argc, char **argv)
         }
     }
 
-    ifstream fmt_stream;
-    if (Global::enable_planner) {
-        fmt_stream.setstate(std::ios::failbit);
-    } else {
-        string fmt_fname = sparql_emu_vm["-p"].as<string>();
-        fmt_stream.open(fmt_fname);
-        if (!fmt_stream.good()) { // fail to load user-defined plan file
+    string fmt_fname;
+    if (!Global::enable_planner) {
+        fmt_fname = sparql_emu_vm["-p"].as<string>();
+        if (!ifstream(fmt_fname).good()) { // fail to load user-defined plan file
             logstream(LOG_ERROR) << "The plan file is not found: "
                                  << fmt_fname << LOG_endl;
             fail_to_parse(proxy, argc, argv); // invalid cmd
@@ -634,18 +654,18 @@ static void run_sparql_emu(Proxy * proxy, int argc, char **argv)
     }
 
     // config file for the SPARQL emulator
-    ifstream ifs(fname);
-    if (!ifs.good()) {
+    if (!ifstream(fname).good()) {
         logstream(LOG_ERROR) << "Configure file not found: " << fname << LOG_endl;
         fail_to_parse(proxy, argc, argv);
         return;
     }
 
     // NOTE: the option with default_value is always available
-    // default value: duration(10), warmup(5), otf(20)
+    // default value: duration(10), warmup(5), otf(20), arrival(poisson)
     int duration = sparql_emu_vm["-d"].as<int>();
     int warmup = sparql_emu_vm["-w"].as<int>();
     int otf = sparql_emu_vm["-n"].as<int>(); // the number of queries being processed (on the fly)
+    string arrival = sparql_emu_vm["-a"].as<string>();
 
     if (duration <= 0 || warmup < 0 || otf <= 0) {
         logstream(LOG_ERROR) << "invalid parameters for SPARQL emulator! "
@@ -663,32 +683,108 @@ static void run_sparql_emu(Proxy * proxy, int argc, char **argv)
         return;
     }
 
-
-    /// do sparql-emu
-    Monitor monitor;
-    int ret = proxy->run_query_emu(ifs, fmt_stream, duration, warmup, otf, monitor);
-    if (ret != 0) {
-        logstream(LOG_ERROR) << "Failed to run the query emulator (ERRNO: " << ret << ")!" << LOG_endl;
+    // option: -r <qps> (open-loop), -a <dist> and -s <usec> (rate sweep)
+    double rate = sparql_emu_vm.count("-r") ? sparql_emu_vm["-r"].as<double>() : 0;
+    int slo = sparql_emu_vm.count("-s") ? sparql_emu_vm["-s"].as<int>() : 0;
+    if (rate < 0 || slo < 0 || (slo > 0 && rate == 0)
+            || (arrival != "poisson" && arrival != "const")) {
+        logstream(LOG_ERROR) << "invalid parameters for open-loop SPARQL emulator! "
+                             << "(rate=" << rate << ", arrival=" << arrival
+                             << ", slo=" << slo << ")" << LOG_endl;
         fail_to_parse(proxy, argc, argv); // invalid cmd
         return;
     }
 
-    // FIXME: maybe hang in here if the input file misses in some machines
-    //        or inconsistent global variables (e.g., global_enable_planner)
-    console_barrier(proxy->tid);
+    // the rate sweep increases the offered load step by step until the p99 latency
+    // exceeds the SLO, and reports the max throughput within the SLO (saturation)
+    const double SWEEP_STEP = 1.2;
+    const int SWEEP_MAX_STEPS = 32;
+    int nclients = Global::num_servers * Global::num_proxies;
+    float sat_thpt = 0.0;
+    double sat_rate = 0.0;
 
-    // aggregate and print performance statistics for running emulators on all servers
-    if (MASTER(proxy)) {
-        for (int i = 1; i < Global::num_servers * Global::num_proxies; i++) {
-            Monitor other = console_recv<Monitor>(proxy->tid);
-            monitor.merge(other);
+    for (int step = 0; step < SWEEP_MAX_STEPS; step++) {
+        ifstream ifs(fname);
+        ifstream fmt_stream;
+        if (Global::enable_planner)
+            fmt_stream.setstate(std::ios::failbit);
+        else
+            fmt_stream.open(fmt_fname);
+
+        if (MASTER(proxy) && rate > 0)
+            logstream(LOG_INFO) << "Open-loop: offered load " << rate / 1000.0
+                                << "K queries/sec (" << arrival << " arrivals)" << LOG_endl;
+
+        /// do sparql-emu
+        Monitor monitor;
+        int ret = proxy->run_query_emu(ifs, fmt_stream, duration, warmup, otf, monitor,
+                                       rate / nclients, arrival == "poisson");
+        if (ret != 0) {
+            logstream(LOG_ERROR) << "Failed to run the query emulator (ERRNO: " << ret << ")!" << LOG_endl;
+            fail_to_parse(proxy, argc, argv); // invalid cmd
+            return;
         }
-        monitor.aggregate();
-        monitor.print_cdf();
-        monitor.print_thpt();
-    } else {
-        // send logs to the master proxy
-        console_send<Monitor>(0, 0, monitor);
+
+        // FIXME: maybe hang in here if the input file misses in some machines
+        //        or inconsistent global variables (e.g., global_enable_planner)
+        console_barrier(proxy->tid);
+
+        // aggregate and print performance statistics for running emulators on all servers
+        bool next = false;
+        if (MASTER(proxy)) {
+            for (int i = 1; i < nclients; i++) {
+                Monitor other = console_recv<Monitor>(proxy->tid);
+                monitor.merge(other);
+            }
+            monitor.print_cdf();
+            monitor.print_thpt();
+            monitor.print_cancelled();
+            monitor.print_plan_time();
+
+            // option: -o <fname> (a file per step for rate sweep)
+            if (sparql_emu_vm.count("-o")) {
+                string ofname = sparql_emu_vm["-o"].as<string>();
+                if (slo > 0) ofname += "." + to_string(step);
+                if (monitor.dump_latency(ofname))
+                    logstream(LOG_INFO) << "Latency statistics are output into " << ofname << LOG_endl;
+            }
+
+            if (slo > 0) {
+                uint64_t p99 = monitor.get_latency(0.99);
+                logstream(LOG_INFO) << "Rate sweep (step " << step << "): offered "
+                                    << rate / 1000.0 << "K queries/sec, achieved "
+                                    << monitor.get_thpt() / 1000.0 << "K queries/sec, p99 "
+                                    << p99 << " usec (SLO " << slo << " usec)" << LOG_endl;
+                if (p99 <= (uint64_t)slo) {
+                    sat_thpt = max(sat_thpt, monitor.get_thpt());
+                    sat_rate = rate;
+                    next = true;
+                }
+            }
+
+            // tell all emulators whether to go on
+            for (int i = 0; i < Global::num_servers; i++)
+                for (int j = 0; j < Global::num_proxies; j++)
+                    if (i != 0 || j != 0)
+                        console_send<bool>(i, j, next);
+        } else {
+            // send logs to the master proxy
+            console_send<Monitor>(0, 0, monitor);
+            next = console_recv<bool>(proxy->tid);
+        }
+
+        if (!next) break;
+        rate *= SWEEP_STEP;
+    }
+
+    if (MASTER(proxy) && slo > 0) {
+        if (sat_rate > 0)
+            logstream(LOG_INFO) << "Saturation throughput (p99 <= " << slo << " usec): "
+                                << sat_thpt / 1000.0 << "K queries/sec (offered "
+                                << sat_rate / 1000.0 << "K queries/sec)" << LOG_endl;
+        else
+            logstream(LOG_INFO) << "The p99 latency exceeds the SLO (" << slo
+                                << " usec) even at the initial rate" << LOG_endl;
     }
 }
 
@@ -700,8 +796,9 @@ static void run_sparql_emu(Proxy * proxy, int argc, char **argv)
  */
 static void run_load(Proxy * proxy, int argc, char **argv)
 {
-    // use the master proxy thread to dyanmically load RDF data
-    if (!MASTER(proxy))
+    // use the master proxy thread to dyanmically load RDF data,
+    // and the leader proxy thread on each server to update statistics
+    if (!LEADER(proxy))
         return;
 
 #ifdef DYNAMIC_GSTORE
@@ -736,19 +833,32 @@ static void run_load(Proxy * proxy, int argc, char **argv)
     if (dname[dname.length() - 1] != '/')
         dname = dname + "/"; // force a "/" at the end of dname.
 
-    Monitor monitor;
-    RDFLoad reply;
-    //FIXME: the dynamic_load_data will exit if the directory is not exist
-    int ret = proxy->dynamic_load_data(dname, reply, monitor, c_enable);
-    if (ret != 0) {
-        logstream(LOG_ERROR) << "Failed to load dynamic data from directory " << dname
-                             << " (ERRNO: " << ret << ")!" << LOG_endl;
-        return;
+    if (MASTER(proxy)) {
+        Monitor monitor;
+        RDFLoad reply;
+        //FIXME: the dynamic_load_data will exit if the directory is not exist
+        int ret = proxy->dynamic_load_data(dname, reply, monitor, c_enable);
+        if (ret != 0)
+            logstream(LOG_ERROR) << "Failed to load dynamic data from directory " << dname
+                                 << " (ERRNO: " << ret << ")!" << LOG_endl;
+        else
+            monitor.print_latency();
+
+        // the loading is finished on all servers
+        for (int i = 1; i < Global::num_servers; i++)
+            console_send<int>(i, 0, ret);
+    } else {
+        console_recv<int>(proxy->tid);
     }
-    monitor.print_latency();
+
+    // update statistics by the triples loaded (even partially) on all servers
+    proxy->stats->update_stat(static_cast<DynamicGStore *>(proxy->graph->gstore),
+                              proxy->tid, con_adaptor);
 #else
-    logstream(LOG_ERROR) << "Can't load data into static graph store." << LOG_endl;
-    logstream(LOG_ERROR) << "You can enable it by building Wukong with -DUSE_DYNAMIC_GSTORE=ON." << LOG_endl;
+    if (MASTER(proxy)) {
+        logstream(LOG_ERROR) << "Can't load data into static graph store." << LOG_endl;
+        logstream(LOG_ERROR) << "You can enable it by building Wukong with -DUSE_DYNAMIC_GSTORE=ON." << LOG_endl;
+    }
 #endif
 }
 
@@ -886,6 +996,63 @@ static void run_store_stat(Proxy *proxy, int argc, char **argv)
     proxy->stats->store_stat_to_file(fname);
 }
 
+/**
+ * run the 'stats' command
+ * usage:
+ * stats [options]
+ *   -p          print in Prometheus text format (w/ HELP and TYPE lines)
+ *   -o <fname>  output the metrics into <fname>
+ */
+static void run_stats(Proxy *proxy, int argc, char **argv)
+{
+    // use the leader proxy thread on each server to collect its metrics
+    if (!LEADER(proxy))
+        return;
+
+    // parse command
+    variables_map stats_vm;
+    try {
+        store(parse_command_line(argc, argv, stats_desc), stats_vm);
+    } catch (...) {
+        fail_to_parse(proxy, argc, argv);
+        return;
+    }
+    notify(stats_vm);
+
+    // parse options
+    if (stats_vm.count("help")) {
+        if (MASTER(proxy))
+            cout << stats_desc;
+        return;
+    }
+
+    /// do stats
+    bool help = stats_vm.count("-p");
+    string text = Metrics::get_metrics().export_text(proxy->sid, help);
+    if (!MASTER(proxy)) {
+        console_send<string>(0, 0, text);
+        return;
+    }
+
+    // the metrics are labelled by server, so the order doesn't matter
+    for (int i = 1; i < Global::num_servers; i++)
+        text += console_recv<string>(proxy->tid);
+
+    if (stats_vm.count("-o")) {
+        string fname = stats_vm["-o"].as<string>();
+        ofstream ofs(fname.c_str());
+        if (!ofs.good()) {
+            logstream(LOG_ERROR) << "Can't open/create output file: " << fname << LOG_endl;
+            return;
+        }
+        ofs << text;
+        logstream(LOG_INFO) << "Metrics of " << Global::num_servers
+                            << " servers are stored in " << fname << LOG_endl;
+    } else {
+        cout << text;
+    }
+}
+
 /**
  * The Wukong's console is co-located with the main proxy (the 1st proxy thread on the 1st server)
  * and provide a simple interactive cmdline to tester
@@ -978,6 +1145,8 @@ void run_console(Proxy *proxy)
                 run_load_stat(proxy, argc, argv);
             } else if (cmd_type == "store-stat") {
                 run_store_stat(proxy, argc, argv);
+            } else if (cmd_type == "stats") {
+                run_stats(proxy, argc, argv);
             } else {
                 // the same invalid command dispatch to all proxies, print error
                 // msg once
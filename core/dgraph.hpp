@@ -45,6 +45,16 @@ private:
     BaseLoader *loader;
     GChecker *checker;
 
+    void create_gstore(Mem *mem, StringServer *str_server) {
+#ifdef DYNAMIC_GSTORE
+        gstore = new DynamicGStore(sid, mem);
+        dynamic_loader = new DynamicLoader(sid, str_server, static_cast<DynamicGStore *>(gstore));
+#else
+        gstore = new StaticGStore(sid, mem);
+#endif
+        checker = new GChecker(gstore);
+    }
+
 
 public:
     GStore *gstore;
@@ -53,13 +63,7 @@ public:
 #endif
 
     DGraph(int sid, Mem *mem, StringServer *str_server, string dname): sid(sid) {
-#ifdef DYNAMIC_GSTORE
-        gstore = new DynamicGStore(sid, mem);
-        dynamic_loader = new DynamicLoader(sid, str_server, static_cast<DynamicGStore *>(gstore));
-#else
-        gstore = new StaticGStore(sid, mem);
-#endif
-        checker = new GChecker(gstore);
+        create_gstore(mem, str_server);
         //load from hdfs or posix file
         if (boost::starts_with(dname, "hdfs:"))
             loader = new HDFSLoader(sid, mem, str_server, gstore);
@@ -90,6 +94,27 @@ public:
         gstore->print_mem_usage();
     }
 
+    /**
+     * build the RDF graph from the triples in memory (e.g., generated by benchmarks),
+     * which are partitioned and sorted per engine as the loader does
+     * @num_normal_preds: the number of predicates and types w/o PREDICATE_ID
+     */
+    DGraph(int sid, Mem *mem, StringServer *str_server, int num_normal_preds,
+           vector<vector<triple_t>> &triple_pso, vector<vector<triple_t>> &triple_pos,
+           vector<vector<triple_attr_t>> &triple_sav): sid(sid), loader(NULL) {
+        create_gstore(mem, str_server);
+        gstore->num_normal_preds = num_normal_preds;
+
+        uint64_t start = timer::get_usec();
+        gstore->refresh();
+        gstore->init(triple_pso, triple_pos, triple_sav);
+        uint64_t end = timer::get_usec();
+        logstream(LOG_INFO) << "#" << sid << ": " << (end - start) / 1000 << "ms "
+                            << "for initializing gstore." << LOG_endl;
+
+        print_graph_stat();
+    }
+
     ~DGraph() {
         delete gstore;
         delete checker;
@@ -111,6 +136,20 @@ public:
         return gstore->get_edges(tid, 0, pid, d, sz);
     }
 
+    access_stats_t &get_access_stats(int tid) {
+        return gstore->get_access_stats(tid);
+    }
+
+    // return NULL if the index is not compressed
+    const PackedList *get_packed_index(sid_t pid, dir_t d) {
+        return gstore->get_packed_index(pid, d);
+    }
+
+    // return NULL if the index has no bitmap
+    const Bitmap *get_bitmap_index(sid_t pid, dir_t d) {
+        return gstore->get_bitmap_index(pid, d);
+    }
+
     // return attribute value (has_value == true)
     attr_t get_attr(int tid, sid_t vid, sid_t pid, dir_t d, bool &has_value) {
         uint64_t sz = 0;
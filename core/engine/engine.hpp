@@ -27,6 +27,7 @@
 #include <regex>
 
 #include "global.hpp"
+#include "metrics.hpp"
 #include "type.hpp"
 #include "coder.hpp"
 #include "dgraph.hpp"
@@ -58,13 +59,27 @@ std::vector<Engine *> engines;
 
 class Engine {
 private:
+    // run a (sub-)query and account its execution time
+    void execute_sparql(SPARQLQuery &r) {
+        uint64_t start = timer::get_usec();
+        sparql->execute_sparql_query(r);
+        uint64_t usec = timer::get_usec() - start;
+
+        Metrics &metrics = Metrics::get_metrics();
+        metrics.inc(tid, ENGINE_BUSY_USEC, usec);
+        metrics.inc(tid, ENGINE_QUERIES);
+        metrics.record_exec(tid, usec);
+    }
+
     void execute(Bundle &bundle) {
         if (bundle.type == SPARQL_QUERY) {
             SPARQLQuery r = bundle.get_sparql_query();
-            sparql->execute_sparql_query(r);
+            execute_sparql(r);
         } else if (bundle.type == GSTORE_CHECK) {
             GStoreCheck r = bundle.get_gstore_check();
             rdf->execute_gstore_check(r);
+        } else if (bundle.type == SPARQL_CANCEL) {
+            sparql->cancel_query(bundle.get_cancel_qid());
 #ifdef DYNAMIC_GSTORE
         } else if (bundle.type == DYNAMIC_LOAD) {
             RDFLoad r = bundle.get_rdf_load();
@@ -75,6 +90,23 @@ private:
         }
     }
 
+    // dispatch the queries of a batch to the engines on this server
+    void unpack_batch(Bundle &bundle) {
+        SPARQLBatch batch = bundle.get_sparql_batch();
+        for (int i = 0; i < batch.size(); i++) {
+            if (batch.tids[i] != tid) {
+                msgr->send_msg(batch.take(i), sid, batch.tids[i]);
+                continue;
+            }
+
+            SPARQLQuery req = batch.take(i);
+            if (req.priority != 0)
+                sparql->prior_stage.push(req);
+            else
+                runqueue.push(req);
+        }
+    }
+
     int next_to_oblige(int own_id, int offset) {
         if (Global::stealing_pattern == 0) { // pair stealing
             if (offset == 1)
@@ -115,6 +147,18 @@ public:
         msgr = new Messenger(sid, tid, adaptor);
         sparql = new SPARQLEngine(sid, tid, str_server, graph, coder, msgr);
         rdf = new RDFEngine(sid, tid, graph, coder, msgr);
+
+        // the queue depths of all engines are summed up
+        Metrics &metrics = Metrics::get_metrics();
+        metrics.add_collector("wukong_engine_runqueue_depth",
+                              "The number of queries waiting in the runqueues of engines.", false,
+                              [this]() { return (double)runqueue.unsafe_size(); });
+        metrics.add_collector("wukong_engine_prior_stage_depth",
+                              "The number of sub-queries waiting in the priority stages of engines.", false,
+                              [this]() { return (double)sparql->prior_stage.unsafe_size(); });
+        metrics.add_collector("wukong_msgr_pending_msgs",
+                              "The number of msgs pending to be sent by engines.", false,
+                              [this]() { return (double)msgr->pending_size(); });
     }
 
     void run() {
@@ -135,6 +179,9 @@ public:
         while (true) {
             at_work = false;
 
+            // quiescent point: no edges of replicas are held between queries
+            graph->gstore->replicas.quiesce(tid);
+
             // check and send pending messages first
             msgr->sweep_msgs();
 
@@ -143,24 +190,37 @@ public:
             at_work = sparql->prior_stage.try_pop(req);
             if (at_work) {
                 reset_snooze(at_work, last_time);
-                sparql->execute_sparql_query(req);
+                execute_sparql(req);
                 continue; // exhaust all queries
             }
 
             // normal path: own runqueue
+            // local queries (w/o serialization) from the threads on the same server
+            while (adaptor->tryrecv_local(req)) {
+                if (req.priority != 0) {
+                    reset_snooze(at_work, last_time);
+                    execute_sparql(req);
+                    break;
+                }
+
+                runqueue.push(req);
+            }
+
             Bundle bundle;
-            while (adaptor->tryrecv(bundle)) {
+            while (!at_work && adaptor->tryrecv(bundle)) {
                 if (bundle.type == SPARQL_QUERY) {
                     // to be fair, engine will handle sub-queries priority,
                     // instead of processing a new task.
                     SPARQLQuery req = bundle.get_sparql_query();
                     if (req.priority != 0) {
                         reset_snooze(at_work, last_time);
-                        sparql->execute_sparql_query(req);
+                        execute_sparql(req);
                         break;
                     }
 
                     runqueue.push(req);
+                } else if (bundle.type == SPARQL_BATCH) {
+                    unpack_batch(bundle);
                 } else {
                     // FIXME: Jump a queue!
                     reset_snooze(at_work, last_time);
@@ -169,12 +229,16 @@ public:
                 }
             }
 
-            if (!at_work) {
+            // backpressure: not start new queries until the pending msgs are drained,
+            // while sub-queries (priority) and replies are still handled above
+            bool backlogged = msgr->backlogged();
+
+            if (!at_work && !backlogged) {
                 SPARQLQuery req;
                 if (runqueue.try_pop(req)) {
                     // process a new SPARQL query
                     reset_snooze(at_work, last_time);
-                    sparql->execute_sparql_query(req);
+                    execute_sparql(req);
                 }
             }
 
@@ -183,7 +247,7 @@ public:
             //        If we could steal jobs from adaptor, it will significantly improve the effect
             //        Howeverm, we could not know the type of jobs in advance, and our work-obliger
             //        mechanism only works well with SPARQL queries.
-            if (Global::enable_workstealing) {
+            if (Global::enable_workstealing && !backlogged) {
                 bool success;
                 int offset = 1;
                 int next_engine;
@@ -199,7 +263,8 @@ public:
                             && ((timer::get_usec() - engines[next_engine]->last_time) >= TIMEOUT_THRESHOLD)
                             && (engines[next_engine]->runqueue.try_pop(req))) {
                         reset_snooze(at_work, last_time);
-                        sparql->execute_sparql_query(req);
+                        execute_sparql(req);
+                        Metrics::get_metrics().inc(tid, ENGINE_STEALS);
                         success = true;
                         offset++;
                     }
@@ -24,29 +24,63 @@
 
 #include <vector>
 
+#include "metrics.hpp"
 #include "query.hpp"
 
 #include "comm/adaptor.hpp"
+#include "comm/pending.hpp"
 
 // utils
 #include "logger2.hpp"
+#include "unit.hpp"
 
 using namespace std;
 
+// the queries with larger results are not coalesced
+#define MAX_BATCH_BYTES KiB2B(64)
+
 
 class Messenger {
 private:
-    class Message {
-    public:
-        int sid;
-        int tid;
-        Bundle bundle;
+    PendingMsgs pending;  // msgs failed to send
+    bool backpressure = false;
+
+    // small queries to remote engines are coalesced per server,
+    // and flushed by sweep_msgs() or when the batch is full
+    vector<SPARQLBatch> batches;
+
+    bool batchable(const SPARQLQuery &r, int dst_sid, int dst_tid) {
+        return (Global::msg_batch_size > 1
+                && dst_sid != sid
+                && dst_tid >= Global::num_proxies
+                && dst_tid < Global::num_proxies + Global::num_engines
+                && r.dev_type == SPARQLQuery::DeviceType::CPU
+                && r.result.result_table.size() * sizeof(sid_t) < MAX_BATCH_BYTES);
+    }
 
-        Message(int sid, int tid, Bundle &bundle)
-            : sid(sid), tid(tid), bundle(bundle) { }
-    };
+    void add_to_batch(SPARQLQuery &&r, int dst_sid, int dst_tid) {
+        SPARQLBatch &batch = batches[dst_sid];
+        batch.add(dst_tid, std::move(r));
+        if (batch.size() >= Global::msg_batch_size || batch.nbytes >= MAX_BATCH_BYTES)
+            flush_batch(dst_sid);
+    }
 
-    vector<Message> pending_msgs;
+    void flush_batch(int dst_sid) {
+        SPARQLBatch &batch = batches[dst_sid];
+        if (batch.size() == 0) return;
+
+        // the batch is sent to the engine of the first query, which dispatches the rest
+        if (batch.size() == 1) {
+            Bundle bundle(batch.take(0));
+            send_msg(bundle, dst_sid, batch.tids[0]);
+        } else {
+            Metrics::get_metrics().inc(tid, MSGR_BATCHES);
+            Metrics::get_metrics().inc(tid, MSGR_BATCHED_QUERIES, batch.size());
+            Bundle bundle(batch);
+            send_msg(bundle, dst_sid, batch.tids[0]);
+        }
+        batch.clear();
+    }
 
 public:
     int sid;    // server id
@@ -54,27 +88,69 @@ public:
 
     Adaptor *adaptor;
 
-    Messenger(int sid, int tid, Adaptor *adaptor) : sid(sid), tid(tid), adaptor(adaptor) { }
+    Messenger(int sid, int tid, Adaptor *adaptor)
+        : pending(adaptor), batches(Global::num_servers), sid(sid), tid(tid), adaptor(adaptor) { }
 
     inline void sweep_msgs() {
-        if (!pending_msgs.size()) return;
+        for (int i = 0; i < batches.size(); i++)
+            flush_batch(i);
+
+        if (!pending.size()) return;
 
         logstream(LOG_DEBUG) << "#" << tid << " "
-                             << pending_msgs.size() << " pending msgs on engine." << LOG_endl;
-        for (vector<Message>::iterator it = pending_msgs.begin(); it != pending_msgs.end();)
-            if (adaptor->send(it->sid, it->tid, it->bundle))
-                it = pending_msgs.erase(it);
-            else
-                ++it;
+                             << pending.size() << " pending msgs on engine." << LOG_endl;
+        pending.sweep();
     }
 
     bool send_msg(Bundle &bundle, int dst_sid, int dst_tid) {
-        if (adaptor->send(dst_sid, dst_tid, bundle))
+        // failed to send, then stash the msg to avoid deadlock
+        return pending.send(dst_sid, dst_tid, bundle);
+    }
+
+    // Return true if the engine should not start new queries
+    // until the pending msgs are drained.
+    bool backlogged() {
+        bool busy = pending.backlogged();
+        if (busy != backpressure) {
+            logstream(LOG_INFO) << "#" << tid << " backpressure is "
+                                << (busy ? "on" : "off") << " ("
+                                << pending.size() << " pending msgs)" << LOG_endl;
+            backpressure = busy;
+        }
+        return busy;
+    }
+
+    uint64_t pending_size() { return pending.size(); }
+
+    uint64_t max_pending_size() { return pending.max_size(); }
+
+    // NOTE: the query is passed through the local queue w/o serialization
+    //       if the destination thread is on the same server
+    //       or coalesced with other small queries to the same server
+    bool send_msg(const SPARQLQuery &r, int dst_sid, int dst_tid) {
+        if (adaptor->is_local(dst_sid, dst_tid))
+            return adaptor->send(dst_sid, dst_tid, r);
+
+        if (batchable(r, dst_sid, dst_tid)) {
+            add_to_batch(SPARQLQuery(r), dst_sid, dst_tid);
             return true;
+        }
 
-        // failed to send, then stash the msg to avoid deadlock
-        pending_msgs.push_back(Message(dst_sid, dst_tid, bundle));
-        return false;
+        Bundle bundle(r);
+        return send_msg(bundle, dst_sid, dst_tid);
+    }
+
+    bool send_msg(SPARQLQuery &&r, int dst_sid, int dst_tid) {
+        if (adaptor->is_local(dst_sid, dst_tid))
+            return adaptor->send(dst_sid, dst_tid, std::move(r));
+
+        if (batchable(r, dst_sid, dst_tid)) {
+            add_to_batch(std::move(r), dst_sid, dst_tid);
+            return true;
+        }
+
+        Bundle bundle(r);
+        return send_msg(bundle, dst_sid, dst_tid);
     }
 
     Bundle recv_msg() { return adaptor->recv(); }
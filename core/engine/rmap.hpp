@@ -34,12 +34,21 @@ class RMap {
 private:
     struct Item {
         int cnt; // #sub-queries
+        int quota; // #rows enough for the parent (LIMIT pushdown), -1 means all
         SPARQLQuery parent;
         SPARQLQuery reply;
     };
 
     boost::unordered_map<int, Item> internal_map;
 
+    // parent queries finished early (LIMIT is reached), and the number of
+    // outstanding replies from their sub-queries which should be dropped
+    struct Orphan {
+        int cnt;        // #outstanding replies
+        int root_pqid;  // the root query (see purge())
+    };
+    boost::unordered_map<int, Orphan> orphan_map;
+
 public:
     void put_parent_request(SPARQLQuery &r, int cnt) {
         logstream(LOG_DEBUG) << "add parent-qid=" << r.qid
@@ -48,13 +57,24 @@ public:
         // not exist
         ASSERT(internal_map.find(r.qid) == internal_map.end());
 
-        Item d = { .cnt = cnt, .parent = r, };
+        Item d = { .cnt = cnt, .quota = -1, .parent = r, };
+        if (r.can_pushdown_limit())
+            d.quota = r.limit + r.offset;
         //d.cnt = cnt;
         //d.parent = r;
         internal_map[r.qid] = d;
     }
 
-    void put_reply(SPARQLQuery &r) {
+    // @return: false if the reply is dropped since its parent has finished early
+    bool put_reply(SPARQLQuery &r) {
+        // drop late replies of a parent which has enough rows
+        auto it = orphan_map.find(r.pqid);
+        if (it != orphan_map.end()) {
+            if (--it->second.cnt == 0)
+                orphan_map.erase(it);
+            return false;
+        }
+
         // exist
         ASSERT(internal_map.find(r.pqid) != internal_map.end());
 
@@ -63,6 +83,10 @@ public:
         SPARQLQuery::Result &part = r.result;
         d.cnt--;
 
+        // any failed sub-query (e.g., timeout) fails the parent
+        if (part.get_status_code() != SUCCESS)
+            whole.set_status_code(part.get_status_code());
+
         // if the PatternGroup comes from a query's UNION part,
         // use merge_result to put result
         if (r.pg_type == SPARQLQuery::PGType::UNION)
@@ -71,6 +95,14 @@ public:
             whole.append_result(part);
 
 
+        // the profile of the sub-query follows the stage which spawns it
+        if (r.profile.enabled)
+            d.parent.profile.merge(r.profile);
+
+        // the sub-queries of a UNION or OPTIONAL have no cardinality (see Cardinality::fork)
+        if (r.card.enabled)
+            d.parent.card.merge(r.card);
+
         // NOTE: all sub-jobs have the same pattern_step, optional_step, and union_done
         // update parent's pattern step (progress)
         if (d.parent.state == SPARQLQuery::SQState::SQ_PATTERN)
@@ -84,10 +116,21 @@ public:
         // update parent's union_done (avoid recursive execution)
         if (r.done(SPARQLQuery::SQState::SQ_UNION))
             d.parent.union_done = true;
+        return true;
     }
 
+    // ready if all sub-queries have replied, or the parent already has enough rows,
+    // or any sub-query has failed
     bool is_ready(int qid) {
-        return internal_map[qid].cnt == 0;
+        Item &d = internal_map[qid];
+        return (d.cnt == 0)
+               || (d.quota >= 0 && d.reply.result.row_num >= d.quota)
+               || (d.reply.result.get_status_code() != SUCCESS);
+    }
+
+    // #sub-queries not yet replied (i.e., to be cancelled) after the parent is ready
+    int get_outstanding(int qid) {
+        return internal_map[qid].cnt;
     }
 
     SPARQLQuery get_reply(int qid) {
@@ -99,14 +142,49 @@ public:
         r.result.row_num = reply.result.row_num;
         r.result.attr_col_num = reply.result.attr_col_num;
         r.result.v2c_map = reply.result.v2c_map;
+        r.result.status_code = reply.result.status_code;
         // NOTE: no need to set nvars, required_vars, and blind
 
         // copy data of result
         r.result.result_table.swap(reply.result.result_table);
         r.result.attr_res_table.swap(reply.result.attr_res_table);
 
+        // the rest of replies will be dropped on arrival
+        if (internal_map[qid].cnt > 0)
+            orphan_map[qid] = { internal_map[qid].cnt, r.root_pqid };
+
         internal_map.erase(qid);
         logstream(LOG_DEBUG) << "erase parent-qid=" << qid << LOG_endl;
         return r;
     }
+
+    // #parents finished early but still waiting for late replies
+    size_t get_orphans() { return orphan_map.size(); }
+
+    // remove all pending parents of a cancelled (root) query
+    // @return: the number of purged parents
+    int purge(int root_pqid) {
+        // the (nested) sub-queries are purged as well and may never reply
+        for (auto it = orphan_map.begin(); it != orphan_map.end();) {
+            if (it->second.root_pqid == root_pqid)
+                it = orphan_map.erase(it);
+            else
+                ++it;
+        }
+
+        int cnt = 0;
+        for (auto it = internal_map.begin(); it != internal_map.end();) {
+            if (it->second.parent.root_pqid != root_pqid) {
+                ++it;
+                continue;
+            }
+
+            // NOTE: the rest of replies should be dropped by the caller,
+            //       since the (nested) sub-queries may also be purged and never reply
+            logstream(LOG_DEBUG) << "purge parent-qid=" << it->first << LOG_endl;
+            it = internal_map.erase(it);
+            cnt++;
+        }
+        return cnt;
+    }
 };
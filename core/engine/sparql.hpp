@@ -27,6 +27,7 @@
 #include <boost/unordered_map.hpp>
 #include <tbb/concurrent_queue.h>
 #include <algorithm> // sort
+#include <deque>
 #include <regex>
 
 #include "global.hpp"
@@ -35,6 +36,7 @@
 #include "coder.hpp"
 #include "dgraph.hpp"
 #include "query.hpp"
+#include "partitioner.hpp"
 
 // engine
 #include "rmap.hpp"
@@ -52,6 +54,9 @@ using namespace std;
 
 #define QUERY_FROM_PROXY(r) (coder->tid_of((r).pqid) < Global::num_proxies)
 
+#define MAX_CANCELLED_QUERIES 4096 // remember the latest cancelled parent queries
+#define DEADLINE_CHECK_INTERVAL 1024 // check the deadline per 1024 rows in long loops
+
 typedef pair<int64_t, int64_t> int64_pair;
 
 static int64_t hash_pair(const int64_pair &x) {
@@ -75,6 +80,178 @@ private:
     RMap rmap; // a map of replies for pending (fork-join) queries
     pthread_spinlock_t rmap_lock;
 
+    // parent queries whose (remaining) sub-queries are cancelled
+    boost::unordered_set<int> cancelled_set;
+    std::deque<int> cancelled_fifo;
+
+    // LIMIT pushdown: whether the (last) pattern step has produced enough rows
+    inline bool reach_quota(int quota, vector<sid_t> &table, int ncols) {
+        return (quota >= 0) && (table.size() >= (uint64_t)quota * ncols);
+    }
+
+    inline bool is_cancelled(int pqid) {
+        return cancelled_set.find(pqid) != cancelled_set.end();
+    }
+
+    // give up the query if it exceeds the deadline
+    inline void check_deadline(SPARQLQuery &req) {
+        if (req.is_timeout()) {
+            logstream(LOG_DEBUG) << "[" << sid << "-" << tid << "] timeout "
+                                 << "Q(qid=" << req.qid << ", pqid=" << req.pqid
+                                 << ", step=" << req.pattern_step << ")" << LOG_endl;
+            throw WukongException(QUERY_TIMEOUT);
+        }
+    }
+
+    // notify the engines which may run the outstanding sub-queries of the parent
+    // (i.e., the same thread for fork-join and MT threads for dispatch)
+    void cancel_sub_queries(SPARQLQuery &r) {
+        logstream(LOG_DEBUG) << "[" << sid << "-" << tid << "] cancel sub-queries of "
+                             << "Q(qid=" << r.qid << ", pqid=" << r.pqid << ")" << LOG_endl;
+
+        set<int> dst_tids;
+        dst_tids.insert(tid);
+        for (int j = 0; j < r.mt_factor; j++)
+            dst_tids.insert(Global::num_proxies
+                            + (tid + j + 1 - Global::num_proxies) % Global::num_engines);
+
+        Bundle bundle(SPARQL_CANCEL, to_string(r.qid));
+        for (int i = 0; i < Global::num_servers; i++) {
+            for (auto dst_tid : dst_tids) {
+                if (i == sid && dst_tid == tid)
+                    cancel_query(r.qid);
+                else
+                    msgr->send_msg(bundle, i, dst_tid);
+            }
+        }
+    }
+
+    // broadcast to all engines to drop the rest of (sub-)queries of a root query
+    void cancel_root_query(int root_pqid) {
+        logstream(LOG_DEBUG) << "[" << sid << "-" << tid << "] cancel root query "
+                             << "(pqid=" << root_pqid << ")" << LOG_endl;
+
+        Bundle bundle(SPARQL_CANCEL, to_string(root_pqid));
+        for (int i = 0; i < Global::num_servers; i++) {
+            for (int j = 0; j < Global::num_engines; j++) {
+                int dst_tid = Global::num_proxies + j;
+                if (i == sid && dst_tid == tid)
+                    cancel_query(root_pqid);
+                else
+                    msgr->send_msg(bundle, i, dst_tid);
+            }
+        }
+    }
+
+    // the (estimated) bytes of the results carried by a query
+    static uint64_t result_bytes(SPARQLQuery &r) {
+        return r.result.result_table.size() * sizeof(sid_t)
+               + r.result.attr_res_table.size() * sizeof(attr_t);
+    }
+
+    // the bytes of the results carried by sub-queries to remote servers
+    uint64_t remote_bytes(vector<SPARQLQuery> &sub_reqs) {
+        uint64_t bytes = 0;
+        for (int i = 0; i < sub_reqs.size(); i++)
+            if (i != sid) bytes += result_bytes(sub_reqs[i]);
+        return bytes;
+    }
+
+    // begin a record of the execution profile with a snapshot of counters
+    // @return: the index of the record, -1 means profiling is disabled
+    int profile_begin(SPARQLQuery &r, const string &op, int step = -1) {
+        if (!r.profile.enabled) return -1;
+
+        SPARQLQuery::Profile::Record rec;
+        rec.op = op;
+        rec.sid = sid;
+        rec.tid = tid;
+        rec.depth = r.profile.depth;
+        rec.step = step;
+        if (step >= 0 && step < r.pattern_group.patterns.size()) {
+            SPARQLQuery::Pattern &pattern = r.get_pattern(step);
+            rec.pattern = {pattern.subject, pattern.predicate,
+                           (ssid_t)pattern.direction, pattern.object};
+        }
+
+        access_stats_t &stats = graph->get_access_stats(tid);
+        rec.time = timer::get_usec();
+        rec.rows_in = r.result.get_row_num();
+        rec.remote_reads = stats.remote_reads;
+        rec.cache_hits = stats.cache_hits;
+        r.profile.records.push_back(rec);
+        return r.profile.records.size() - 1;
+    }
+
+    // end the record of the execution profile
+    void profile_end(SPARQLQuery &r, int idx, uint64_t bytes_sent = 0) {
+        if (idx < 0) return;
+
+        access_stats_t &stats = graph->get_access_stats(tid);
+        SPARQLQuery::Profile::Record &rec = r.profile.records[idx];
+        rec.time = timer::get_usec() - rec.time;
+        rec.rows_out = r.result.get_row_num();
+        rec.remote_reads = stats.remote_reads - rec.remote_reads;
+        rec.cache_hits = stats.cache_hits - rec.cache_hits;
+        rec.bytes_sent = bytes_sent;
+    }
+
+    // add a record of a phase within the current stage (e.g., the breakdown of co-run)
+    void profile_phase(SPARQLQuery &r, const string &op, uint64_t time, uint64_t rows) {
+        if (!r.profile.enabled) return;
+
+        SPARQLQuery::Profile::Record rec;
+        rec.op = op;
+        rec.sid = sid;
+        rec.tid = tid;
+        rec.depth = r.profile.depth + 1;
+        rec.time = time;
+        rec.rows_in = rec.rows_out = rows;
+        r.profile.records.push_back(rec);
+    }
+
+    // the bindings of current pattern step for the feedback of cardinality
+    // @step: the pattern seen from the bound side (i.e., the one recorded)
+    // @return: -1 means the step is not recorded, e.g., the rows of the last step
+    //          may be cut by LIMIT and the rows of co-run steps are not comparable
+    int card_bind(SPARQLQuery &r, SPARQLQuery::Pattern &step) {
+        if (!r.card.enabled || r.corun_enabled || r.row_quota() >= 0)
+            return -1;
+
+        SPARQLQuery::Pattern &pattern = r.get_pattern();
+        if (pattern.predicate < 0 || pattern.pred_type != (char)SID_t)
+            return -1;  // unknown predicate or attribute
+
+        step = pattern;
+        if (is_tpid(pattern.subject))
+            return SPARQLQuery::Cardinality::FROM_INDEX;
+        if (r.result.var_stat(pattern.subject) == CONST_VAR) {
+            if (r.result.var_stat(pattern.object) != KNOWN_VAR)
+                return SPARQLQuery::Cardinality::FROM_CONST;  // the first step
+
+            // the known rows filtered by a constant (i.e., the reversed TO_CONST)
+            swap(step.subject, step.object);
+            step.direction = (step.direction == IN) ? OUT : IN;
+            return SPARQLQuery::Cardinality::TO_CONST;
+        }
+        switch (r.result.var_stat(pattern.object)) {
+        case UNKNOWN_VAR: return SPARQLQuery::Cardinality::TO_UNKNOWN;
+        case KNOWN_VAR: return SPARQLQuery::Cardinality::TO_KNOWN;
+        default: return SPARQLQuery::Cardinality::TO_CONST;
+        }
+    }
+
+    void reply_query(SPARQLQuery &r) {
+        r.shrink();
+        r.state = SPARQLQuery::SQState::SQ_REPLY;
+
+        int dst_sid = coder->sid_of(r.pqid);
+        int prof = profile_begin(r, "reply");
+        profile_end(r, prof, (dst_sid != sid) ? result_bytes(r) : 0);
+
+        msgr->send_msg(std::move(r), dst_sid, coder->tid_of(r.pqid));
+    }
+
 
     /// A query whose parent's PGType is UNION may call this pattern
     void index_to_known(SPARQLQuery &req) {
@@ -93,25 +270,49 @@ private:
 
         vector<sid_t> updated_result_table;
 
+        // the bitmap (or compressed) index is probed w/o decoding the whole index
         uint64_t sz = 0;
-        edge_t *edges = graph->get_index(tid, tpid, d, sz);
+        const Bitmap *bitmap = graph->get_bitmap_index(tpid, d);
+        const PackedList *packed = (bitmap != NULL) ? NULL : graph->get_packed_index(tpid, d);
+        edge_t *edges = NULL;
+        if (bitmap != NULL)
+            sz = bitmap->size();
+        else if (packed != NULL)
+            sz = packed->size();
+        else
+            edges = graph->get_index(tid, tpid, d, sz);
         int start = req.mt_tid % req.mt_factor;
         int length = sz / req.mt_factor;
 
+        // every thread takes a part of consecutive edges (fixup the last participant)
+        uint64_t lo = start * length;
+        uint64_t hi = (start == req.mt_factor - 1) ? sz : (start + 1) * length;
+
         boost::unordered_set<sid_t> unique_set;
-        // every thread takes a part of consecutive edges
-        for (uint64_t k = start * length; k < (start + 1) * length; k++)
-            unique_set.insert(edges[k].val);
-        // fixup the last participant
-        if (start == req.mt_factor - 1)
-            for (uint64_t k = (start + 1) * length; k < sz; k++)
+        if (edges != NULL)
+            for (uint64_t k = lo; k < hi; k++)
                 unique_set.insert(edges[k].val);
 
+        // NOTE: the bitmap checks the whole local index at once,
+        //       so only the first participant matches the rows
+        auto matched = [&](sid_t vid) {
+            if (bitmap != NULL)
+                return (start == 0) && bitmap->contains(vid);
+            if (packed == NULL)
+                return unique_set.find(vid) != unique_set.end();
+            int64_t pos = packed->find(vid);
+            return pos >= (int64_t)lo && pos < (int64_t)hi;
+        };
+
+        int quota = req.row_quota();
         int nrows = res.get_row_num();
         for (int i = 0; i < nrows; i++) {
+            if (reach_quota(quota, updated_result_table, res.get_col_num()))
+                break;
+
             if (req.pg_type == SPARQLQuery::PGType::OPTIONAL) {
                 // matched
-                if (unique_set.find(res.get_row_col(i, col)) != unique_set.end())
+                if (matched(res.get_row_col(i, col)))
                     res.optional_matched_rows[i] = (true && res.optional_matched_rows[i]);
                 else {
                     if (res.optional_matched_rows[i])
@@ -120,7 +321,7 @@ private:
                 }
             } else {
                 // matched
-                if (unique_set.find(res.get_row_col(i, col)) != unique_set.end())
+                if (matched(res.get_row_col(i, col)))
                     res.append_row_to(i, updated_result_table);
             }
         }
@@ -170,8 +371,12 @@ private:
             }
         } else {
             std::vector<sid_t> updated_result_table;
+            int quota = req.row_quota();
             int nrows = res.get_row_num();
             for (uint64_t i = 0; i < nrows; i++) {
+                if (reach_quota(quota, updated_result_table, res.get_col_num()))
+                    break;
+
                 // matched
                 if (unique_set.find(res.get_row_col(i, col)) != unique_set.end())
                     res.append_row_to(i, updated_result_table);
@@ -189,6 +394,39 @@ private:
     /// IDX P ?X . (IDX and P are GIVEN, ?X is UNKNOWN)
     /// e.g., "?X __PREDICATE__ ub:subOrganizationOf" (predicate index)
     /// e.g., "?X  rdf:type  ub:GraduateStudent"      (type index)
+    /// Fuse the type filters (i.e., ?X TYPE_ID T) on the variable of the index,
+    /// which follow the index (i.e., pattern_step), into the intersections of
+    /// bitmaps. All vertices from the local index are local, so that the filters
+    /// can be checked by the local type index.
+    /// @return #fused patterns, and IDs of the intersection (if any)
+    int fuse_type_filters(SPARQLQuery &req, ssid_t tpid, dir_t d, ssid_t var,
+                          vector<sid_t> &ids) {
+        if (req.corun_enabled || Global::enable_vattr
+                || req.pg_type == SPARQLQuery::PGType::OPTIONAL)
+            return 0;
+
+        const Bitmap *idx = graph->get_bitmap_index(tpid, d);
+        if (idx == NULL) return 0;
+
+        Bitmap fused;
+        int nfused = 0;
+        for (int step = req.pattern_step + 1; step < req.pattern_group.patterns.size(); step++) {
+            SPARQLQuery::Pattern &p = req.get_pattern(step);
+            if (p.subject != var || p.predicate != TYPE_ID || p.direction != OUT
+                    || p.object <= 0 || p.pred_type != (char)SID_t)
+                break;
+
+            const Bitmap *type_idx = graph->get_bitmap_index(p.object, IN);
+            if (type_idx == NULL) break;
+
+            fused = (nfused == 0) ? idx->intersect(*type_idx) : fused.intersect(*type_idx);
+            nfused++;
+        }
+
+        if (nfused > 0) fused.to_vector(ids);
+        return nfused;
+    }
+
     ///
     /// 1) Use [IDX]+[P] to retrieve all of neighbors (?X) on every node
     void index_to_unknown(SPARQLQuery &req) {
@@ -206,19 +444,44 @@ private:
 
         vector<sid_t> updated_result_table;
 
+        // the type filters following the index are fused by intersecting bitmaps
+        vector<sid_t> fused_ids;
+        int nfused = fuse_type_filters(req, tpid, d, end, fused_ids);
+
+        // the compressed index is only decoded for the part of this thread
         uint64_t sz = 0;
-        edge_t *edges = graph->get_index(tid, tpid, d, sz);
+        const PackedList *packed = (nfused > 0) ? NULL : graph->get_packed_index(tpid, d);
+        edge_t *edges = NULL;
+        if (nfused > 0)
+            sz = fused_ids.size();
+        else if (packed != NULL)
+            sz = packed->size();
+        else
+            edges = graph->get_index(tid, tpid, d, sz);
         int start = req.mt_tid % req.mt_factor;
         int length = sz / req.mt_factor;
 
-        // every thread takes a part of consecutive edges
-        for (uint64_t k = start * length; k < (start + 1) * length; k++)
-            updated_result_table.push_back(edges[k].val);
-
         // fixup the last participant
-        if (start == req.mt_factor - 1)
-            for (uint64_t k = (start + 1) * length; k < sz; k++)
+        uint64_t end_k = (start == req.mt_factor - 1) ? sz : (start + 1) * length;
+
+        // LIMIT pushdown (only if it is the single pattern, incl. fused ones)
+        req.pattern_step += nfused;
+        int quota = req.row_quota();
+        if (quota >= 0)
+            end_k = min(end_k, (uint64_t)(start * length + quota));
+
+        // every thread takes a part of consecutive edges
+        if (nfused > 0) {
+            for (uint64_t k = start * length; k < end_k; k++)
+                updated_result_table.push_back(fused_ids[k]);
+        } else if (packed != NULL) {
+            PackedList::Reader reader(packed);
+            for (uint64_t k = start * length; k < end_k; k++)
+                updated_result_table.push_back(reader[k]);
+        } else {
+            for (uint64_t k = start * length; k < end_k; k++)
                 updated_result_table.push_back(edges[k].val);
+        }
 
         // update result and metadata
         res.result_table.swap(updated_result_table);
@@ -253,6 +516,12 @@ private:
 
             uint64_t sz = 0;
             edge_t *vids = graph->get_triples(tid, start, pid, d, sz);
+
+            // LIMIT pushdown (only if it is the single pattern)
+            int quota = req.row_quota();
+            if (quota >= 0)
+                sz = min(sz, (uint64_t)quota);
+
             std::vector<sid_t> updated_result_table;
             for (uint64_t k = 0; k < sz; k++)
                 updated_result_table.push_back(vids[k].val);
@@ -321,8 +590,20 @@ private:
             sid_t cached = BLANK_ID; // simple dedup for consecutive same vertices
             edge_t *vids = NULL;
             uint64_t sz = 0;
+            // the compressed type index is read w/o decoding the whole index
+            const PackedList *packed = NULL;
+            PackedList::Reader reader;
+            auto vid_at = [&](uint64_t k) { return (packed != NULL) ? reader[k] : vids[k].val; };
+            int quota = req.row_quota();
             int nrows = res.get_row_num();
             for (int i = 0; i < nrows; i++) {
+                // stop expanding if the last step has enough rows (LIMIT pushdown)
+                if (reach_quota(quota, updated_result_table, res.get_col_num() + 1))
+                    break;
+
+                if (i % DEADLINE_CHECK_INTERVAL == 0)
+                    check_deadline(req);
+
                 sid_t cur = res.get_row_col(i, res.var2col(start));
 
                 // optional
@@ -336,10 +617,15 @@ private:
 
                 if (cur != cached) { // new KNOWN
                     cached = cur;
-                    if (pid == TYPE_ID && d == IN)
+                    packed = (pid == TYPE_ID && d == IN) ? graph->get_packed_index(cur, d) : NULL;
+                    if (packed != NULL) {
+                        reader = PackedList::Reader(packed);
+                        sz = packed->size();
+                    } else if (pid == TYPE_ID && d == IN) {
                         vids = graph->get_index(tid, cur, d, sz);
-                    else
+                    } else {
                         vids = graph->get_triples(tid, cur, pid, d, sz);
+                    }
                 }
 
                 // append a new intermediate result (row)
@@ -347,7 +633,7 @@ private:
                     if (sz > 0) {
                         for (uint64_t k = 0; k < sz; k++) {
                             res.append_row_to(i, updated_result_table);
-                            updated_result_table.push_back(vids[k].val);
+                            updated_result_table.push_back(vid_at(k));
                             updated_optional_matched_rows.push_back(true);
                         }
                     } else {
@@ -357,11 +643,14 @@ private:
                     }
                 } else {
                     for (uint64_t k = 0; k < sz; k++) {
+                        if (reach_quota(quota, updated_result_table, res.get_col_num() + 1))
+                            break;
+
                         res.append_row_to(i, updated_result_table);
                         // update attribute table to map the result table
                         if (Global::enable_vattr)
                             res.append_attr_row_to(i, updated_attr_table);
-                        updated_result_table.push_back(vids[k].val);
+                        updated_result_table.push_back(vid_at(k));
                     }
                 }
             }
@@ -431,8 +720,15 @@ private:
         edge_t *vids = NULL;
         uint64_t sz = 0;
 
+        int quota = req.row_quota();
         int nrows = res.get_row_num();
         for (int i = 0; i < nrows; i++) {
+            if (reach_quota(quota, updated_result_table, res.get_col_num()))
+                break;
+
+            if (i % DEADLINE_CHECK_INTERVAL == 0)
+                check_deadline(req);
+
             sid_t cur = res.get_row_col(i, res.var2col(start));
             if (cur != cached) {  // a new vertex
                 cached = cur;
@@ -494,31 +790,46 @@ private:
         vector<sid_t> updated_result_table;
         vector<attr_t> updated_attr_table;
 
+        // the type of a local vertex is checked by the bitmap of the type index
+        const Bitmap *type_idx = (pid == TYPE_ID && d == OUT)
+                                 ? graph->get_bitmap_index(end, IN) : NULL;
+
         // simple dedup for consecutive same vertices
         sid_t cached = BLANK_ID;
         edge_t *vids = NULL;
         uint64_t sz = 0;
         bool exist = false;
+        int quota = req.row_quota();
         int nrows = res.get_row_num();
         for (int i = 0; i < nrows; i++) {
+            if (reach_quota(quota, updated_result_table, res.get_col_num()))
+                break;
+
+            if (i % DEADLINE_CHECK_INTERVAL == 0)
+                check_deadline(req);
+
             sid_t cur = res.get_row_col(i, res.var2col(start));
             if (cur != cached) {  // a new vertex
                 exist = false;
                 cached = cur;
-                vids = graph->get_triples(tid, cur, pid, d, sz);
-
-                for (uint64_t k = 0; k < sz; k++) {
-                    if (vids[k].val == end) {
-                        // append a matched intermediate result
-                        exist = true;
-                        if (req.pg_type != SPARQLQuery::PGType::OPTIONAL) {
-                            res.append_row_to(i, updated_result_table);
-                            if (Global::enable_vattr)
-                                res.append_attr_row_to(i, updated_attr_table);
+                if (type_idx != NULL && Partitioner::server_of(cur) == sid) {
+                    exist = type_idx->contains(cur);
+                } else {
+                    vids = graph->get_triples(tid, cur, pid, d, sz);
+                    for (uint64_t k = 0; k < sz; k++) {
+                        if (vids[k].val == end) {
+                            exist = true;
+                            break;
                         }
-                        break;
                     }
                 }
+
+                // append a matched intermediate result
+                if (exist && req.pg_type != SPARQLQuery::PGType::OPTIONAL) {
+                    res.append_row_to(i, updated_result_table);
+                    if (Global::enable_vattr)
+                        res.append_attr_row_to(i, updated_attr_table);
+                }
                 if (req.pg_type == SPARQLQuery::PGType::OPTIONAL) {
                     if (res.optional_matched_rows[i] && (!exist)) req.correct_optional_result(i);
                     res.optional_matched_rows[i] = (exist && res.optional_matched_rows[i]);
@@ -611,6 +922,9 @@ private:
         vector<sid_t> updated_result_table;
         int nrows = res.get_row_num();
         for (int i = 0; i < nrows; i++) {
+            if (i % DEADLINE_CHECK_INTERVAL == 0)
+                check_deadline(req);
+
             sid_t cur = res.get_row_col(i, res.var2col(start));
             uint64_t npids = 0;
             edge_t *pids = graph->get_triples(tid, cur, PREDICATE_ID, d, npids);
@@ -662,6 +976,9 @@ private:
         vector<sid_t> updated_result_table;
         int nrows = res.get_row_num();
         for (int i = 0; i < nrows; i++) {
+            if (i % DEADLINE_CHECK_INTERVAL == 0)
+                check_deadline(req);
+
             sid_t prev_id = res.get_row_col(i, res.var2col(start));
             uint64_t npids = 0;
             edge_t *pids = graph->get_triples(tid, prev_id, PREDICATE_ID, d, npids);
@@ -751,6 +1068,8 @@ private:
         vector<SPARQLQuery> sub_reqs(Global::num_servers);
         for (int i = 0; i < Global::num_servers; i++) {
             sub_reqs[i].pqid = req.qid;
+            sub_reqs[i].root_pqid = req.root_pqid;
+            sub_reqs[i].deadline = req.deadline;
             sub_reqs[i].pg_type = (req.pg_type == SPARQLQuery::PGType::UNION) ?
                                   SPARQLQuery::PGType::BASIC : req.pg_type;
             sub_reqs[i].pattern_group = req.pattern_group;
@@ -759,6 +1078,12 @@ private:
             sub_reqs[i].fetch_step = req.fetch_step;
             sub_reqs[i].local_var = start;
             sub_reqs[i].priority = req.priority + 1;
+            sub_reqs[i].profile = req.profile.fork();
+            sub_reqs[i].card = req.card.fork();
+
+            // per-server quota for LIMIT pushdown (OFFSET is only applied by the root query)
+            if (req.can_pushdown_limit())
+                sub_reqs[i].limit = req.limit + req.offset;
 
             // metadata
             sub_reqs[i].result.col_num = req.result.col_num;
@@ -782,8 +1107,7 @@ private:
         // result table need to be separated to ditterent sub-queries
         else {
             for (int i = 0; i < nrows; i++) {
-                int dst_sid = wukong::math::hash_mod(req.result.get_row_col(i, req.result.var2col(start)),
-                                                    Global::num_servers);
+                int dst_sid = Partitioner::server_of(req.result.get_row_col(i, req.result.var2col(start)));
                 req.result.append_row_to(i, sub_reqs[dst_sid].result.result_table);
                 req.result.append_attr_row_to(i, sub_reqs[dst_sid].result.attr_res_table);
 
@@ -932,6 +1256,11 @@ private:
         res.result_table.swap(updated_result_table);
         res.update_nrows();
 
+        // the breakdown of co-run
+        profile_phase(req, "corun-dedup", t1 - t0, unique_set.size());
+        profile_phase(req, "corun-execute", t2 - t1, sub_result.get_row_num());
+        profile_phase(req, "corun-join", t4 - t2, res.get_row_num());
+
         req.pattern_step = fetch_step;
     }
 
@@ -1069,9 +1398,13 @@ private:
             logstream(LOG_DEBUG) << "[" << sid << "-" << tid << "] dispatch "
                                  << "Q(qid=" << r.qid << ", pqid=" << r.pqid
                                  << ", step=" << r.pattern_step << ")" << LOG_endl;
-            rmap.put_parent_request(r, Global::num_servers * r.mt_factor);
-
+            int prof = profile_begin(r, "dispatch", r.pattern_step);
             SPARQLQuery sub_query = r;
+            sub_query.profile = r.profile.fork();
+            sub_query.card = r.card.fork();
+            profile_end(r, prof, result_bytes(sub_query) * (Global::num_servers - 1) * r.mt_factor);
+
+            rmap.put_parent_request(r, Global::num_servers * r.mt_factor);
             for (int i = 0; i < Global::num_servers; i++) {
                 for (int j = 0; j < r.mt_factor; j++) {
                     sub_query.pqid = r.qid;
@@ -1081,8 +1414,7 @@ private:
                     int dst_tid = Global::num_proxies
                                   + (tid + j + 1 - Global::num_proxies) % Global::num_engines;
 
-                    Bundle bundle(sub_query);
-                    msgr->send_msg(bundle, i, dst_tid);
+                    msgr->send_msg(sub_query, i, dst_tid);
                 }
             }
             return true;
@@ -1095,12 +1427,14 @@ private:
         dir_t d = pattern.direction;
 
         if (!is_start && Global::num_servers != 1 && p == TYPE_ID && d == IN){
+            int prof = profile_begin(r, "dispatch", r.pattern_step);
             vector<SPARQLQuery> sub_reqs = generate_sub_query(r, false);
+            profile_end(r, prof, remote_bytes(sub_reqs));
+
             rmap.put_parent_request(r, sub_reqs.size());
             for (int i = 0; i < sub_reqs.size(); i++) {
                 if (i != sid) {
-                    Bundle bundle(sub_reqs[i]);
-                    msgr->send_msg(bundle, i, tid);
+                    msgr->send_msg(std::move(sub_reqs[i]), i, tid);
                 } else {
                     prior_stage.push(sub_reqs[i]);
                 }
@@ -1118,17 +1452,32 @@ private:
                              << " #rows = " << r.result.get_row_num()
                              << LOG_endl;
         do {
+            check_deadline(r); // between pattern steps
+
+            int prof = profile_begin(r, "pattern", r.pattern_step);
+            int step = r.pattern_step;
+            SPARQLQuery::Pattern card_step;
+            int bind = card_bind(r, card_step);
+            // a constant start (w/o any column) counts as a single row
+            uint64_t rows_in = (r.result.get_col_num() == 0) ? 1 : r.result.get_row_num();
             time = timer::get_usec();
             execute_one_pattern(r);
+            // the rows of fused steps (e.g., type filters) are not of a single pattern
+            if (bind >= 0 && r.pattern_step == step + 1)
+                r.card.record(step, bind, card_step, rows_in, r.result.get_row_num());
             logstream(LOG_DEBUG) << "[" << sid << "-" << tid << "]"
                                  << " step = " << r.pattern_step
                                  << " exec-time = " << (timer::get_usec() - time) << " usec"
                                  << " #rows = " << r.result.get_row_num()
                                  << LOG_endl;
+            profile_end(r, prof);
 
             // co-run optimization
-            if (r.corun_enabled && (r.pattern_step == r.corun_step))
+            if (r.corun_enabled && (r.pattern_step == r.corun_step)) {
+                prof = profile_begin(r, "corun", r.corun_step);
                 do_corun(r);
+                profile_end(r, prof);
+            }
 
             if (r.done(SPARQLQuery::SQState::SQ_PATTERN))
                 return true;  // done
@@ -1138,12 +1487,14 @@ private:
             }
 
             if (need_fork_join(r)) {
+                prof = profile_begin(r, "fork-join", r.pattern_step);
                 vector<SPARQLQuery> sub_reqs = generate_sub_query(r);
+                profile_end(r, prof, remote_bytes(sub_reqs));
+
                 rmap.put_parent_request(r, sub_reqs.size());
                 for (int i = 0; i < sub_reqs.size(); i++) {
                     if (i != sid) {
-                        Bundle bundle(sub_reqs[i]);
-                        msgr->send_msg(bundle, i, tid);
+                        msgr->send_msg(std::move(sub_reqs[i]), i, tid);
                     } else {
                         prior_stage.push(sub_reqs[i]);
                     }
@@ -1421,6 +1772,8 @@ private:
         }
     };
 
+public:
+    // DISTINCT, ORDER BY, OFFSET and LIMIT, and remove unrequested variables
     void final_process(SPARQLQuery &r) {
         if (r.result.blind || r.result.result_table.size() == 0)
             return;
@@ -1550,7 +1903,6 @@ out:
         r.result.set_attr_col_num(new_attr_col_num);
     }
 
-public:
     tbb::concurrent_queue<SPARQLQuery> prior_stage;
 
     SPARQLEngine(int sid, int tid, StringServer *str_server,
@@ -1568,19 +1920,49 @@ public:
 
             // 0. query has done
             if (r.state == SPARQLQuery::SQState::SQ_REPLY) {
+                // the root query has been cancelled and its parents have been purged
+                if (is_cancelled(r.root_pqid))
+                    return;
+
                 pthread_spin_lock(&rmap_lock);
-                rmap.put_reply(r);
+                if (!rmap.put_reply(r)) {
+                    pthread_spin_unlock(&rmap_lock);
+                    return;  // dropped (parent has finished early)
+                }
 
                 if (!rmap.is_ready(r.pqid)) {
                     pthread_spin_unlock(&rmap_lock);
                     return;  // not ready (waiting for the rest)
                 }
 
-                // all sub-queries have done, continue to execute
+                // all sub-queries have done (or enough rows), continue to execute
+                int outstanding = rmap.get_outstanding(r.pqid);
                 r = rmap.get_reply(r.pqid);
                 pthread_spin_unlock(&rmap_lock);
+
+                // LIMIT is reached, the rest of sub-queries are useless
+                if (outstanding > 0)
+                    cancel_sub_queries(r);
             }
 
+            // the root query has been cancelled, just drop the query
+            if (!QUERY_FROM_PROXY(r) && is_cancelled(r.root_pqid))
+                return;
+
+            // the parent query has been cancelled, reply an empty result at once
+            if (!QUERY_FROM_PROXY(r) && is_cancelled(r.pqid)) {
+                r.result.clear();
+                r.result.update_nrows();
+                reply_query(r);
+                return;
+            }
+
+            // some of sub-queries failed (e.g., timeout)
+            if (r.result.get_status_code() != SUCCESS)
+                throw WukongException(r.result.get_status_code());
+
+            check_deadline(r);
+
             // 1. Pattern
             if (r.has_pattern() && !r.done(SPARQLQuery::SQState::SQ_PATTERN)) {
                 r.state = SPARQLQuery::SQState::SQ_PATTERN;
@@ -1596,18 +1978,24 @@ public:
                 r.state = SPARQLQuery::SQState::SQ_UNION;
                 int size = r.pattern_group.unions.size();
                 r.union_done = true;
+
+                int prof = profile_begin(r, "union");
+                vector<SPARQLQuery> union_reqs(size);
+                vector<int> dst_sids(size);
+                uint64_t bytes = 0;
+                for (int i = 0; i < size; i++) {
+                    union_reqs[i].inherit_union(r, i);
+                    dst_sids[i] = Partitioner::server_of(union_reqs[i].pattern_group.get_start());
+                    if (dst_sids[i] != sid) bytes += result_bytes(union_reqs[i]);
+                }
+                profile_end(r, prof, bytes);
+
                 rmap.put_parent_request(r, size);
                 for (int i = 0; i < size; i++) {
-                    SPARQLQuery union_req;
-                    union_req.inherit_union(r, i);
-                    int dst_sid = wukong::math::hash_mod(
-                                      union_req.pattern_group.get_start(),
-                                      Global::num_servers);
-                    if (dst_sid != sid) {
-                        Bundle bundle(union_req);
-                        msgr->send_msg(bundle, dst_sid, tid);
+                    if (dst_sids[i] != sid) {
+                        msgr->send_msg(std::move(union_reqs[i]), dst_sids[i], tid);
                     } else {
-                        prior_stage.push(union_req);
+                        prior_stage.push(union_reqs[i]);
                     }
                 }
                 return;
@@ -1617,6 +2005,7 @@ public:
             if (r.has_optional() &&
                     !r.done(SPARQLQuery::SQState::SQ_OPTIONAL)) {
                 r.state = SPARQLQuery::SQState::SQ_OPTIONAL;
+                int prof = profile_begin(r, "optional");
                 SPARQLQuery optional_req;
                 optional_req.inherit_optional(r);
                 r.optional_step++;
@@ -1624,23 +2013,23 @@ public:
                     optional_req.qid = r.qid;
                     vector<SPARQLQuery> sub_reqs =
                         generate_sub_query(optional_req);
+                    profile_end(r, prof, remote_bytes(sub_reqs));
+
                     rmap.put_parent_request(r, sub_reqs.size());
                     for (int i = 0; i < sub_reqs.size(); i++) {
                         if (i != sid) {
-                            Bundle bundle(sub_reqs[i]);
-                            msgr->send_msg(bundle, i, tid);
+                            msgr->send_msg(std::move(sub_reqs[i]), i, tid);
                         } else {
                             prior_stage.push(sub_reqs[i]);
                         }
                     }
                 } else {
+                    int dst_sid = Partitioner::server_of(optional_req.pattern_group.get_start());
+                    profile_end(r, prof, (dst_sid != sid) ? result_bytes(optional_req) : 0);
+
                     rmap.put_parent_request(r, 1);
-                    int dst_sid = wukong::math::hash_mod(
-                                      optional_req.pattern_group.get_start(),
-                                      Global::num_servers);
                     if (dst_sid != sid) {
-                        Bundle bundle(optional_req);
-                        msgr->send_msg(bundle, dst_sid, tid);
+                        msgr->send_msg(std::move(optional_req), dst_sid, tid);
                     } else {
                         prior_stage.push(optional_req);
                     }
@@ -1651,13 +2040,17 @@ public:
             // 4. Filter
             if (r.has_filter()) {
                 r.state = SPARQLQuery::SQState::SQ_FILTER;
+                int prof = profile_begin(r, "filter");
                 execute_filter(r);
+                profile_end(r, prof);
             }
 
             // 5. Final
             if (QUERY_FROM_PROXY(r)) {
                 r.state = SPARQLQuery::SQState::SQ_FINAL;
+                int prof = profile_begin(r, "final");
                 final_process(r);
+                profile_end(r, prof);
             }
 
         } catch (const char *msg) {
@@ -1665,11 +2058,31 @@ public:
         } catch (WukongException &ex) {
             r.result.set_status_code(ex.code());
         }
+
+        // the rest of (sub-)queries of a timeout query are useless
+        if (QUERY_FROM_PROXY(r) && r.result.get_status_code() == QUERY_TIMEOUT)
+            cancel_root_query(r.root_pqid);
+
         // 6. Reply
-        r.shrink();
-        r.state = SPARQLQuery::SQState::SQ_REPLY;
-        Bundle bundle(r);
-        msgr->send_msg(bundle, coder->sid_of(r.pqid), coder->tid_of(r.pqid));
+        reply_query(r);
+    }
+
+    // cancel the (remaining) sub-queries of a parent (or root) query
+    void cancel_query(int pqid) {
+        if (!cancelled_set.insert(pqid).second)
+            return;
+
+        // purge pending parents of the root query
+        pthread_spin_lock(&rmap_lock);
+        rmap.purge(pqid);
+        pthread_spin_unlock(&rmap_lock);
+
+        // only remember the latest cancelled queries
+        cancelled_fifo.push_back(pqid);
+        if (cancelled_fifo.size() > MAX_CANCELLED_QUERIES) {
+            cancelled_set.erase(cancelled_fifo.front());
+            cancelled_fifo.pop_front();
+        }
     }
 
 };
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2016 Shanghai Jiao Tong University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://ipads.se.sjtu.edu.cn/projects/wukong
+ *
+ */
+
+#pragma once
+
+#include <list>
+#include <algorithm>
+#include <boost/unordered_map.hpp>
+#include <boost/functional/hash.hpp>
+
+#include "global.hpp"
+#include "type.hpp"
+
+using namespace std;
+
+#define FEEDBACK_DECAY 0.8           // the weight of old observations per new observation
+#define FEEDBACK_MIN_SELECTIVITY 0.01 // smaller selectivities are regarded as the same
+
+/**
+ * The observed selectivities (i.e., #rows out per row in) of pattern steps reported
+ * by engines (see SPARQLQuery::Cardinality), which are preferred by the planner over
+ * the estimates from statistics. The key is <predicate, direction, bindings, type>,
+ * where the type is of the constant bound to the step (if any).
+ * The old observations are decayed by FEEDBACK_DECAY, and the least recently observed
+ * key is evicted if the store is full (i.e., Global::plan_feedback_size).
+ */
+class CardFeedback {
+public:
+    struct key_t {
+        ssid_t pid;
+        int dir;
+        int bind;
+        ssid_t type;
+
+        bool operator == (const key_t &k) const {
+            return pid == k.pid && dir == k.dir && bind == k.bind && type == k.type;
+        }
+    };
+
+    struct key_hash {
+        size_t operator()(const key_t &k) const {
+            size_t seed = 0;
+            boost::hash_combine(seed, k.pid);
+            boost::hash_combine(seed, k.dir);
+            boost::hash_combine(seed, k.bind);
+            boost::hash_combine(seed, k.type);
+            return seed;
+        }
+    };
+
+    // the selectivities of keys used by a plan (-1 means not observed)
+    typedef boost::unordered_map<key_t, double, key_hash> snapshot_t;
+
+private:
+    struct entry_t {
+        double rows_in;
+        double rows_out;
+        list<key_t>::iterator pos;  // in lru
+    };
+
+    boost::unordered_map<key_t, entry_t, key_hash> entries;
+    list<key_t> lru;  // the most recently observed key at front
+
+    bool find(const key_t &key, double &selectivity) const {
+        auto it = entries.find(key);
+        if (it == entries.end()) return false;
+
+        selectivity = it->second.rows_out / it->second.rows_in;
+        return true;
+    }
+
+public:
+    uint64_t version = 0;  // bumped if any selectivity is new or changed by plan_replan_factor
+    uint64_t lookups = 0, hits = 0;
+
+    // two selectivities are different if they differ by Global::plan_replan_factor
+    static bool differ(double s1, double s2) {
+        double lo = max(min(s1, s2), FEEDBACK_MIN_SELECTIVITY);
+        return max(s1, s2) > lo * Global::plan_replan_factor;
+    }
+
+    void observe(ssid_t pid, int dir, int bind, ssid_t type, uint64_t rows_in, uint64_t rows_out) {
+        if (Global::plan_feedback_size <= 0 || rows_in == 0) return;
+
+        key_t key = {pid, dir, bind, type};
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            while (entries.size() >= (size_t)Global::plan_feedback_size) {
+                entries.erase(lru.back());
+                lru.pop_back();
+            }
+
+            lru.push_front(key);
+            entry_t &e = entries[key];
+            e.rows_in = rows_in;
+            e.rows_out = rows_out;
+            e.pos = lru.begin();
+            version++;
+            return;
+        }
+
+        entry_t &e = it->second;
+        double before = e.rows_out / e.rows_in;
+        e.rows_in = e.rows_in * FEEDBACK_DECAY + rows_in;
+        e.rows_out = e.rows_out * FEEDBACK_DECAY + rows_out;
+        lru.splice(lru.begin(), lru, e.pos);
+
+        if (differ(before, e.rows_out / e.rows_in))
+            version++;
+    }
+
+    bool lookup(const key_t &key, double &selectivity) {
+        if (Global::plan_feedback_size <= 0) return false;
+
+        lookups++;
+        if (!find(key, selectivity)) return false;
+
+        hits++;
+        return true;
+    }
+
+    // any selectivity used by a plan is observed, evicted, or changed since then
+    bool changed(const snapshot_t &used) const {
+        for (auto const &u : used) {
+            double selectivity;
+            bool found = find(u.first, selectivity);
+            if (found != (u.second >= 0)
+                    || (found && differ(u.second, selectivity)))
+                return true;
+        }
+        return false;
+    }
+
+    size_t size() const { return entries.size(); }
+};
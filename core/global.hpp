@@ -38,15 +38,22 @@ public:
     static int num_engines __attribute__((weak));
 
     static string input_folder __attribute__((weak));
+    static string partition_file __attribute__((weak));
+    static int hot_vertex_degree __attribute__((weak));
 
     static int data_port_base __attribute__((weak));
     static int ctrl_port_base __attribute__((weak));
+    static int tcp_pool_size __attribute__((weak));
+    static int tcp_batch_size __attribute__((weak));
+    static int metrics_port __attribute__((weak));
 
     static int rdma_buf_size_mb __attribute__((weak));
     static int rdma_rbf_size_mb __attribute__((weak));
 
     static bool use_rdma __attribute__((weak));
     static int rdma_threshold __attribute__((weak));
+    static bool enable_local_shortcut __attribute__((weak));
+    static int msg_batch_size __attribute__((weak));
 
     static int mt_threshold __attribute__((weak));
 
@@ -58,11 +65,21 @@ public:
 
     static bool enable_planner __attribute__((weak));
     static bool generate_statistics __attribute__((weak));
+    static int stat_sample_ratio __attribute__((weak));
+    static bool enable_plan_cache __attribute__((weak));
+    static int plan_replan_factor __attribute__((weak));
+    static int plan_feedback_size __attribute__((weak));
+    static bool incremental_stats __attribute__((weak));
 
     static bool enable_vattr __attribute__((weak));
 
+    static int query_timeout_ms __attribute__((weak));
+    static int result_cache_size_mb __attribute__((weak));
+
     static int memstore_size_gb __attribute__((weak));
     static int est_load_factor __attribute__((weak));
+    static bool compress_index __attribute__((weak));
+    static bool enable_bitmap_index __attribute__((weak));
 
     static int num_gpus __attribute__((weak));
     static int gpu_kvcache_size_gb __attribute__((weak));
@@ -81,15 +98,22 @@ int Global::num_proxies = 1;    // the number of proxies
 int Global::num_engines = 1;    // the number of engines
 
 string Global::input_folder;
+string Global::partition_file;  // vid-to-server table (empty means hashing)
+int Global::hot_vertex_degree = 0;  // replicate vertices w/ more edges to all servers (0 means disabled)
 
 int Global::data_port_base = 5500;
 int Global::ctrl_port_base = 9576;
+int Global::tcp_pool_size = 4;   // #sockets to each remote thread (shared by sender threads)
+int Global::tcp_batch_size = 1;  // max #small msgs sent together by TCP (1 means no batching)
+int Global::metrics_port = 0;    // export metrics by HTTP on the loopback (0 means disabled)
 
 int Global::rdma_buf_size_mb = 64;
 int Global::rdma_rbf_size_mb = 16;
 
 bool Global::use_rdma = true;
 int Global::rdma_threshold = 300;
+bool Global::enable_local_shortcut = true;  // pass queries between local threads w/o serialization
+int Global::msg_batch_size = 16;  // max #queries coalesced into a message (1 means no batching)
 
 int Global::mt_threshold = 16;
 
@@ -101,9 +125,17 @@ bool Global::silent = true;  // don't take back results by default
 
 bool Global::enable_planner = true;  // for planner
 bool Global::generate_statistics = true;
+int Global::stat_sample_ratio = 1;  // sample 1/ratio of vertices to generate statistics
+bool Global::enable_plan_cache = true; // reuse plans for queries of the same shape
+int Global::plan_replan_factor = 4;     // re-plan if estimates differ by this factor
+int Global::plan_feedback_size = 4096;  // the max #selectivities observed by execution (0 means disabled)
+bool Global::incremental_stats = true;  // update statistics by dynamically loaded triples
 
 bool Global::enable_vattr = false;  // for attr
 
+int Global::query_timeout_ms = 0;  // per-query deadline (0 means no deadline)
+int Global::result_cache_size_mb = 0;  // memory budget of proxy-side result cache (0 means disabled)
+
 // kvstore
 int Global::memstore_size_gb = 20;
 /**
@@ -113,6 +145,8 @@ int Global::memstore_size_gb = 20;
  * #buckets = (#keys * 100) / (ASSOCIATIVITY * global_est_load_factor)
  */
 int Global::est_load_factor = 55;
+bool Global::compress_index = false;  // store predicate/type index compressed (static gstore)
+bool Global::enable_bitmap_index = false;  // build bitmaps of predicate/type index (static gstore)
 
 // GPU support
 int Global::num_gpus = 0;
@@ -186,7 +186,10 @@ public:
         // if req is a reply
         if (req.state == SPARQLQuery::SQState::SQ_REPLY) {
             pthread_spin_lock(&rmap_lock);
-            rmap.put_reply(req);
+            if (!rmap.put_reply(req)) {
+                pthread_spin_unlock(&rmap_lock);
+                return; // dropped (parent has finished early)
+            }
 
             if (!rmap.is_ready(req.pqid)) {
                 pthread_spin_unlock(&rmap_lock);
@@ -23,6 +23,7 @@
 #pragma once
 
 #include <string>
+#include <climits>
 #include <fstream>
 #include <iostream>
 #include <stdio.h>
@@ -40,6 +41,7 @@
 #include "global.hpp"
 #include "type.hpp"
 #include "rdma.hpp"
+#include "partitioner.hpp"
 
 // loader
 #include "loader_interface.hpp"
@@ -169,8 +171,8 @@ protected:
         auto lambda = [&](istream & file, int localtid) {
             sid_t s, p, o;
             while (file >> s >> p >> o) {
-                int s_sid = wukong::math::hash_mod(s, Global::num_servers);
-                int o_sid = wukong::math::hash_mod(o, Global::num_servers);
+                int s_sid = Partitioner::server_of(s);
+                int o_sid = Partitioner::server_of(o);
                 if (s_sid == o_sid) {
                     send_triple(localtid, s_sid, s, p, o);
                 } else {
@@ -225,8 +227,8 @@ protected:
         auto lambda = [&](istream & file, uint64_t &n, uint64_t kvs_sz, sid_t * kvs) {
             sid_t s, p, o;
             while (file >> s >> p >> o) {
-                int s_sid = wukong::math::hash_mod(s, Global::num_servers);
-                int o_sid = wukong::math::hash_mod(o, Global::num_servers);
+                int s_sid = Partitioner::server_of(s);
+                int o_sid = Partitioner::server_of(o);
                 if ((s_sid == sid) || (o_sid == sid)) {
                     ASSERT((n * 3 + 3) * sizeof(sid_t) <= kvs_sz);
                     // buffer the triple and update the counter
@@ -281,7 +283,7 @@ protected:
                     break;
                 }
 
-                if (sid == wukong::math::hash_mod(s, Global::num_servers))
+                if (sid == Partitioner::server_of(s))
                     triple_sav[localtid].push_back(triple_attr_t(s, a, v));
             }
         };
@@ -341,12 +343,12 @@ protected:
                     sid_t o = kvs[i * 3 + 2];
 
                     // out-edges
-                    if (wukong::math::hash_mod(s, Global::num_servers) == sid)
+                    if (Partitioner::server_of(s) == sid)
                         if ((s % Global::num_engines) == tid)
                             triple_pso[tid].push_back(triple_t(s, p, o));
 
                     // in-edges
-                    if (wukong::math::hash_mod(o, Global::num_servers) == sid)
+                    if (Partitioner::server_of(o) == sid)
                         if ((o % Global::num_engines) == tid)
                             triple_pos[tid].push_back(triple_t(s, p, o));
 
@@ -377,6 +379,96 @@ protected:
         }
     }
 
+    // report the quality of graph partitioning, i.e., edge-cut (the fraction of
+    // edges across servers) and replication factor (#stored edges / #edges),
+    // since each edge across servers is stored on both sides.
+    void report_partition(vector<vector<triple_t>> &triple_pso) {
+        uint64_t local[2] = {0, 0}, total[2] = {0, 0};  // #edges, #cut edges
+        for (int tid = 0; tid < Global::num_engines; tid++) {
+            for (auto const &t : triple_pso[tid]) {
+                if (!is_vid(t.o)) continue;  // skip type edges (index vertices are everywhere)
+                local[0]++;
+                if (Partitioner::server_of(t.o) != sid) local[1]++;
+            }
+        }
+        MPI_Allreduce(local, total, 2, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+        if (sid == 0 && total[0] > 0)
+            logstream(LOG_INFO) << "partition (" << Partitioner::current()->name() << "): "
+                                << total[0] << " edges, edge-cut "
+                                << (100.0 * total[1] / total[0]) << "%, replication factor "
+                                << (double)(total[0] + total[1]) / total[0] << LOG_endl;
+    }
+
+    // replicate the edges of hot vertices (i.e., #edges > Global::hot_vertex_degree)
+    // to all servers, which are used to serve queries touching them locally
+    void replicate_hot_vertices(vector<vector<triple_t>> &triple_pso,
+                                vector<vector<triple_t>> &triple_pos) {
+        if (Global::hot_vertex_degree == 0 || Global::num_servers == 1)
+            return;
+
+        // the vertex is always assigned to the same engine by pso and pos (vid % #engines)
+        vector<vector<triple_t>> hot_pso(Global::num_engines), hot_pos(Global::num_engines);
+        #pragma omp parallel for num_threads(Global::num_engines)
+        for (int tid = 0; tid < Global::num_engines; tid++) {
+            boost::unordered_map<sid_t, uint64_t> degrees;
+            for (auto const &t : triple_pso[tid]) degrees[t.s]++;
+            for (auto const &t : triple_pos[tid])
+                if (is_vid(t.o)) degrees[t.o]++;
+
+            auto is_hot = [&](sid_t vid) {
+                return degrees[vid] > (uint64_t)Global::hot_vertex_degree;
+            };
+            for (auto const &t : triple_pso[tid])
+                if (is_hot(t.s)) hot_pso[tid].push_back(t);
+            for (auto const &t : triple_pos[tid])
+                if (is_vid(t.o) && is_hot(t.o)) hot_pos[tid].push_back(t);
+        }
+
+        // exchange the edges of hot vertices among all servers
+        auto allgather = [&](vector<vector<triple_t>> &local) {
+            vector<triple_t> triples;
+            for (auto const &v : local)
+                triples.insert(triples.end(), v.begin(), v.end());
+
+            uint64_t sz = triples.size() * sizeof(triple_t);
+            ASSERT(sz < INT_MAX);
+            vector<int> sizes(Global::num_servers), offs(Global::num_servers, 0);
+            int my_sz = sz;
+            MPI_Allgather(&my_sz, 1, MPI_INT, sizes.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+            uint64_t total = sizes[0];
+            for (int i = 1; i < Global::num_servers; i++) {
+                offs[i] = offs[i - 1] + sizes[i - 1];
+                total += sizes[i];
+            }
+            ASSERT(total < INT_MAX);
+
+            vector<triple_t> all(total / sizeof(triple_t));
+            MPI_Allgatherv(triples.data(), my_sz, MPI_BYTE, all.data(), sizes.data(),
+                           offs.data(), MPI_BYTE, MPI_COMM_WORLD);
+            return all;
+        };
+        vector<triple_t> all_pso = allgather(hot_pso);
+        vector<triple_t> all_pos = allgather(hot_pos);
+
+        ReplicaStore &replicas = gstore->replicas;
+        for (auto const &t : all_pso) replicas.add_hot_vertex(t.s);
+        for (auto const &t : all_pos) replicas.add_hot_vertex(t.o);
+
+        // the owner of hot vertices needs no replica
+        for (auto const &t : all_pso)
+            if (Partitioner::server_of(t.s) != sid)
+                replicas.insert(ikey_t(t.s, t.p, OUT), t.o);
+        for (auto const &t : all_pos)
+            if (Partitioner::server_of(t.o) != sid)
+                replicas.insert(ikey_t(t.o, t.p, IN), t.s);
+        replicas.commit();
+
+        logstream(LOG_INFO) << "#" << sid << ": replicate " << replicas.size() << " hot vertices ("
+                            << replicas.get_num_edges() << " edges)" << LOG_endl;
+    }
+
 public:
     BaseLoader(int sid, Mem *mem, StringServer *str_server, GStore *gstore)
         : sid(sid), mem(mem), str_server(str_server), gstore(gstore) { }
@@ -456,6 +548,16 @@ public:
         logstream(LOG_INFO) << "#" << sid << ": " << (end - start) / 1000 << " ms "
                             << "for aggregrating triples" << LOG_endl;
 
+        report_partition(triple_pso);
+
+        if (Global::hot_vertex_degree > 0) {
+            start = timer::get_usec();
+            replicate_hot_vertices(triple_pso, triple_pos);
+            end = timer::get_usec();
+            logstream(LOG_INFO) << "#" << sid << ": " << (end - start) / 1000 << " ms "
+                                << "for replicating hot vertices" << LOG_endl;
+        }
+
         // load attribute files
         start = timer::get_usec();
         load_attr_from_allfiles(afiles, triple_sav);
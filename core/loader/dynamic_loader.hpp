@@ -42,6 +42,8 @@
 #include "global.hpp"
 #include "type.hpp"
 #include "rdma.hpp"
+#include "result_cache.hpp"
+#include "partitioner.hpp"
 
 #include "store/dynamic_gstore.hpp"
 
@@ -183,12 +185,16 @@ public:
 
         int num_dfiles = dfiles.size();
 
+        // predicates (and types) touched by new triples, used to invalidate cached results
+        boost::unordered_set<ssid_t> touched_preds;
+
         // step 3: load triples into gstore
         // FIXME: dynamic loading triples doesn't update segment metadata. eg: num_keys, num_edges
         start = timer::get_usec();
         #pragma omp parallel for num_threads(Global::num_engines)
         for (int i = 0; i < num_dfiles; i++) {
             int64_t cnt = 0;
+            boost::unordered_set<ssid_t> preds;
 
             int64_t tid = omp_get_thread_num();
             /// FIXME: support HDFS
@@ -199,18 +205,30 @@ public:
                 /// FIXME: just check and print warning
                 check_sid(s); check_sid(p); check_sid(o);
 
-                if (sid == wukong::math::hash_mod(s, Global::num_servers)) {
+                // NOTE: every server reads all triples, so all proxies see the same predicates
+                preds.insert(p);
+                if (p == TYPE_ID)
+                    preds.insert(o);
+
+                if (sid == Partitioner::server_of(s)) {
                     gstore->insert_triple_out(triple_t(s, p, o), check_dup, tid);
                     cnt ++;
+                } else if (gstore->replicas.is_hot(s)) {
+                    gstore->replicas.insert(ikey_t(s, p, OUT), o);  // update the replica
                 }
 
-                if (sid == wukong::math::hash_mod(o, Global::num_servers)) {
+                if (sid == Partitioner::server_of(o)) {
                     gstore->insert_triple_in(triple_t(s, p, o), check_dup, tid);
                     cnt ++;
+                } else if (is_vid(o) && gstore->replicas.is_hot(o)) {
+                    gstore->replicas.insert(ikey_t(o, p, IN), s);  // update the replica
                 }
             }
             file.close();
 
+            #pragma omp critical
+            touched_preds.insert(preds.begin(), preds.end());
+
             logstream(LOG_INFO) << "load " << cnt << " triples from file " << dfiles[i]
                                 << " at server " << sid << LOG_endl;
         }
@@ -218,6 +236,9 @@ public:
         logstream(LOG_INFO) << "#" << sid << ": " << (end - start) / 1000 << "ms "
                             << "for inserting into gstore" << LOG_endl;
 
+        // publish the new edges of hot vertices to their replicas
+        gstore->replicas.commit(check_dup);
+
         flush_convertmap(); //clean the id2id mapping
 
         sort(afiles.begin(), afiles.end());
@@ -256,7 +277,7 @@ public:
                     break;
                 }
 
-                if (sid == wukong::math::hash_mod(s, Global::num_servers)) {
+                if (sid == Partitioner::server_of(s)) {
                     /// Support attribute files
                     // gstore->insert_triple_attribute(triple_sav_t(s, a, v));
                     cnt ++;
@@ -270,6 +291,12 @@ public:
 
         gstore->sync_metadata();
 
+        // invalidate cached results of local proxies after the new triples are visible
+        int ninvalid = ResultCache::get_cache().invalidate(touched_preds);
+        if (ninvalid > 0)
+            logstream(LOG_INFO) << "invalidate " << ninvalid << " cached results "
+                                << "at server " << sid << LOG_endl;
+
         return 0;
     }
 };
@@ -191,6 +191,20 @@ private:
     uint64_t rrbf_hd_off;
     uint64_t rrbf_hd_sz;
 
+    // The doorbells of ring buffers (#thread x #servers), written by senders (remote)
+    // with the tail of ring buffer after each msg, and polled by reciever (local).
+    // NOTE: the doorbells of a thread are contiguous, so an idle poll only touches
+    //       a few cache lines instead of the headers of #servers ring buffers.
+    char *dbl;
+    uint64_t dbl_off;
+    uint64_t dbl_sz;
+
+    // The (local) sources of RDMA WRITE to the remote doorbells (#threads),
+    // which are not in RDMA buffer since it may hold a msg being written.
+    char *dbl_buf;
+    uint64_t dbl_buf_off;
+    uint64_t dbl_buf_sz; // per thread
+
     vector<Broadcast_Mem *> bc_mems;
 public:
     Mem(int num_servers, int num_threads, vector<Broadcast_Mem *> bc_ms = vector<Broadcast_Mem *>())
@@ -207,14 +221,17 @@ public:
             buf_sz = rbf_sz = 0;
         }
 
-        lrbf_hd_sz = rrbf_hd_sz = sizeof(uint64_t);
+        lrbf_hd_sz = rrbf_hd_sz = dbl_sz = sizeof(uint64_t);
+        dbl_buf_sz = sizeof(uint64_t);
 
         // allocate memory and zeroing
         mem_sz = kvs_sz
                  + buf_sz * num_threads
                  + rbf_sz * num_servers * num_threads
                  + lrbf_hd_sz * num_servers * num_threads
-                 + rrbf_hd_sz * num_servers * num_threads;
+                 + rrbf_hd_sz * num_servers * num_threads
+                 + dbl_sz * num_servers * num_threads
+                 + dbl_buf_sz * num_threads;
         for (int i = 0; i < bc_mems.size(); i++)
             mem_sz += bc_mems[i]->mem_size();
 
@@ -239,7 +256,13 @@ public:
         rrbf_hd_off = lrbf_hd_off + lrbf_hd_sz * num_servers * num_threads;
         rrbf_hd =  mem + rrbf_hd_off;
 
-        uint64_t off = rrbf_hd_off + rrbf_hd_sz * num_servers * num_threads;
+        dbl_off = rrbf_hd_off + rrbf_hd_sz * num_servers * num_threads;
+        dbl = mem + dbl_off;
+
+        dbl_buf_off = dbl_off + dbl_sz * num_servers * num_threads;
+        dbl_buf = mem + dbl_buf_off;
+
+        uint64_t off = dbl_buf_off + dbl_buf_sz * num_threads;
 
         for (int i = 0; i < bc_mems.size(); i++) {
             bc_mems[i]->init(mem + off, off);
@@ -278,4 +301,13 @@ public:
     inline uint64_t remote_ring_head_offset(int tid, int sid) { return rrbf_hd_off + (rrbf_hd_sz * num_servers) * tid + rrbf_hd_sz * sid; }
     inline uint64_t remote_ring_head_size() { return rrbf_hd_sz; }
 
+    // metadata: doorbell of ring buffer
+    inline char *doorbell(int tid, int sid) { return dbl + (dbl_sz * num_servers) * tid + dbl_sz * sid; }
+    inline uint64_t doorbell_offset(int tid, int sid) { return dbl_off + (dbl_sz * num_servers) * tid + dbl_sz * sid; }
+    inline uint64_t doorbell_size() { return dbl_sz; }
+
+    // the source of RDMA WRITE to remote doorbells by thread(tid)
+    inline char *doorbell_buffer(int tid) { return dbl_buf + dbl_buf_sz * tid; }
+    inline uint64_t doorbell_buffer_offset(int tid) { return dbl_buf_off + dbl_buf_sz * tid; }
+
 }; // end of class Mem
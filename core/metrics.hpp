@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2016 Shanghai Jiao Tong University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://ipads.se.sjtu.edu.cn/projects/wukong
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <functional>
+
+#include "global.hpp"
+
+// utils
+#include "assertion.hpp"
+#include "histogram.hpp"
+
+using namespace std;
+
+// the counters updated by the threads (i.e., proxies, engines and GPU agent)
+enum counter_t {
+    ENGINE_BUSY_USEC = 0,   // the time engines spend on running queries
+    ENGINE_QUERIES,         // #(sub-)queries executed by engines
+    ENGINE_STEALS,          // #queries stolen from other engines (work-oblige)
+    MSGR_BATCHES,           // #batches of coalesced queries sent by engines
+    MSGR_BATCHED_QUERIES,   // #queries in the batches
+    ADAPTOR_MSGS_SENT,      // #msgs sent to remote servers (or by TCP/RDMA)
+    ADAPTOR_BYTES_SENT,
+    ADAPTOR_MSGS_RECV,
+    ADAPTOR_BYTES_RECV,
+    NUM_COUNTERS
+};
+
+/**
+ * A low-overhead registry of the metrics of a server.
+ *
+ * Each thread updates the counters and the histogram in its own slot w/o atomic
+ * operations and false sharing, and the slots are only aggregated lazily when
+ * the metrics are exported (e.g., by the 'stats' command or the HTTP endpoint).
+ * The aggregation may see a slightly stale value, which is fine for monitoring.
+ *
+ * The metrics owned by other components (e.g., queue depths and RDMA reads) are
+ * exported by collectors, i.e., callbacks registered by the component.
+ */
+class Metrics {
+private:
+    struct counter_desc_t {
+        const char *name;
+        const char *help;
+    };
+
+    struct slot_t {
+        uint64_t counters[NUM_COUNTERS];
+        Histogram exec_lat;  // the execution time (usec) of (sub-)queries on engines
+        char padding[64];
+
+        slot_t() { memset(counters, 0, sizeof(counters)); }
+    };
+
+    struct collector_t {
+        string name;
+        string help;
+        bool is_counter;    // counter or gauge
+        vector<function<double()>> fns;  // the values are summed
+    };
+
+    vector<slot_t> slots;
+    vector<collector_t> collectors;
+    pthread_spinlock_t lock;  // protect collectors
+
+    static const counter_desc_t *counter_descs() {
+        static const counter_desc_t descs[NUM_COUNTERS] = {
+            {"wukong_engine_busy_usec_total", "The time engines spend on running queries (usec)."},
+            {"wukong_engine_queries_total", "The number of (sub-)queries executed by engines."},
+            {"wukong_engine_steals_total", "The number of queries stolen from other engines."},
+            {"wukong_msgr_batches_total", "The number of batches of coalesced queries."},
+            {"wukong_msgr_batched_queries_total", "The number of queries in the batches."},
+            {"wukong_adaptor_msgs_sent_total", "The number of msgs sent by TCP/RDMA."},
+            {"wukong_adaptor_bytes_sent_total", "The bytes of msgs sent by TCP/RDMA."},
+            {"wukong_adaptor_msgs_recv_total", "The number of msgs received by TCP/RDMA."},
+            {"wukong_adaptor_bytes_recv_total", "The bytes of msgs received by TCP/RDMA."},
+        };
+        return descs;
+    }
+
+    Metrics() : slots(Global::num_threads + 1) {
+        pthread_spin_init(&lock, 0);
+    }
+
+public:
+    static Metrics &get_metrics() {
+        static Metrics metrics;
+        return metrics;
+    }
+
+    // NOTE: only called by the thread of @tid
+    inline void inc(int tid, counter_t c, uint64_t v = 1) {
+        if (tid < slots.size()) slots[tid].counters[c] += v;
+    }
+
+    inline void record_exec(int tid, uint64_t usec) {
+        if (tid < slots.size()) slots[tid].exec_lat.record(usec);
+    }
+
+    // the collectors with the same name are summed up (e.g., the queues of all engines)
+    void add_collector(string name, string help, bool is_counter, function<double()> fn) {
+        pthread_spin_lock(&lock);
+        for (auto &c : collectors) {
+            if (c.name == name) {
+                c.fns.push_back(fn);
+                pthread_spin_unlock(&lock);
+                return;
+            }
+        }
+        collector_t c = { name, help, is_counter, { fn } };
+        collectors.push_back(c);
+        pthread_spin_unlock(&lock);
+    }
+
+    uint64_t get_counter(counter_t c) {
+        uint64_t sum = 0;
+        for (auto const &s : slots) sum += s.counters[c];
+        return sum;
+    }
+
+    Histogram get_exec_latency() {
+        Histogram all;
+        for (auto const &s : slots) all.merge(s.exec_lat);
+        return all;
+    }
+
+    /**
+     * export all metrics in Prometheus text format (version 0.0.4), labelled by server,
+     * e.g., wukong_engine_queries_total{sid="0"} 1024
+     * @help: with the HELP and TYPE lines or not
+     */
+    string export_text(int sid, bool help = true) {
+        stringstream ss;
+        string label = "{sid=\"" + to_string(sid) + "\"}";
+        auto header = [&](const string & name, const string & desc, const string & type) {
+            if (!help) return;
+            ss << "# HELP " << name << " " << desc << "\n";
+            ss << "# TYPE " << name << " " << type << "\n";
+        };
+
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            const counter_desc_t &d = counter_descs()[c];
+            header(d.name, d.help, "counter");
+            ss << d.name << label << " " << get_counter((counter_t)c) << "\n";
+        }
+
+        pthread_spin_lock(&lock);
+        vector<collector_t> cs = collectors;
+        pthread_spin_unlock(&lock);
+        for (auto const &c : cs) {
+            double v = 0;
+            for (auto const &fn : c.fns) v += fn();
+            header(c.name, c.help, c.is_counter ? "counter" : "gauge");
+            ss << c.name << label << " " << (uint64_t)v << "\n";
+        }
+
+        Histogram h = get_exec_latency();
+        string name = "wukong_engine_exec_usec";
+        header(name, "The execution time of (sub-)queries on engines (usec).", "summary");
+        for (double q : {0.5, 0.99, 0.999})
+            ss << name << "{sid=\"" << sid << "\",quantile=\"" << q << "\"} "
+               << h.percentile(q) << "\n";
+        ss << name << "_sum" << label << " " << h.get_sum() << "\n";
+        ss << name << "_count" << label << " " << h.count() << "\n";
+        return ss.str();
+    }
+};
+
+/**
+ * A tiny HTTP server exporting the metrics of a server in Prometheus text format,
+ * which only listens on the loopback interface, e.g.,
+ * $curl http://127.0.0.1:<global_metrics_port>/metrics
+ */
+class MetricsServer {
+private:
+    int sid;
+    int port;
+
+    static void *run(void *arg) {
+        MetricsServer *server = (MetricsServer *)arg;
+        server->serve();
+        return NULL;
+    }
+
+    void serve() {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        int opt = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+            logstream(LOG_ERROR) << "#" << sid << ": failed to listen on metrics port "
+                                 << port << " (" << strerror(errno) << ")" << LOG_endl;
+            close(fd);
+            return;
+        }
+        logstream(LOG_INFO) << "#" << sid << ": export metrics on http://127.0.0.1:"
+                            << port << "/metrics" << LOG_endl;
+
+        while (true) {
+            int conn = accept(fd, NULL, NULL);
+            if (conn < 0) continue;
+
+            // only the request line matters (e.g., GET /metrics HTTP/1.1)
+            char buf[1024];
+            ssize_t n = recv(conn, buf, sizeof(buf) - 1, 0);
+            buf[n > 0 ? n : 0] = '\0';
+
+            string status = "200 OK", body;
+            if (strncmp(buf, "GET /metrics", 12) == 0 || strncmp(buf, "GET / ", 6) == 0)
+                body = Metrics::get_metrics().export_text(sid);
+            else
+                status = "404 Not Found";
+
+            string resp = "HTTP/1.1 " + status + "\r\n"
+                          + "Content-Type: text/plain; version=0.0.4\r\n"
+                          + "Content-Length: " + to_string(body.size()) + "\r\n"
+                          + "Connection: close\r\n\r\n" + body;
+            for (size_t off = 0; off < resp.size();) {
+                ssize_t sent = send(conn, resp.data() + off, resp.size() - off, MSG_NOSIGNAL);
+                if (sent <= 0) break;
+                off += sent;
+            }
+            close(conn);
+        }
+    }
+
+public:
+    MetricsServer(int sid, int port) : sid(sid), port(port) { }
+
+    // serve in a detached thread
+    void start() {
+        pthread_t thread;
+        pthread_create(&thread, NULL, run, (void *)this);
+        pthread_detach(thread);
+    }
+};
@@ -23,11 +23,15 @@
 #pragma once
 
 #include <iostream>
+#include <fstream>
+#include <iomanip>
 #include <map>
-#include <boost/serialization/unordered_map.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/serialization/vector.hpp>
 
 // utils
 #include "assertion.hpp"
+#include "histogram.hpp"
 #include "timer.hpp"
 #include "unit.hpp"
 
@@ -38,14 +42,13 @@ private:
     struct req_stats {
         int query_type;
         uint64_t start_time = 0ull;
-        uint64_t end_time = 0ull;
+    };
 
-        template <typename Archive>
-        void serialize(Archive &ar, const unsigned int version) {
-            ar & query_type;
-            ar & start_time;
-            ar & end_time;
-        }
+    // the percentiles of latency in a window (i.e., an interval of print_timely_thpt)
+    struct window_stats {
+        double time;    // the end of the window (sec)
+        float thpt;     // queries/sec
+        uint64_t cnt, p50, p99, p999;
     };
 
     uint64_t init_time = 0ull, done_time = 0ull;
@@ -60,13 +63,32 @@ private:
     float thpt = 0.0;
 
     int nquery_types = 0;
-    bool is_aggregated = false;
 
-    // key: query_type, value: latency of query
-    // ordered by query_type
-    std::map<int, vector<uint64_t>> total_latency_map;
+    uint64_t ncancelled = 0ull; // #queries cancelled due to the deadline
+
+    uint64_t ncache_lookups = 0ull; // #lookups of result cache
+    uint64_t ncache_hits = 0ull;    // #queries served by result cache
+
+    uint64_t max_pending = 0ull;    // max #pending msgs on a proxy
+
+    uint64_t plan_time = 0ull;  // total time (usec) of query planning
+    uint64_t nplans = 0ull;     // #queries planned
 
-    unordered_map<int, req_stats> stats_map; // CDF
+    // the in-flight queries (key: pqid), bounded by the #queries on the fly
+    boost::unordered_map<int, req_stats> inflight_map;
+
+    // the latency histogram of each query type (indexed by query_type)
+    vector<Histogram> latency_hists;
+
+    // the latency histogram of all queries in current window, and the timeline
+    // of windows (only kept by the proxy printing timely throughput)
+    Histogram window_hist;
+    vector<window_stats> timeline;
+
+    static bool ends_with(const string &str, const string &suffix) {
+        return str.size() >= suffix.size()
+               && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
 
 public:
     void init() {
@@ -75,20 +97,22 @@ public:
     }
 
     void init(int nquery_types) {
-        is_aggregated = false;
         this->nquery_types = nquery_types;
         done_time = 0ull;
         last_cnt = 0ull;
         thpt_time = 0ull;
         cnt = 0ull;
         thpt = 0.0;
+        ncancelled = 0ull;
+        ncache_lookups = ncache_hits = 0ull;
+        max_pending = 0ull;
+        plan_time = nplans = 0ull;
         init_time = timer::get_usec();
         last_time = last_separator = timer::get_usec();
-        stats_map.clear();
-        total_latency_map.clear();
-        for (int i = 0; i < nquery_types; ++i) {
-            total_latency_map[i] = std::vector<uint64_t>();
-        }
+        inflight_map.clear();
+        latency_hists.assign(nquery_types, Histogram());
+        window_hist.reset();
+        timeline.clear();
     }
 
     void finish() {
@@ -102,7 +126,7 @@ public:
 
     void set_interval(uint64_t update) { interval = update; }
 
-    // print the throughput of a fixed interval
+    // print the throughput and the latency percentiles of a fixed interval
     void print_timely_thpt(uint64_t cur_cnt, int sid, int tid) {
         // for brevity, only print the timely thpt of a single proxy.
         if (!(sid == 0 && tid == 0)) return;
@@ -111,9 +135,21 @@ public:
         // periodically print timely throughput
         if ((now - last_time) > interval) {
             float cur_thpt = 1000000.0 * (cur_cnt - last_cnt) / (now - last_time);
-            logstream(LOG_INFO) << "Throughput: " << cur_thpt / 1000.0 << "K queries/sec" << LOG_endl;
+            window_stats w;
+            w.time = (double)(now - init_time) / SEC(1);
+            w.thpt = cur_thpt;
+            w.cnt = window_hist.count();
+            w.p50 = window_hist.percentile(0.5);
+            w.p99 = window_hist.percentile(0.99);
+            w.p999 = window_hist.percentile(0.999);
+            timeline.push_back(w);
+
+            logstream(LOG_INFO) << "Throughput: " << cur_thpt / 1000.0 << "K queries/sec"
+                                << " (latency p50/p99/p99.9: " << w.p50 << "/" << w.p99
+                                << "/" << w.p999 << " usec)" << LOG_endl;
             last_time = now;
             last_cnt = cur_cnt;
+            window_hist.reset();
         }
 
         // print separators per second
@@ -132,70 +168,91 @@ public:
         thpt = 1000000.0 * (end - cnt) / (timer::get_usec() - thpt_time);
     }
 
+    float get_thpt() { return thpt; }
+
+    // the latency (usec) at the given rate of all queries
+    uint64_t get_latency(double rate) {
+        Histogram all;
+        for (auto const &h : latency_hists)
+            all.merge(h);
+        return all.percentile(rate);
+    }
+
     void print_thpt() {
         logstream(LOG_INFO) << "Throughput: " << thpt / 1000.0 << "K queries/sec" << LOG_endl;
+        if (ncache_lookups > 0)
+            logstream(LOG_INFO) << "Result cache hit rate: "
+                                << (100.0 * ncache_hits / ncache_lookups) << "% ("
+                                << ncache_hits << "/" << ncache_lookups << ")" << LOG_endl;
+        if (max_pending > 0)
+            logstream(LOG_INFO) << "Max pending msgs (per proxy): " << max_pending << LOG_endl;
+    }
+
+    void pending_record(uint64_t depth) {
+        max_pending = max(max_pending, depth);
+    }
+
+    void plan_record(uint64_t usec) {
+        plan_time += usec;
+        nplans++;
+    }
+
+    void print_plan_time() {
+        if (nplans > 0)
+            logstream(LOG_INFO) << "Planning time: " << (plan_time / nplans) << " usec (average of "
+                                << nplans << " queries)" << LOG_endl;
+    }
+
+    void cache_record(bool hit) {
+        ncache_lookups++;
+        if (hit) ncache_hits++;
     }
 
-    void start_record(int reqid, int type) {
-        stats_map[reqid].query_type = type;
-        stats_map[reqid].start_time = timer::get_usec() - init_time;
+    // @start_time: the time (usec) the query is sent or scheduled to be sent
+    void start_record(int reqid, int type, uint64_t start_time = timer::get_usec()) {
+        ASSERT(type >= 0 && type < nquery_types);
+        req_stats &s = inflight_map[reqid];
+        s.query_type = type;
+        s.start_time = start_time;
     }
 
     void end_record(int reqid) {
-        stats_map[reqid].end_time = timer::get_usec() - init_time;
+        auto it = inflight_map.find(reqid);
+        ASSERT(it != inflight_map.end());
+
+        uint64_t now = timer::get_usec();
+        uint64_t lat = (now > it->second.start_time) ? (now - it->second.start_time) : 0;
+        latency_hists[it->second.query_type].record(lat);
+        window_hist.record(lat);
+        inflight_map.erase(it);
     }
 
-    // calculate each query's cdf, then sort respectively
-    void aggregate() {
-        for (auto const &s : stats_map)
-            total_latency_map[s.second.query_type].push_back(s.second.end_time - s.second.start_time);
+    // the cancelled query is excluded from latency statistics
+    void cancel_record(int reqid) {
+        inflight_map.erase(reqid);
+        ncancelled++;
+    }
 
-        // sort
-        for (int i = 0; i < nquery_types; ++i) {
-            vector<uint64_t> &lats = total_latency_map[i];
-            if (!lats.empty())
-                sort(lats.begin(), lats.end());
-        }
-        is_aggregated = true;
+    void print_cancelled() {
+        if (ncancelled > 0)
+            logstream(LOG_INFO) << "Cancelled: " << ncancelled
+                                << " queries (exceed the deadline)" << LOG_endl;
     }
 
     void print_cdf() {
-        ASSERT(is_aggregated);
-
         vector<double> cdf_rates = {0.01};
 
         // 5% >> 95%
         for (int i = 1; i < 20; i++)
             cdf_rates.push_back(0.05 * i);
 
-        // 96% >> 100%
-        for (int i = 1; i <= 5; i++)
+        // 96% >> 100% (w/ 99.9%)
+        for (int i = 1; i <= 5; i++) {
             cdf_rates.push_back(0.95 + i * 0.01);
-
-        logstream(LOG_INFO) << "Per-query CDF graph" << LOG_endl;
-        int cnt, query_type;//, query_cnt = 0;
-        std::map<int, vector<uint64_t>> cdf_res;
-
-        // select 25 points from total_latency_map
-        for (auto &e : total_latency_map) {
-            query_type = e.first;
-            vector<uint64_t> &lats = e.second;
-
-            if (lats.empty()) continue;
-
-            cnt = 0;
-            // result of CDF figure
-            cdf_res[query_type] = std::vector<uint64_t>();
-            // select points from lats corresponding to cdf_rates
-            for (auto const &rate : cdf_rates) {
-                int idx = lats.size() * rate;
-                if (idx >= lats.size()) idx = lats.size() - 1;
-                cdf_res[query_type].push_back(lats[idx]);
-                cnt++;
-            }
-            ASSERT(cdf_res[query_type].size() == 25);
+            if (i == 4) cdf_rates.push_back(0.999);
         }
 
+        logstream(LOG_INFO) << "Per-query CDF graph" << LOG_endl;
         logstream(LOG_INFO) << "CDF Res: " << LOG_endl;
         logstream(LOG_INFO) << "P";
         for (int i = 1; i <= nquery_types; ++i)
@@ -203,31 +260,92 @@ public:
         logstream(LOG_INFO) << LOG_endl;
 
         // print cdf data
-        for (int row = 1; row <= 25; ++row) {
-            if (row == 1)
-                logstream(LOG_INFO) << row << "\t";
-            else if (row <= 20)
-                logstream(LOG_INFO) << 5 * (row - 1) << "\t";
-            else
-                logstream(LOG_INFO) << 95 + (row - 20) << "\t";
-
+        for (auto const &rate : cdf_rates) {
+            logstream(LOG_INFO) << (rate * 100) << "\t";
             for (int i = 0; i < nquery_types; ++i)
-                logstream(LOG_INFO) << cdf_res[i][row - 1] << "\t";
+                logstream(LOG_INFO) << latency_hists[i].percentile(rate) << "\t";
             logstream(LOG_INFO) << LOG_endl;
         }
     }
 
+    /**
+     * dump the latency of each query type and the timeline of windows into a file
+     * in JSON (if the file name ends with ".json") or CSV format, e.g.,
+     * window,type,count,thpt,mean,p50,p90,p99,p999,max
+     * 0.5,all,10502,21003.9,,391,,2807,4388,
+     * total,Q1,105402,,467.3,388,702,2890,4403,13373
+     */
+    bool dump_latency(string fname) {
+        ofstream ofs(fname.c_str());
+        if (!ofs.good()) {
+            logstream(LOG_ERROR) << "Can't open/create output file: " << fname << LOG_endl;
+            return false;
+        }
+
+        ofs << fixed << setprecision(1);
+        if (ends_with(fname, ".json")) {
+            ofs << "{\"throughput\": " << thpt << ", \"cancelled\": " << ncancelled
+                << ",\n \"queries\": [";
+            for (int i = 0; i < nquery_types; i++) {
+                const Histogram &h = latency_hists[i];
+                ofs << (i ? ",\n  " : "\n  ")
+                    << "{\"type\": \"Q" << (i + 1) << "\", \"count\": " << h.count()
+                    << ", \"mean\": " << h.mean() << ", \"p50\": " << h.percentile(0.5)
+                    << ", \"p90\": " << h.percentile(0.9) << ", \"p99\": " << h.percentile(0.99)
+                    << ", \"p999\": " << h.percentile(0.999) << ", \"max\": " << h.max() << "}";
+            }
+            ofs << "],\n \"timeline\": [";
+            for (size_t i = 0; i < timeline.size(); i++) {
+                const window_stats &w = timeline[i];
+                ofs << (i ? ",\n  " : "\n  ")
+                    << "{\"time\": " << w.time << ", \"count\": " << w.cnt
+                    << ", \"thpt\": " << w.thpt << ", \"p50\": " << w.p50
+                    << ", \"p99\": " << w.p99 << ", \"p999\": " << w.p999 << "}";
+            }
+            ofs << "]}" << endl;
+        } else {
+            ofs << "window,type,count,thpt,mean,p50,p90,p99,p999,max" << endl;
+            for (auto const &w : timeline)
+                ofs << w.time << ",all," << w.cnt << "," << w.thpt << ",," << w.p50
+                    << ",," << w.p99 << "," << w.p999 << "," << endl;
+            for (int i = 0; i < nquery_types; i++) {
+                const Histogram &h = latency_hists[i];
+                ofs << "total,Q" << (i + 1) << "," << h.count() << ",," << h.mean()
+                    << "," << h.percentile(0.5) << "," << h.percentile(0.9)
+                    << "," << h.percentile(0.99) << "," << h.percentile(0.999)
+                    << "," << h.max() << endl;
+            }
+        }
+        ofs.close();
+        return true;
+    }
+
     void merge(Monitor & other) {
-        if (nquery_types < other.nquery_types) nquery_types = other.nquery_types;
-        for (auto const &s : other.stats_map)
-            stats_map[s.first] = s.second;
+        if (nquery_types < other.nquery_types) {
+            nquery_types = other.nquery_types;
+            latency_hists.resize(nquery_types);
+        }
+        for (int i = 0; i < other.nquery_types; i++)
+            latency_hists[i].merge(other.latency_hists[i]);
         thpt += other.thpt;
+        ncancelled += other.ncancelled;
+        ncache_lookups += other.ncache_lookups;
+        ncache_hits += other.ncache_hits;
+        max_pending = max(max_pending, other.max_pending);
+        plan_time += other.plan_time;
+        nplans += other.nplans;
     }
 
     template <typename Archive>
     void serialize(Archive & ar, const unsigned int version) {
         ar & nquery_types;
-        ar & stats_map;
+        ar & latency_hists;
         ar & thpt;
+        ar & ncancelled;
+        ar & ncache_lookups;
+        ar & ncache_hits;
+        ar & max_pending;
+        ar & plan_time;
+        ar & nplans;
     }
 };
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2016 Shanghai Jiao Tong University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://ipads.se.sjtu.edu.cn/projects/wukong
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "global.hpp"
+
+// utils
+#include "assertion.hpp"
+#include "logger2.hpp"
+#include "math.hpp"
+
+using namespace std;
+
+/**
+ * The partitioning function of the RDF graph, which assigns each (normal) vertex with
+ * all of its edges to a server. All components (loaders, gstore, engines and proxies)
+ * must consult the same one via Partitioner::server_of().
+ */
+class Partitioner {
+public:
+    virtual ~Partitioner() { }
+
+    // the server storing the given vertex
+    virtual int locate(uint64_t vid) = 0;
+
+    virtual string name() = 0;
+
+    static Partitioner *&current();
+
+    static int server_of(uint64_t vid) { return current()->locate(vid); }
+
+    // use the vid-to-server table in given file, or hashing if the file name is empty
+    static void init(string fname);
+};
+
+// the default partitioner, i.e., vid % #servers
+class HashPartitioner : public Partitioner {
+public:
+    int locate(uint64_t vid) { return wukong::math::hash_mod(vid, Global::num_servers); }
+
+    string name() { return "hash"; }
+};
+
+/**
+ * A partitioner with the vid-to-server table computed offline (see datagen/partition.cpp),
+ * which co-locates vertices linked with each other to reduce both replicated edges and
+ * cross-server traffic. The vertices out of the table (e.g., index vertices and vertices
+ * inserted later) fall back to hashing.
+ */
+class TablePartitioner : public Partitioner {
+private:
+    static const uint16_t NONE = 0xFFFF;
+
+    uint64_t base = 0;        // the min vid in the table
+    vector<uint16_t> table;   // indexed by (vid - base), dense for normal vertices
+
+public:
+    // the file consists of lines of "vid sid"
+    TablePartitioner(string fname) {
+        ifstream file(fname.c_str());
+        if (!file) {
+            logstream(LOG_ERROR) << "partition file " << fname << " does not exist." << LOG_endl;
+            ASSERT(false);
+        }
+
+        vector<pair<uint64_t, int>> entries;
+        uint64_t vid, max_vid = 0;
+        int sid;
+        base = UINT64_MAX;
+        while (file >> vid >> sid) {
+            ASSERT(sid >= 0 && sid < Global::num_servers);
+            entries.push_back(make_pair(vid, sid));
+            base = min(base, vid);
+            max_vid = max(max_vid, vid);
+        }
+
+        if (entries.empty()) {
+            base = 0;
+            return;
+        }
+
+        table.resize(max_vid - base + 1, NONE);
+        for (auto const &e : entries)
+            table[e.first - base] = e.second;
+    }
+
+    int locate(uint64_t vid) {
+        if (vid >= base && vid - base < table.size() && table[vid - base] != NONE)
+            return table[vid - base];
+        return wukong::math::hash_mod(vid, Global::num_servers);
+    }
+
+    string name() { return "table"; }
+
+    size_t size() { return table.size(); }
+};
+
+inline Partitioner *&Partitioner::current() {
+    static Partitioner *p = new HashPartitioner();
+    return p;
+}
+
+inline void Partitioner::init(string fname) {
+    if (fname.empty()) return;  // keep hashing
+
+    TablePartitioner *p = new TablePartitioner(fname);
+    logstream(LOG_INFO) << "load the partition of " << p->size()
+                        << " vertices from " << fname << LOG_endl;
+
+    delete current();
+    current() = p;
+}
@@ -3,11 +3,13 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <sstream>
 #include <boost/unordered_map.hpp>
 #include <boost/algorithm/string.hpp>
 #include <math.h>
 
 #include "stats.hpp"
+#include "feedback.hpp"
 
 // utils
 #include "timer.hpp"
@@ -28,6 +30,13 @@ using namespace std;
 #define CC_unknown 0.139
 #define CACHE_ratio 0 // 0 or 0.537 or 1/1.86
 
+#define MAX_CACHED_PLANS 4096  // the plan cache is flushed when full
+
+// the dynamic-programming enumeration is used for queries with at most
+// MAX_DP_PATTERNS patterns, otherwise fall back to the greedy heuristic
+#define MAX_DP_PATTERNS 16
+#define MAX_PLAN_PATTERNS 64    // the width of pattern bitmask
+
 struct plan {
     double cost;           // min cost
     double result_num;     // intermediate results
@@ -96,6 +105,40 @@ class Planner {
     vector<ssid_t> min_path;
     int _chains_size_div_4 ;
 
+    // for dynamic programming
+    // a (partial) left-deep plan covering a set of patterns
+    struct dp_state {
+        double cost = 0;
+        double results = 0;
+        vector<ssid_t> path;
+        vector<double> tytable;
+        int col_num = 0;
+        unordered_map<ssid_t, int> var2col;
+    };
+    // key: <picked patterns, <the first and the last of starting pattern>>
+    // NOTE: the cost model depends on the starting pattern (see dup_flag in plan_enum),
+    // so only the subplans with the same start are comparable
+    typedef pair<uint64_t, pair<ssid_t, ssid_t>> dp_key;
+    typedef boost::unordered_map<dp_key, dp_state> dp_layer;
+    dp_layer *dp_next = nullptr;  // the layer to record expanded plans
+
+    // for plan cache
+    // the plan is shared by queries with the same shape, where constants
+    // (normal vertices) are abstracted to their types and replaced by slots
+    struct cached_plan {
+        bool success;
+        vector<SPARQLQuery::Pattern> patterns; // planned patterns
+        vector<int> slots;          // slot of subject/object (2 per pattern), -1 means not a slot
+        vector<double> estimates;   // estimated cardinality of constant in each slot
+        CardFeedback::snapshot_t feedback;  // the observed selectivities used by the plan
+    };
+    boost::unordered_map<string, cached_plan> plan_cache;
+    uint64_t plan_cache_hits = 0ull, plan_cache_misses = 0ull;
+
+    // for cardinality feedback
+    CardFeedback feedback;
+    CardFeedback::snapshot_t used_feedback;  // looked up by the current planning
+
     // remove the attr pattern query before doing the planner and transfer pattern to cmd_chains
     void transfer_to_cmd_chains(vector<SPARQLQuery::Pattern> &p,
                                 vector<ssid_t> &attr_pattern,
@@ -214,29 +257,35 @@ class Planner {
         }
     }
 
-    // type-centric dfs enumeration
-    bool plan_enum(SPARQLQuery &r, unsigned int pt_bits, double cost, double pre_results) {
-        //if (is_empty) return false;
-        if (pt_bits == ( 1 << _chains_size_div_4 ) - 1) {
-            //cout << "estimated cost : " << cost << endl;
-            //finalpath ++;
-            bool ctn = true;
-            if (min_cost == std::numeric_limits<double>::max()
-                    && cost < COST_THRESHOLD
-                    && (path[0] >= (1 << NBITS_IDX)) ) {
-                ctn = false;  // small query
-                //cout << "small query and use heuristic.\n";
-            }
-            //cout << "this path cost: " << cost
-            //     << "-------------------------------------" << endl;
-            if (cost < min_cost) {
-                min_cost = cost;
-                min_path = path;
-            }
-            return ctn;
-        }
+    // correct the estimated #rows of a pattern step (i.e., the counts in the updated
+    // type table w/ ncols columns) by its observed selectivity, if any
+    // @rows_in: the estimated #rows before the step (1 for a constant start)
+    // @return: the ratio of corrected #rows to the estimated one
+    double correct_by_feedback(ssid_t p, int d, int bind, ssid_t type, double rows_in,
+                               vector<double> &table, int ncols) {
+        CardFeedback::key_t key = {p, d, bind, type};
+        double selectivity;
+        bool found = feedback.lookup(key, selectivity);
+        used_feedback[key] = found ? selectivity : -1;
+        if (!found) return 1;
+
+        double rows_out = 0;
+        for (size_t j = 0; j < table.size(); j += ncols)
+            rows_out += table[j];
+        if (rows_out <= 0) return 1; // no type to carry the rows
+
+        double ratio = selectivity * rows_in / rows_out;
+        for (size_t j = 0; j < table.size(); j += ncols)
+            table[j] *= ratio;
+        return ratio;
+    }
+
+    // type-centric expansion of a (partial) plan by one more pattern
+    // each candidate is handed over to dp_record() with the updated state
+    // (i.e., path, type_table, and var2col), which is restored afterwards
+    bool plan_enum(SPARQLQuery &r, uint64_t pt_bits, double cost, double pre_results) {
         for (int pt_pick = 0; pt_pick < _chains_size_div_4; pt_pick++) {
-            if ( pt_bits & ( 1 << pt_pick ) )
+            if ( pt_bits & ( 1ull << pt_pick ) )
                 continue ;
             int i = 4 * pt_pick;
             double add_cost = 0;
@@ -303,7 +352,7 @@ class Planner {
                     type_table.set_col_num(2);
 
                     // next iteration
-                    bool ctn = plan_enum(r, pt_bits, new_cost, condprune_results); // next level
+                    bool ctn = dp_record(r, pt_bits, new_cost, condprune_results); // next level
                     //cout << "back : " << p << " " << "0" << " " << IN << " " << o1
                     //     << "-------------------------------------" << endl;
                     if (!ctn) return ctn;
@@ -361,7 +410,7 @@ class Planner {
                     type_table.set_col_num(2);
 
                     // next iteration
-                    ctn = plan_enum(r, pt_bits, new_cost, condprune_results);
+                    ctn = dp_record(r, pt_bits, new_cost, condprune_results);
                     //cout << "back : " << p << " " << "0" << " " << OUT << " " << o2
                     //     << "-------------------------------------" << endl;
                     if (!ctn) return ctn;
@@ -408,6 +457,8 @@ class Planner {
                         updated_result_table.push_back(vcount);
                         updated_result_table.push_back(vtype);
                     }
+                    correct_by_feedback(p, d, SPARQLQuery::Cardinality::FROM_CONST, o1type, 1,
+                                        updated_result_table, 2);
 
                     // calculate cost
                     for (size_t j = 0; j < updated_result_table.size(); j += 2) {
@@ -436,7 +487,7 @@ class Planner {
                     type_table.set_col_num(2);
 
                     // next iteration
-                    bool ctn = plan_enum(r, (pt_bits | (1 << pt_pick)), new_cost, condprune_results);
+                    bool ctn = dp_record(r, (pt_bits | (1ull << pt_pick)), new_cost, condprune_results);
                     //cout << "back : " << o1 << " " << p << " " << d << " " << o2
                     //     << "-------------------------------------" << endl;
                     if (!ctn) return ctn;
@@ -500,6 +551,8 @@ class Planner {
                             updated_result_table.push_back(vcount);
                             updated_result_table.push_back(vtype);
                         }
+                        correct_by_feedback(p, IN, SPARQLQuery::Cardinality::FROM_CONST, o2type, 1,
+                                            updated_result_table, 2);
                     }
 
                     // calculate cost
@@ -530,7 +583,7 @@ class Planner {
                     type_table.set_col_num(2);
 
                     // next iteration and backtrack
-                    bool ctn = plan_enum(r, (pt_bits | (1 << pt_pick)), new_cost, condprune_results);
+                    bool ctn = dp_record(r, (pt_bits | (1ull << pt_pick)), new_cost, condprune_results);
                     //cout << "back : " << o2 << " " << p << " " << IN << " " << o1
                     //     << "-------------------------------------" << endl;
                     if (!ctn) return ctn;
@@ -569,6 +622,7 @@ class Planner {
                     int prune_flag = (o2 > 0) || ((var2col.find(o2) != var2col.end()) && var2col[o2] > 0);
                     int dup_flag = (path[0] == p) && (path[3] == o1);
                     double max = 0;
+                    double pre_sum = 0;  // #rows before the step
                     for (size_t i = 0; i < row_num; i++) {
                         double pre_count = type_table.get_row_col(i, 0);
                         max = (max > pre_count) ? max : pre_count;
@@ -577,6 +631,7 @@ class Planner {
                         ssid_t pre_tyid = type_table.get_row_col(i, var_col);
                         double pre_count = type_table.get_row_col(i, 0);
                         if (100 * pre_count < max || pre_count < MINIMUM_COUNT_THRESHOLD) continue;
+                        pre_sum += pre_count;
                         //cout << "pre_tyid: " << pre_tyid << " pre_count: " << pre_count << endl;
                         // handle type predicate first
                         if (p == TYPE_ID && o2 > 0) {
@@ -647,6 +702,18 @@ class Planner {
                         }
                     }
 
+                    // prefer the observed selectivity of the step (type checks are exact)
+                    if (p != TYPE_ID) {
+                        int bind = (o2 > 0) ? SPARQLQuery::Cardinality::TO_CONST
+                                   : (prune_flag ? SPARQLQuery::Cardinality::TO_KNOWN
+                                      : SPARQLQuery::Cardinality::TO_UNKNOWN);
+                        double ratio = correct_by_feedback(p, d, bind, (o2 > 0) ? get_type(o2) : 0,
+                                                           pre_sum, updated_result_table,
+                                                           type_table.get_col_num() + (prune_flag ? 0 : 1));
+                        condprune_results *= ratio;
+                        if (!prune_flag) correprune_boost_results *= ratio;
+                    }
+
 //                    if (condprune_results == 0) {
 //                        is_empty = true;
 //                        return false;
@@ -681,12 +748,12 @@ class Planner {
                     // may make the situation worse.
                     if (enable_merge) {
                         bool hasO1 = false;
-                        unsigned int curr_bits = (pt_bits | (1 << pt_pick));
+                        uint64_t curr_bits = (pt_bits | (1ull << pt_pick));
                         // if not end of plan
-                        if (curr_bits != ( 1 << _chains_size_div_4 ) - 1) {
+                        if (curr_bits != full_bits()) {
                             for (int i = 0; i < _chains_size_div_4; i ++) {
                                 // if i'th pattern is not picked
-                                if (!(curr_bits & (1 << i))) {
+                                if (!(curr_bits & (1ull << i))) {
                                     if (triples[4 * i] == o1 || triples[4 * i + 3] == o1) {
                                         hasO1 = true;
                                         break;
@@ -702,7 +769,7 @@ class Planner {
 #endif
 
                     // next iteration
-                    bool ctn = plan_enum(r, (pt_bits | (1 << pt_pick)), new_cost, condprune_results);
+                    bool ctn = dp_record(r, (pt_bits | (1ull << pt_pick)), new_cost, condprune_results);
                     //cout << "back : " << o1 << " " << p << " " << d << " " << o2
                     //     << "-------------------------------------" << endl;
                     if (!ctn) return ctn;
@@ -741,6 +808,7 @@ class Planner {
                     int prune_flag = (o1 > 0) || ((var2col.find(o1) != var2col.end()) && var2col[o1] > 0);
                     int dup_flag = (path[0] == p) && (path[3] == o2);
                     double max = 0;
+                    double pre_sum = 0;  // #rows before the step
                     for (size_t i = 0; i < row_num; i++) {
                         double pre_count = type_table.get_row_col(i, 0);
                         max = (max > pre_count) ? max : pre_count;
@@ -749,6 +817,7 @@ class Planner {
                         ssid_t pre_tyid = type_table.get_row_col(i, var_col);
                         double pre_count = type_table.get_row_col(i, 0);
                         if (100 * pre_count < max || pre_count < MINIMUM_COUNT_THRESHOLD) continue;
+                        pre_sum += pre_count;
                         //cout << "pre_tyid: " << pre_tyid << " pre_count: " << pre_count << endl;
                         int tycount = stats->global_tyscount[pre_tyid];
                         if (dup_flag) tycount = stats->global_tystat.get_potype_count(p, pre_tyid);
@@ -800,6 +869,18 @@ class Planner {
                         }
                     }
 
+                    // prefer the observed selectivity of the step (type checks are exact)
+                    if (p != TYPE_ID) {
+                        int bind = (o1 > 0) ? SPARQLQuery::Cardinality::TO_CONST
+                                   : (prune_flag ? SPARQLQuery::Cardinality::TO_KNOWN
+                                      : SPARQLQuery::Cardinality::TO_UNKNOWN);
+                        double ratio = correct_by_feedback(p, IN, bind, (o1 > 0) ? get_type(o1) : 0,
+                                                           pre_sum, updated_result_table,
+                                                           type_table.get_col_num() + (prune_flag ? 0 : 1));
+                        condprune_results *= ratio;
+                        if (!prune_flag) correprune_boost_results *= ratio;
+                    }
+
 //                    if (condprune_results == 0) {
 //                        is_empty = true;
 //                        return false;
@@ -832,12 +913,12 @@ class Planner {
                     // if no access to o2 any more, we can merge entries about o2 in type table
                     if (enable_merge) {
                         bool hasO2 = false;
-                        unsigned int curr_bits = (pt_bits | (1 << pt_pick));
+                        uint64_t curr_bits = (pt_bits | (1ull << pt_pick));
                         // if not end of plan
-                        if (curr_bits != ( 1 << _chains_size_div_4 ) - 1) {
+                        if (curr_bits != full_bits()) {
                             for (int i = 0; i < _chains_size_div_4; i ++) {
                                 // if i'th pattern is not picked
-                                if (!(curr_bits & (1 << i))) {
+                                if (!(curr_bits & (1ull << i))) {
                                     if (triples[4 * i] == o2 || triples[4 * i + 3] == o2) {
                                         hasO2 = true;
                                         break;
@@ -853,7 +934,7 @@ class Planner {
 #endif
 
                     // next iteration
-                    bool ctn = plan_enum(r, (pt_bits | (1 << pt_pick)), new_cost, condprune_results);
+                    bool ctn = dp_record(r, (pt_bits | (1ull << pt_pick)), new_cost, condprune_results);
                     //cout << "back : " << o2 << " " << p << " " << IN << " " << o1
                     //     << "-------------------------------------" << endl;
                     if (!ctn) return ctn;
@@ -873,6 +954,76 @@ class Planner {
         return true;
     }
 
+    inline uint64_t full_bits() {
+        return (_chains_size_div_4 == MAX_PLAN_PATTERNS) ?
+               ~0ull : ((1ull << _chains_size_div_4) - 1);
+    }
+
+    // record a plan expanded by plan_enum, only the cheapest one is kept
+    // for the same set of patterns (i.e., memoization of subplans)
+    bool dp_record(SPARQLQuery &r, uint64_t pt_bits, double cost, double pre_results) {
+        ASSERT(dp_next != nullptr);
+        dp_key key = make_pair(pt_bits, make_pair(path[0], path[3]));
+
+        auto it = dp_next->find(key);
+        if (it != dp_next->end() && it->second.cost <= cost)
+            return true;
+
+        dp_state &st = (*dp_next)[key];
+        st.cost = cost;
+        st.results = pre_results;
+        st.path = path;
+        st.tytable = type_table.tytable;
+        st.col_num = type_table.get_col_num();
+        st.var2col = var2col;
+        return true; // continue
+    }
+
+    // enumerate left-deep plans over connected sets of patterns layer by layer,
+    // where each layer adds one more pattern to the cheapest subplans of previous layer.
+    // The greedy heuristic only keeps the cheapest subplan for each starting pattern.
+    // NOTE: min_cost is used as the upper bound to prune subplans
+    void dp_enum(SPARQLQuery &r, bool greedy) {
+        dp_layer frontier, next;
+        frontier[make_pair(0ull, make_pair((ssid_t)0, (ssid_t)0))] = dp_state();
+
+        dp_next = &next;
+        while (!frontier.empty()) {
+            for (auto &e : frontier) {
+                dp_state &st = e.second;
+                path.swap(st.path);
+                type_table.tytable.swap(st.tytable);
+                type_table.set_col_num(st.col_num);
+                var2col.swap(st.var2col);
+
+                plan_enum(r, e.first.first, st.cost, st.results);
+            }
+            frontier.clear();
+
+            // the cheapest subplan for each starting pattern (greedy)
+            boost::unordered_map<pair<ssid_t, ssid_t>, dp_layer::iterator> best;
+            for (auto it = next.begin(); it != next.end(); it++) {
+                if (it->first.first == full_bits()) {
+                    if (it->second.cost < min_cost) {
+                        min_cost = it->second.cost;
+                        min_path = it->second.path;
+                    }
+                } else if (!greedy) {
+                    frontier.insert(*it);
+                } else {
+                    auto b = best.find(it->first.second);
+                    if (b == best.end() || it->second.cost < b->second->second.cost)
+                        best[it->first.second] = it;
+                }
+            }
+
+            for (auto &b : best)
+                frontier.insert(*b.second);
+            next.clear();
+        }
+        dp_next = nullptr;
+    }
+
     // for debug single order
     bool score_order_new(unsigned int index, double cost, double pre_results) {
         if (index == _chains_size_div_4 * 4) {
@@ -1440,7 +1591,7 @@ class Planner {
         return true;
     }
 
-    bool do_patterns(SPARQLQuery &r, vector<SPARQLQuery::Pattern> &patterns, bool test) {
+    bool plan_patterns(SPARQLQuery &r, vector<SPARQLQuery::Pattern> &patterns, bool test) {
         //input : patterns
         //transform to : _chains_size_div_4, triples, temp_cmd_chains
         vector<ssid_t> temp_cmd_chains;
@@ -1500,7 +1651,22 @@ class Planner {
         if (num_no_endpoint > 3) enable_merge = true;
 #endif
 
-        plan_enum(r, 0, 0, 0); // the traverse function
+        if (_chains_size_div_4 > MAX_PLAN_PATTERNS) {
+            logstream(LOG_WARNING) << "too many patterns (" << _chains_size_div_4
+                                   << "), keep the original order" << LOG_endl;
+            min_path = triples;
+        } else {
+            // the greedy plan also bounds the cost of the following enumeration
+            dp_enum(r, true);
+            if (_chains_size_div_4 <= MAX_DP_PATTERNS)
+                dp_enum(r, false);
+        }
+
+        // e.g., the patterns are not connected
+        if (min_path.size() == 0) {
+            logstream(LOG_WARNING) << "no plan is found, keep the original order" << LOG_endl;
+            min_path = triples;
+        }
 
         if (is_empty == true) {
             cout << "identified empty result query." << endl;
@@ -1577,6 +1743,127 @@ class Planner {
         return true;
     }
 
+    inline bool is_const_vertex(ssid_t id) { return id >= (1 << NBITS_IDX); }
+
+    // estimate the number of edges of a constant with type @ctype on predicate @p
+    // (@d is the direction from the constant), using the same statistics as plan_enum
+    double estimate_const(ssid_t ctype, ssid_t p, dir_t d) {
+        int tycount = (d == OUT) ? stats->global_tystat.get_pstype_count(p, ctype)
+                      : stats->global_tystat.get_potype_count(p, ctype);
+        if (tycount == 0) return 0;
+
+        auto key = (d == OUT) ? make_pair(ctype, p) : make_pair(p, ctype);
+        auto it = stats->global_tystat.fine_type.find(key);
+        if (it == stats->global_tystat.fine_type.end()) return 0;
+
+        double nedges = 0;
+        for (auto const &tc : it->second)
+            nedges += tc.count;
+        return nedges / tycount;
+    }
+
+    // generate the shape (key) of patterns for plan cache,
+    // and collect constants (@slots) and their estimated cardinality (@estimates)
+    string plan_shape(SPARQLQuery &r, vector<SPARQLQuery::Pattern> &patterns,
+                      vector<ssid_t> &slots, vector<double> &estimates) {
+        stringstream ss;
+        ss << r.mt_factor << "|";
+        for (auto const &pt : patterns) {
+            ssid_t vs[2] = {pt.subject, pt.object};
+            for (int k = 0; k < 2; k++) {
+                if (!is_const_vertex(vs[k])) {
+                    ss << vs[k] << " ";
+                    if (k == 0) ss << pt.predicate << " " << pt.direction << " ";
+                    continue;
+                }
+
+                // the same constant at different positions must be kept in the shape
+                int eq = find(slots.begin(), slots.end(), vs[k]) - slots.begin();
+                ssid_t ctype = get_type(vs[k]);
+                dir_t d = (k == 0) ? pt.direction : ((pt.direction == OUT) ? IN : OUT);
+
+                slots.push_back(vs[k]);
+                estimates.push_back(estimate_const(ctype, pt.predicate, d));
+                ss << "c" << ctype << "#" << eq << " ";
+                if (k == 0) ss << pt.predicate << " " << pt.direction << " ";
+            }
+            ss << (int)pt.pred_type << ";";
+        }
+        return ss.str();
+    }
+
+    // the cached plan is stale if the estimated cardinality of any constant
+    // differs by Global::plan_replan_factor (e.g., statistics is updated),
+    // or so does any observed selectivity used by the plan
+    bool is_stale(const cached_plan &plan, const vector<double> &estimates) {
+        if (feedback.changed(plan.feedback))
+            return true;
+
+        ASSERT(plan.estimates.size() == estimates.size());
+        for (int i = 0; i < estimates.size(); i++) {
+            double lo = max(min(plan.estimates[i], estimates[i]), MINIMUM_COUNT_THRESHOLD);
+            double hi = max(plan.estimates[i], estimates[i]);
+            if (hi > lo * Global::plan_replan_factor)
+                return true;
+        }
+        return false;
+    }
+
+    void cache_plan(const string &shape, bool success, const vector<SPARQLQuery::Pattern> &patterns,
+                    const vector<ssid_t> &slots, const vector<double> &estimates) {
+        if (plan_cache.size() >= MAX_CACHED_PLANS)
+            plan_cache.clear();
+
+        cached_plan &plan = plan_cache[shape];
+        plan.success = success;
+        plan.patterns = patterns;
+        plan.estimates = estimates;
+        plan.feedback = used_feedback;
+        plan.slots.clear();
+        for (auto const &pt : patterns) {
+            ssid_t vs[2] = {pt.subject, pt.object};
+            for (int k = 0; k < 2; k++) {
+                int idx = find(slots.begin(), slots.end(), vs[k]) - slots.begin();
+                plan.slots.push_back((is_const_vertex(vs[k]) && idx < slots.size()) ? idx : -1);
+            }
+        }
+    }
+
+    // instantiate the cached plan with constants of current query
+    void apply_plan(const cached_plan &plan, const vector<ssid_t> &slots,
+                    vector<SPARQLQuery::Pattern> &patterns) {
+        patterns = plan.patterns;
+        for (int i = 0; i < patterns.size(); i++) {
+            if (plan.slots[2 * i] >= 0)
+                patterns[i].subject = slots[plan.slots[2 * i]];
+            if (plan.slots[2 * i + 1] >= 0)
+                patterns[i].object = slots[plan.slots[2 * i + 1]];
+        }
+    }
+
+    bool do_patterns(SPARQLQuery &r, vector<SPARQLQuery::Pattern> &patterns, bool test) {
+        // NOTE: testing plan always searches the plan to measure the optimization time
+        if (test || !Global::enable_plan_cache)
+            return plan_patterns(r, patterns, test);
+
+        vector<ssid_t> slots;
+        vector<double> estimates;
+        string shape = plan_shape(r, patterns, slots, estimates);
+
+        auto it = plan_cache.find(shape);
+        if (it != plan_cache.end() && !is_stale(it->second, estimates)) {
+            plan_cache_hits++;
+            apply_plan(it->second, slots, patterns);
+            return it->second.success;
+        }
+
+        plan_cache_misses++;
+        used_feedback.clear();
+        bool success = plan_patterns(r, patterns, test);
+        cache_plan(shape, success, patterns, slots, estimates);
+        return success;
+    }
+
     // generate plan for given pattern group
     bool do_group(SPARQLQuery &r, SPARQLQuery::PatternGroup &group, bool test) {
         bool success = true;
@@ -1688,13 +1975,55 @@ public:
     // generate optimal query plan by optimizer
     // @return
     bool generate_plan(SPARQLQuery &r) {
-        return do_plan(r, false);
+        stats->read_lock();
+        bool success = do_plan(r, false);
+        stats->unlock();
+        return success;
     }
 
     // test query optimizing (search an optimal plan)
     // @return
     bool test_plan(SPARQLQuery &r) {
-        return do_plan(r, true);
+        stats->read_lock();
+        bool success = do_plan(r, true);
+        stats->unlock();
+        return success;
+    }
+
+    // learn the observed selectivities from the actual cardinality of a (replied) query
+    void learn(SPARQLQuery &r) {
+        if (!r.card.enabled || r.result.status_code != SUCCESS)
+            return;
+
+        stats->read_lock();
+        for (auto const &st : r.card.steps) {
+            // the #rows from index and the type checks are exactly estimated
+            if (st.bind < 0 || st.bind == SPARQLQuery::Cardinality::FROM_INDEX
+                    || st.predicate == TYPE_ID)
+                continue;
+
+            ssid_t type = 0;
+            if (st.bind == SPARQLQuery::Cardinality::FROM_CONST)
+                type = get_type(st.start);
+            else if (st.bind == SPARQLQuery::Cardinality::TO_CONST)
+                type = get_type(st.end);
+            feedback.observe(st.predicate, st.direction, st.bind, type, st.rows_in, st.rows_out);
+        }
+        stats->unlock();
+    }
+
+    void print_plan_cache() {
+        uint64_t total = plan_cache_hits + plan_cache_misses;
+        if (total > 0)
+            logstream(LOG_INFO) << "Plan cache: " << plan_cache.size() << " plans, hit rate "
+                                << (100.0 * plan_cache_hits / total) << "% ("
+                                << plan_cache_hits << "/" << total << ")" << LOG_endl;
+
+        if (feedback.lookups > 0)
+            logstream(LOG_INFO) << "Plan feedback: " << feedback.size() << " selectivities, hit rate "
+                                << (100.0 * feedback.hits / feedback.lookups) << "% ("
+                                << feedback.hits << "/" << feedback.lookups << "), "
+                                << feedback.version << " changes" << LOG_endl;
     }
 
     // set user-defuned query plan
@@ -25,6 +25,7 @@
 #include <boost/unordered_set.hpp>
 #include <boost/unordered_map.hpp>
 #include <unistd.h>
+#include <random>
 
 #include "global.hpp"
 #include "coder.hpp"
@@ -34,8 +35,11 @@
 #include "stats.hpp"
 #include "string_server.hpp"
 #include "monitor.hpp"
+#include "result_cache.hpp"
+#include "partitioner.hpp"
 
 #include "comm/adaptor.hpp"
+#include "comm/pending.hpp"
 
 // utils
 #include "errors.hpp"
@@ -52,17 +56,10 @@ std::vector<Proxy *> proxies;
 class Proxy {
 
 private:
-    class Message {
-    public:
-        int sid;
-        int tid;
-        Bundle bundle;
+    PendingMsgs pending; // pending msgs to send
 
-        Message(int sid, int tid, Bundle &bundle)
-            : sid(sid), tid(tid), bundle(bundle) { }
-    };
-
-    vector<Message> pending_msgs; // pending msgs to send
+    // tickets of in-flight queries missed in result cache, key: pqid
+    boost::unordered_map<int, ResultCache::ticket_t> pending_tickets;
 
     // Collect candidate constants of all template types in given template query.
     // Result is in ptypes_grp of given template query.
@@ -129,17 +126,13 @@ private:
     }
 
     // Send given bundle to given thread(@dst_tid) in given server(@dst_sid).
-    // Return false if it fails. Bundle is pending in pending_msgs.
+    // Return false if it fails. Bundle is pending in pending msgs.
     inline bool send(Bundle &bundle, int dst_sid, int dst_tid) {
-        if (adaptor->send(dst_sid, dst_tid, bundle))
-            return true;
-
-        pending_msgs.push_back(Message(dst_sid, dst_tid, bundle));
-        return false;
+        return pending.send(dst_sid, dst_tid, bundle);
     }
 
     // Send given bundle to certain engine in given server(@dst_sid).
-    // Return false if it fails. Bundle is pending in pending_msgs.
+    // Return false if it fails. Bundle is pending in pending msgs.
     inline bool send(Bundle &bundle, int dst_sid) {
         // NOTE: the partitioned mapping has better tail latency in batch mode
         int range = Global::num_engines / Global::num_proxies;
@@ -151,27 +144,57 @@ private:
         int dst_eid = coder.get_random() % range;
 
         // If the preferred engine is busy, try the rest engines with round robin
+        // (the msg is moved only if sent)
+        string str = bundle.to_str();
         for (int i = 0; i < range; i++)
-            if (adaptor->send(dst_sid, base + (dst_eid + i) % range, bundle))
+            if (pending.try_send(dst_sid, base + (dst_eid + i) % range, std::move(str)))
                 return true;
 
-        pending_msgs.push_back(Message(dst_sid, (base + dst_eid), bundle));
-        return false;
+        return pending.send(dst_sid, (base + dst_eid), std::move(str));
+    }
+
+    // Send given query to certain engine in given server(@dst_sid).
+    // The query is passed w/o serialization if the server is the local one.
+    inline bool send(SPARQLQuery &r, int dst_sid) {
+        int range = Global::num_engines / Global::num_proxies;
+        ASSERT(range > 0);
+
+        int dst_tid = Global::num_proxies + (range * tid) + coder.get_random() % range;
+        if (adaptor->is_local(dst_sid, dst_tid))
+            return adaptor->send(dst_sid, dst_tid, r);
+
+        Bundle bundle(r);
+        return send(bundle, dst_sid);
     }
 
     // Try send all msgs in pending_msgs.
     inline void sweep_msgs() {
-        if (!pending_msgs.size()) return;
+        if (!pending.size()) return;
 
-        logstream(LOG_DEBUG) << "#" << tid << " " << pending_msgs.size()
+        logstream(LOG_DEBUG) << "#" << tid << " " << pending.size()
                              << " pending msgs on proxy." << LOG_endl;
-        for (vector<Message>::iterator it = pending_msgs.begin();
-                it != pending_msgs.end();) {
-            if (adaptor->send(it->sid, it->tid, it->bundle))
-                it = pending_msgs.erase(it);
-            else
-                ++it;
-        }
+        pending.sweep();
+    }
+
+    // Try to serve the query by result cache. Otherwise, keep its ticket
+    // to insert the result when the reply arrives.
+    // Return true if hit.
+    bool lookup_cache(SPARQLQuery &r, ResultCache::ticket_t &ticket) {
+        ResultCache &rcache = ResultCache::get_cache();
+        if (rcache.lookup(ticket, r.result.blind, r.result))
+            return true;
+
+        pending_tickets[r.pqid] = ticket;
+        return false;
+    }
+
+    // Insert the result of a missed query into result cache.
+    void fill_cache(SPARQLQuery &reply) {
+        auto it = pending_tickets.find(reply.pqid);
+        if (it == pending_tickets.end()) return;
+
+        ResultCache::get_cache().insert(it->second, reply.result);
+        pending_tickets.erase(it);
     }
 
 public:
@@ -179,6 +202,7 @@ public:
     int tid;    // thread id
 
     StringServer *str_server;
+    DGraph *graph;
     Adaptor *adaptor;
     Stats *stats;
 
@@ -188,7 +212,8 @@ public:
 
     Proxy(int sid, int tid, StringServer *str_server, DGraph * graph,
           Adaptor *adaptor, Stats *stats)
-        : sid(sid), tid(tid), str_server(str_server), adaptor(adaptor), stats(stats),
+        : pending(adaptor), sid(sid), tid(tid), str_server(str_server), graph(graph),
+          adaptor(adaptor), stats(stats),
           coder(sid, tid), parser(str_server), planner(tid, graph, stats) { }
 
     void setpid(SPARQLQuery &r) { r.pqid = coder.get_and_inc_qid(); }
@@ -201,16 +226,30 @@ public:
     void send_request(SPARQLQuery &r) {
         ASSERT(r.pqid != -1);
 
+        // the query and all of its sub-queries will be cancelled after the deadline
+        r.root_pqid = r.pqid;
+        r.deadline = (Global::query_timeout_ms > 0) ?
+                     (timer::get_usec() + MSEC(Global::query_timeout_ms)) : 0;
+
+        // take back the actual cardinality of pattern steps as feedback to planner
+        r.card.enabled = Global::enable_planner && (Global::plan_feedback_size > 0)
+                         && (r.dev_type == SPARQLQuery::DeviceType::CPU);
+
         // submit the request to a certain server
-        int start_sid = wukong::math::hash_mod(r.pattern_group.get_start(), Global::num_servers);
-        Bundle bundle(r);
+        int start_sid = Partitioner::server_of(r.pattern_group.get_start());
 
         if (r.dev_type == SPARQLQuery::DeviceType::CPU) {
+            // the edges of hot vertices are replicated to all servers, so the query starting
+            // from them is served locally (the non-replicated data is read by RDMA)
+            if (Global::use_rdma && graph->gstore->replicas.is_hot(r.pattern_group.get_start()))
+                start_sid = sid;
+
             logstream(LOG_DEBUG) << "dev_type is CPU, send to engine. r.pqid=" << r.pqid << LOG_endl;
-            send(bundle, start_sid);
+            send(r, start_sid);
 #ifdef USE_GPU
         } else if (r.dev_type == SPARQLQuery::DeviceType::GPU) {
             logstream(LOG_DEBUG) << "dev_type is GPU, send to GPU agent. r.pqid=" << r.pqid << LOG_endl;
+            Bundle bundle(r);
             send(bundle, start_sid, WUKONG_GPU_AGENT_TID);
 #endif
         } else {
@@ -219,10 +258,10 @@ public:
     }
 
     // Recv reply from engines.
+    // NOTE: the replies from local engines bypass the adaptor (see Adaptor::tryrecv_local)
     SPARQLQuery recv_reply(void) {
-        Bundle bundle = adaptor->recv();
-        ASSERT(bundle.type == SPARQL_QUERY);
-        SPARQLQuery r = bundle.get_sparql_query();
+        SPARQLQuery r;
+        while (!tryrecv_reply(r)) ; // polling both local queue and network
         logstream(LOG_DEBUG) << "Proxy recv_reply: got reply qid=" << r.qid << ", r.pqid=" << r.pqid
                              << ", dev_type=" << (r.dev_type == SPARQLQuery::DeviceType::GPU ? "GPU" : "CPU")
                              << ", #rows=" << r.result.get_row_num() << ", step=" << r.pattern_step
@@ -232,13 +271,18 @@ public:
 
     // Try recv reply from engines.
     bool tryrecv_reply(SPARQLQuery &r) {
-        Bundle bundle;
-        bool success = adaptor->tryrecv(bundle);
-        if (success) {
-            ASSERT(bundle.type == SPARQL_QUERY);
-            r = bundle.get_sparql_query();
+        bool success = adaptor->tryrecv_local(r);
+        if (!success) {
+            Bundle bundle;
+            success = adaptor->tryrecv(bundle);
+            if (success) {
+                ASSERT(bundle.type == SPARQL_QUERY);
+                r = bundle.get_sparql_query();
+            }
         }
 
+        if (success && r.card.enabled)
+            planner.learn(r);
         return success;
     }
 
@@ -273,6 +317,43 @@ public:
         output_result(cout, q, row2prt);
     }
 
+    // print the execution profile (EXPLAIN ANALYZE) of current query as a tree,
+    // where the stages of sub-queries are indented under the stage spawning them
+    void print_profile(SPARQLQuery &q) {
+        auto name = [&](ssid_t id) -> string {
+            if (id < 0) return "?" + to_string(-id);
+            if (id == TYPE_ID) return "rdf:type";
+            if (id == PREDICATE_ID) return "__PREDICATE__";
+            return str_server->exist(id) ? str_server->id2str(id) : to_string(id);
+        };
+
+        uint64_t total_reads = 0, total_hits = 0, total_bytes = 0;
+        logstream(LOG_INFO) << "Execution profile (EXPLAIN ANALYZE):" << LOG_endl;
+        for (auto const &rec : q.profile.records) {
+            stringstream ss;
+            ss << string(2 * rec.depth, ' ') << "[" << rec.sid << "-" << rec.tid << "] " << rec.op;
+            if (rec.step >= 0) ss << " #" << rec.step;
+            if (rec.pattern.size() == 4)
+                ss << " (" << name(rec.pattern[0]) << " " << name(rec.pattern[1])
+                   << " " << (rec.pattern[2] == OUT ? "->" : "<-")
+                   << " " << name(rec.pattern[3]) << ")";
+            ss << " time=" << rec.time << "us"
+               << " rows=" << rec.rows_in << "->" << rec.rows_out;
+            if (rec.remote_reads > 0) ss << " remote-reads=" << rec.remote_reads;
+            if (rec.cache_hits > 0) ss << " cache-hits=" << rec.cache_hits;
+            if (rec.bytes_sent > 0) ss << " bytes-sent=" << rec.bytes_sent;
+            logstream(LOG_INFO) << ss.str() << LOG_endl;
+
+            total_reads += rec.remote_reads;
+            total_hits += rec.cache_hits;
+            total_bytes += rec.bytes_sent;
+        }
+        logstream(LOG_INFO) << "Total: " << q.profile.records.size() << " stages"
+                            << ", remote-reads=" << total_reads
+                            << ", cache-hits=" << total_hits
+                            << ", bytes-sent=" << total_bytes << LOG_endl;
+    }
+
     // dump result of current query to specific file
     void dump_result(string path, SPARQLQuery &q, int row2prt) {
         if (boost::starts_with(path, "hdfs:")) {
@@ -295,9 +376,10 @@ public:
     // Run a single query for @cnt times. Command is "-f"
     // @is: input
     // @reply: result
+    // @analyze: profile the execution of the last run (i.e., EXPLAIN ANALYZE)
     int run_single_query(istream &is, istream &fmt_stream, int nopts,
                          int mt_factor, bool snd2gpu, int cnt, int nlines, string ofname,
-                         SPARQLQuery &reply, Monitor &monitor) {
+                         SPARQLQuery &reply, Monitor &monitor, bool analyze = false) {
         uint64_t start, end;
         SPARQLQuery request;
 
@@ -312,6 +394,12 @@ public:
         end = timer::get_usec();
         logstream(LOG_INFO) << "Parsing time: " << (end - start) << " usec" << LOG_endl;
 
+        // the ticket of result cache should be taken before planning
+        ResultCache &rcache = ResultCache::get_cache();
+        ResultCache::ticket_t ticket;
+        if (rcache.enabled())
+            ticket = rcache.make_ticket(request);
+
         // Generate query plan if SPARQL optimizer is enabled.
         // FIXME: currently, the optimizater only works for standard SPARQL query.
         if (Global::enable_planner) {
@@ -353,21 +441,39 @@ public:
         }
 
         // Execute the SPARQL query
+        int nhits = 0;
         monitor.init();
         for (int i = 0; i < cnt; i++) {
             setpid(request);
             // only take back results of the last request if not silent
             request.result.blind = i < (cnt - 1) ? true : Global::silent;
+            request.profile.enabled = analyze && (i == cnt - 1);
+
+            if (rcache.enabled()) {
+                reply = request;
+                if (lookup_cache(reply, ticket)) {
+                    nhits++;
+                    continue;
+                }
+            }
 
             send_request(request);
             reply = recv_reply();
+            fill_cache(reply);
         }
         monitor.finish();
 
+        if (nhits > 0)
+            logstream(LOG_INFO) << nhits << "/" << cnt << " runs are served by result cache" << LOG_endl;
+
         // Check result status
         if (reply.result.status_code == SUCCESS) {
             logstream(LOG_INFO) << "(last) result size: " << reply.result.row_num << LOG_endl;
 
+            // NOTE: no profile if the query is served by result cache
+            if (reply.profile.enabled && !reply.profile.records.empty())
+                print_profile(reply);
+
             // print or dump results
             if (!Global::silent) {
                 if (nlines > 0)
@@ -387,8 +493,12 @@ public:
     // Run a query emulator for @d seconds. Command is "-b"
     // Warm up for @w firstly, then measure throughput.
     // Latency is evaluated for @d seconds.
-    // Proxy keeps @p queries in flight.
-    int run_query_emu(istream &is, istream &fmt_stream, int d, int w, int p, Monitor &monitor) {
+    // Proxy keeps @p queries in flight (closed-loop), or sends queries at @rate
+    // queries/sec (open-loop) w/ Poisson (@poisson) or constant inter-arrival times.
+    // In open-loop, the latency is measured from the scheduled send time, so that
+    // the queries delayed by a backlogged proxy are not omitted.
+    int run_query_emu(istream &is, istream &fmt_stream, int d, int w, int p, Monitor &monitor,
+                      double rate = 0, bool poisson = true) {
         uint64_t duration = SEC(d);
         uint64_t warmup = SEC(w);
         int parallel_factor = p;
@@ -469,39 +579,89 @@ public:
 
         monitor.init(ntypes);
 
+        ResultCache &rcache = ResultCache::get_cache();
+        pending_tickets.clear();
+        pending.reset_max_size();
+
         bool start = false; // start to measure throughput
         uint64_t send_cnt = 0, recv_cnt = 0, flying_cnt = 0;
 
-        uint64_t init = timer::get_usec();
-        // send requeries for duration seconds
-        while ((timer::get_usec() - init) < duration) {
-            // send requests
-            for (int i = 0; i < parallel_factor - flying_cnt; i++) {
-                sweep_msgs(); // sweep pending msgs first
-
-                int idx = wukong::math::get_distribution(coder.get_random(), loads);
-                SPARQLQuery r = idx < nlights ?
-                                tpls[idx].instantiate(coder.get_random()) : // light query
-                                heavy_reqs[idx - nlights]; // heavy query
-
-                if (Global::enable_planner)
-                    planner.generate_plan(r);
+        // send a query, which is scheduled at @sched (usec)
+        auto issue = [&](uint64_t sched) {
+            int idx = wukong::math::get_distribution(coder.get_random(), loads);
+            SPARQLQuery r = idx < nlights ?
+                            tpls[idx].instantiate(coder.get_random()) : // light query
+                            heavy_reqs[idx - nlights]; // heavy query
+
+            setpid(r);
+            r.result.blind = true; // always not take back results for emulator
+
+            // the repeated query is done without planning and execution if hit
+            if (rcache.enabled()) {
+                ResultCache::ticket_t ticket = rcache.make_ticket(r);
+                bool hit = lookup_cache(r, ticket);
+                monitor.cache_record(hit);
+                if (hit) {
+                    monitor.start_record(r.pqid, idx, sched);
+                    monitor.end_record(r.pqid);
+                    send_cnt++;
+                    recv_cnt++;
+                    return;
+                }
+            }
 
-                setpid(r);
-                r.result.blind = true; // always not take back results for emulator
+            if (Global::enable_planner) {
+                uint64_t t = timer::get_usec();
+                planner.generate_plan(r);
+                monitor.plan_record(timer::get_usec() - t);
+            }
 
-                if (r.start_from_index()) {
+            if (r.start_from_index()) {
 #ifdef USE_GPU
-                    r.dev_type = SPARQLQuery::DeviceType::GPU;
+                r.dev_type = SPARQLQuery::DeviceType::GPU;
 #else
-                    r.mt_factor = Global::mt_threshold;
+                r.mt_factor = Global::mt_threshold;
 #endif
-                }
+            }
+
+            monitor.start_record(r.pqid, idx, sched);
+            send_request(r);
 
-                monitor.start_record(r.pqid, idx);
-                send_request(r);
+            send_cnt++;
+        };
 
-                send_cnt++;
+        // the inter-arrival time (usec) of open-loop
+        std::mt19937_64 gen(coder.get_random());
+        std::exponential_distribution<double> exp_dist(rate > 0 ? rate / SEC(1) : 1.0);
+        auto next_arrival = [&]() -> double {
+            return poisson ? exp_dist(gen) : SEC(1) / rate;
+        };
+
+        uint64_t init = timer::get_usec();
+        double next_send = init;  // the scheduled time of the next query (open-loop)
+        // send requeries for duration seconds
+        while ((timer::get_usec() - init) < duration) {
+            // send requests
+            if (rate > 0) {
+                // open-loop: send all queries scheduled before now
+                uint64_t now = timer::get_usec();
+                while (next_send <= now) {
+                    sweep_msgs(); // sweep pending msgs first
+                    if (pending.backlogged())
+                        break;  // backpressure: the delayed queries are still timed from next_send
+
+                    issue((uint64_t)next_send);
+                    next_send += next_arrival();
+                }
+            } else {
+                // closed-loop: keep parallel_factor queries in flight
+                for (int i = 0; i < parallel_factor - flying_cnt; i++) {
+                    sweep_msgs(); // sweep pending msgs first
+                    if (pending.backlogged())
+                        break;  // backpressure: wait for the pending msgs to drain
+
+                    issue(timer::get_usec());
+                }
             }
 
             // recieve replies (best of effort)
@@ -509,7 +669,11 @@ public:
                 SPARQLQuery r;
                 while (tryrecv_reply(r)) {
                     recv_cnt++;
-                    monitor.end_record(r.pqid);
+                    if (r.result.status_code == QUERY_TIMEOUT)
+                        monitor.cancel_record(r.pqid);
+                    else
+                        monitor.end_record(r.pqid);
+                    fill_cache(r);
                 }
             }
 
@@ -533,14 +697,23 @@ public:
             SPARQLQuery r;
             while (tryrecv_reply(r)) {
                 recv_cnt ++;
-                monitor.end_record(r.pqid);
+                if (r.result.status_code == QUERY_TIMEOUT)
+                    monitor.cancel_record(r.pqid);
+                else
+                    monitor.end_record(r.pqid);
+                fill_cache(r);
             }
 
             monitor.print_timely_thpt(recv_cnt, sid, tid);
         }
 
+        monitor.pending_record(pending.max_size());
         monitor.finish();
 
+        // for brevity, only print the plan cache of a single proxy
+        if (Global::enable_planner && sid == 0 && tid == 0)
+            planner.print_plan_cache();
+
         return 0; // success
     } // end of run_query_emu
 
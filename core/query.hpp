@@ -29,6 +29,7 @@
 #include <boost/serialization/set.hpp>
 #include <boost/serialization/variant.hpp>
 #include <boost/serialization/split_free.hpp>
+#include <map>
 #include <set>
 #include <vector>
 #include <cstring>
@@ -39,6 +40,7 @@
 
 // utils
 #include "logger2.hpp"
+#include "timer.hpp"
 #include "variant.hpp"
 
 using namespace std;
@@ -61,9 +63,9 @@ enum vtype { ENTITY = 0, ATTRIBUTE };
 
 
 // conversion between col and ext
-int col2ext(int col, int t) { return ((t << NBITS_COL) | col); }
-int ext2col(int ext) { return (ext & ((1 << NBITS_COL) - 1)); }
-int ext2type(int ext) { return ((ext >> NBITS_COL) & ((1 << NBITS_COL) - 1)); }
+inline int col2ext(int col, int t) { return ((t << NBITS_COL) | col); }
+inline int ext2col(int ext) { return (ext & ((1 << NBITS_COL) - 1)); }
+inline int ext2type(int ext) { return ((ext >> NBITS_COL) & ((1 << NBITS_COL) - 1)); }
 
 /**
  * SPARQL Query
@@ -248,6 +250,172 @@ public:
             : id(_id), descending(_descending) { }
     };
 
+    /**
+     * The execution profile of a query (i.e., EXPLAIN ANALYZE), which records each
+     * stage (e.g., pattern step, fork-join, union, optional, filter and final) on
+     * each server. The profiles of sub-queries are merged into their parent by RMap,
+     * following the record of the stage (e.g., fork-join) which spawns them.
+     */
+    class Profile {
+    private:
+        friend class boost::serialization::access;
+        template <typename Archive>
+        void serialize(Archive &ar, const unsigned int version) {
+            ar & enabled;
+            ar & depth;
+            ar & records;
+        }
+
+    public:
+        class Record {
+        private:
+            friend class boost::serialization::access;
+            template <typename Archive>
+            void serialize(Archive &ar, const unsigned int version) {
+                ar & op;
+                ar & sid;
+                ar & tid;
+                ar & depth;
+                ar & step;
+                ar & pattern;
+                ar & time;
+                ar & rows_in;
+                ar & rows_out;
+                ar & remote_reads;
+                ar & cache_hits;
+                ar & bytes_sent;
+            }
+
+        public:
+            string op;              // pattern, corun, dispatch, fork-join, union, ...
+            int sid = 0;
+            int tid = 0;
+            int depth = 0;          // the nesting level of the (sub-)query
+            int step = -1;          // the pattern (or optional) step, -1 means N/A
+            vector<ssid_t> pattern; // subject, predicate, direction and object (if any)
+
+            uint64_t time = 0;      // wall time (usec)
+            uint64_t rows_in = 0;
+            uint64_t rows_out = 0;
+            uint64_t remote_reads = 0;  // #RDMA reads
+            uint64_t cache_hits = 0;    // #hits of RDMA cache
+            uint64_t bytes_sent = 0;    // the (estimated) bytes of results sent to remote
+        };
+
+        bool enabled = false;
+        int depth = 0;
+        vector<Record> records;
+
+        // the profile of a sub-query
+        Profile fork() const {
+            Profile p;
+            p.enabled = enabled;
+            p.depth = depth + 1;
+            return p;
+        }
+
+        void merge(Profile &other) {
+            records.insert(records.end(), other.records.begin(), other.records.end());
+        }
+    };
+
+    /**
+     * The actual cardinality (i.e., #rows in and out) of each pattern step, which is
+     * reported back to the proxy to correct the estimates of planner (see CardFeedback).
+     * Like Profile, the steps of sub-queries are merged into their parent by RMap,
+     * so that each step sums up the rows on all servers.
+     */
+    class Cardinality {
+    private:
+        friend class boost::serialization::access;
+        template <typename Archive>
+        void serialize(Archive &ar, const unsigned int version) {
+            ar & enabled;
+            ar & steps;
+        }
+
+    public:
+        // the bindings of a pattern step
+        // (CONFLICT means the participants recorded different patterns for the step)
+        enum Bind { CONFLICT = -2, FROM_INDEX = 0, FROM_CONST, TO_UNKNOWN, TO_KNOWN, TO_CONST };
+
+        class Step {
+        private:
+            friend class boost::serialization::access;
+            template <typename Archive>
+            void serialize(Archive &ar, const unsigned int version) {
+                ar & bind;
+                ar & start;
+                ar & predicate;
+                ar & direction;
+                ar & end;
+                ar & rows_in;
+                ar & rows_out;
+            }
+
+        public:
+            int bind = -1;          // -1 means the step is not executed
+            ssid_t start = 0;
+            ssid_t predicate = 0;
+            int direction = OUT;
+            ssid_t end = 0;
+            uint64_t rows_in = 0;   // a constant start counts as a single row
+            uint64_t rows_out = 0;
+
+            bool same_pattern(const Step &s) const {
+                return bind == s.bind && start == s.start && predicate == s.predicate
+                       && direction == s.direction && end == s.end;
+            }
+        };
+
+        bool enabled = false;
+        vector<Step> steps;
+
+        // the cardinality of a sub-query (of the same pattern group)
+        Cardinality fork() const {
+            Cardinality c;
+            c.enabled = enabled;
+            return c;
+        }
+
+        // sum up the rows of a step recorded by a participant (e.g., a sub-query),
+        // and the step is dropped if the participants disagree on its pattern
+        void add(size_t i, const Step &st) {
+            if (st.bind == -1) return;  // not executed
+
+            if (steps.size() <= i) steps.resize(i + 1);
+            Step &s = steps[i];
+            if (s.bind == CONFLICT) return;
+            if (st.bind == CONFLICT || (s.bind >= 0 && !s.same_pattern(st))) {
+                s.bind = CONFLICT;
+                return;
+            }
+
+            uint64_t rows_in = s.rows_in, rows_out = s.rows_out;
+            s = st;
+            s.rows_in += rows_in;
+            s.rows_out += rows_out;
+        }
+
+        void record(size_t step, int bind, const Pattern &pattern,
+                    uint64_t rows_in, uint64_t rows_out) {
+            Step s;
+            s.bind = bind;
+            s.start = pattern.subject;
+            s.predicate = pattern.predicate;
+            s.direction = pattern.direction;
+            s.end = pattern.object;
+            s.rows_in = rows_in;
+            s.rows_out = rows_out;
+            add(step, s);
+        }
+
+        void merge(Cardinality &other) {
+            for (size_t i = 0; i < other.steps.size(); i++)
+                add(i, other.steps[i]);
+        }
+    };
+
     class Result {
     private:
         friend class boost::serialization::access;
@@ -447,7 +615,7 @@ public:
         }
 
         // ATTRIBUTE result (i.e., integer, float, and double)
-        int set_attr_col_num(int n) { attr_col_num = n; }
+        void set_attr_col_num(int n) { attr_col_num = n; }
 
         int get_attr_col_num() { return attr_col_num; }
 
@@ -559,6 +727,11 @@ public:
 
     int qid = -1;   // query id (track engine (sid, tid))
     int pqid = -1;  // parent qid (track the source (proxy or parent query) of query)
+    int root_pqid = -1; // the pqid of the (root) query from proxy, used by cancellation
+
+    // the local timestamp (usec) to give up the query, 0 means no deadline
+    // NOTE: it is transferred as the remaining time since clocks are not synchronized
+    uint64_t deadline = 0;
 
     PGType pg_type = BASIC;
     SQState state = SQ_PATTERN;
@@ -593,6 +766,9 @@ public:
     vector<Order> orders;
     Result result;
 
+    Profile profile;  // EXPLAIN ANALYZE
+    Cardinality card; // feedback to planner
+
     SPARQLQuery() { }
 
     // build a query by existing query template
@@ -637,6 +813,26 @@ public:
 
     bool has_filter() { return pattern_group.filters.size() > 0; }
 
+    bool is_timeout() { return (deadline != 0) && (timer::get_usec() > deadline); }
+
+    // LIMIT (and OFFSET) can be pushed down into pattern execution only if
+    // no later stage (DISTINCT, ORDER BY, FILTER, UNION and OPTIONAL) would
+    // drop or reorder the rows produced by patterns
+    bool can_pushdown_limit() {
+        return (limit >= 0 && !distinct && orders.size() == 0
+                && pg_type == BASIC && !has_filter()
+                && !has_union() && !has_optional());
+    }
+
+    // the maximum #rows that the current pattern step needs to produce (-1 means unlimited)
+    // NOTE: only the last step can stop early, since the others may still lose rows later
+    int row_quota() {
+        if (!can_pushdown_limit()
+                || (pattern_step != pattern_group.patterns.size() - 1))
+            return -1;
+        return limit + offset;
+    }
+
     bool done(SQState state) {
         switch (state) {
         case SQ_PATTERN:
@@ -707,6 +903,9 @@ public:
     // UNION
     void inherit_union(SPARQLQuery &r, int idx) {
         pqid = r.qid;
+        root_pqid = r.root_pqid;
+        deadline = r.deadline;
+        profile = r.profile.fork();
         pg_type = SPARQLQuery::PGType::UNION;
         pattern_group = r.pattern_group.unions[idx];
         if (start_from_index()
@@ -788,6 +987,9 @@ public:
 
     void inherit_optional(SPARQLQuery &r) {
         pqid = r.qid;
+        root_pqid = r.root_pqid;
+        deadline = r.deadline;
+        profile = r.profile.fork();
         pg_type = SPARQLQuery::PGType::OPTIONAL;
         pattern_group = r.pattern_group.optional[r.optional_step];
 
@@ -916,8 +1118,8 @@ public:
 
 namespace boost {
 namespace serialization {
-char occupied = 0;
-char empty = 1;
+static char occupied = 0;
+static char empty = 1;
 
 template<class Archive>
 void save(Archive &ar, const SPARQLQuery::Pattern &t, unsigned int version) {
@@ -1028,6 +1230,12 @@ template<class Archive>
 void save(Archive & ar, const SPARQLQuery &t, unsigned int version) {
     ar << t.qid;
     ar << t.pqid;
+    ar << t.root_pqid;
+    // remaining time (usec) before the deadline, -1 means no deadline
+    int64_t remaining = -1;
+    if (t.deadline != 0)
+        remaining = max((int64_t)t.deadline - (int64_t)timer::get_usec(), (int64_t)0);
+    ar << remaining;
     ar << t.pg_type;
     ar << t.state;
     ar << t.dev_type;
@@ -1053,6 +1261,18 @@ void save(Archive & ar, const SPARQLQuery &t, unsigned int version) {
         ar << empty;
     }
     ar << t.result;
+    if (t.profile.enabled) {
+        ar << occupied;
+        ar << t.profile;
+    } else {
+        ar << empty;
+    }
+    if (t.card.enabled) {
+        ar << occupied;
+        ar << t.card;
+    } else {
+        ar << empty;
+    }
 }
 
 template<class Archive>
@@ -1060,6 +1280,10 @@ void load(Archive & ar, SPARQLQuery &t, unsigned int version) {
     char temp = 2;
     ar >> t.qid;
     ar >> t.pqid;
+    ar >> t.root_pqid;
+    int64_t remaining;
+    ar >> remaining;
+    t.deadline = (remaining < 0) ? 0 : timer::get_usec() + remaining;
     ar >> t.pg_type;
     ar >> t.state;
     ar >> t.dev_type;
@@ -1081,6 +1305,10 @@ void load(Archive & ar, SPARQLQuery &t, unsigned int version) {
     ar >> temp;
     if (temp == occupied) ar >> t.orders;
     ar >> t.result;
+    ar >> temp;
+    if (temp == occupied) ar >> t.profile;
+    ar >> temp;
+    if (temp == occupied) ar >> t.card;
 }
 
 }
@@ -1098,6 +1326,10 @@ BOOST_CLASS_IMPLEMENTATION(SPARQLQuery::Pattern, boost::serialization::object_se
 BOOST_CLASS_IMPLEMENTATION(SPARQLQuery::PatternGroup, boost::serialization::object_serializable);
 BOOST_CLASS_IMPLEMENTATION(SPARQLQuery::Filter, boost::serialization::object_serializable);
 BOOST_CLASS_IMPLEMENTATION(SPARQLQuery::Order, boost::serialization::object_serializable);
+BOOST_CLASS_IMPLEMENTATION(SPARQLQuery::Profile, boost::serialization::object_serializable);
+BOOST_CLASS_IMPLEMENTATION(SPARQLQuery::Profile::Record, boost::serialization::object_serializable);
+BOOST_CLASS_IMPLEMENTATION(SPARQLQuery::Cardinality, boost::serialization::object_serializable);
+BOOST_CLASS_IMPLEMENTATION(SPARQLQuery::Cardinality::Step, boost::serialization::object_serializable);
 BOOST_CLASS_IMPLEMENTATION(SPARQLQuery::Result, boost::serialization::object_serializable);
 BOOST_CLASS_IMPLEMENTATION(SPARQLQuery, boost::serialization::object_serializable);
 
@@ -1112,14 +1344,82 @@ BOOST_CLASS_TRACKING(SPARQLQuery::Pattern, boost::serialization::track_never);
 BOOST_CLASS_TRACKING(SPARQLQuery::Filter, boost::serialization::track_never);
 BOOST_CLASS_TRACKING(SPARQLQuery::PatternGroup, boost::serialization::track_never);
 BOOST_CLASS_TRACKING(SPARQLQuery::Order, boost::serialization::track_never);
+BOOST_CLASS_TRACKING(SPARQLQuery::Profile, boost::serialization::track_never);
+BOOST_CLASS_TRACKING(SPARQLQuery::Profile::Record, boost::serialization::track_never);
+BOOST_CLASS_TRACKING(SPARQLQuery::Cardinality, boost::serialization::track_never);
+BOOST_CLASS_TRACKING(SPARQLQuery::Cardinality::Step, boost::serialization::track_never);
 BOOST_CLASS_TRACKING(SPARQLQuery::Result, boost::serialization::track_never);
 BOOST_CLASS_TRACKING(SPARQLQuery, boost::serialization::track_never);
 
 BOOST_CLASS_TRACKING(GStoreCheck, boost::serialization::track_never);
 BOOST_CLASS_TRACKING(RDFLoad, boost::serialization::track_never);
 
+/**
+ * A batch of SPARQL (sub-)queries to the engines of a server.
+ * The queries sharing the same pattern group (e.g., the sub-queries dispatched
+ * by a query) only carry one copy of it.
+ */
+class SPARQLBatch {
+private:
+    friend class boost::serialization::access;
+    template <typename Archive>
+    void serialize(Archive &ar, const unsigned int version) {
+        ar & groups;
+        ar & gids;
+        ar & tids;
+        ar & queries;
+    }
+
+    // (serialized) pattern group -> index of groups, only used by the sender
+    map<string, int> gmap;
+
+public:
+    vector<SPARQLQuery::PatternGroup> groups;
+    vector<int> gids;   // the pattern group of each query
+    vector<int> tids;   // the destination thread of each query
+    vector<SPARQLQuery> queries;  // w/o pattern group
+
+    uint64_t nbytes = 0ull;  // the (estimated) size of results
+
+    void add(int dst_tid, SPARQLQuery &&r) {
+        std::stringstream ss;
+        boost::archive::binary_oarchive oa(ss, boost::archive::no_header);
+        oa << r.pattern_group;
+
+        auto ret = gmap.insert(make_pair(ss.str(), (int)groups.size()));
+        if (ret.second)
+            groups.push_back(std::move(r.pattern_group));
+        r.pattern_group = SPARQLQuery::PatternGroup();
+
+        gids.push_back(ret.first->second);
+        tids.push_back(dst_tid);
+        nbytes += r.result.result_table.size() * sizeof(sid_t)
+                  + r.result.attr_res_table.size() * sizeof(attr_t);
+        queries.push_back(std::move(r));
+    }
+
+    // NOTE: each query can only be taken once
+    SPARQLQuery take(int i) {
+        SPARQLQuery r(std::move(queries[i]));
+        r.pattern_group = groups[gids[i]];
+        return r;
+    }
+
+    size_t size() const { return queries.size(); }
+
+    void clear() {
+        gmap.clear();
+        groups.clear();
+        gids.clear();
+        tids.clear();
+        queries.clear();
+        nbytes = 0ull;
+    }
+};
 
-enum req_type { SPARQL_QUERY = 0, DYNAMIC_LOAD = 1, GSTORE_CHECK = 2, SPARQL_HISTORY = 3 };
+
+enum req_type { SPARQL_QUERY = 0, DYNAMIC_LOAD = 1, GSTORE_CHECK = 2, SPARQL_HISTORY = 3,
+                SPARQL_CANCEL = 4, SPARQL_BATCH = 5 };
 
 /**
  * Bundle to be sent by network, with data type labeled
@@ -1168,6 +1468,14 @@ public:
         data = ss.str();
     }
 
+    Bundle(const SPARQLBatch &b): type(SPARQL_BATCH) {
+        std::stringstream ss;
+        boost::archive::binary_oarchive oa(ss);
+
+        oa << b;
+        data = ss.str();
+    }
+
     Bundle(const string str) { init(str); }
 
     void init(const string str) {
@@ -1189,6 +1497,19 @@ public:
         return result;
     }
 
+    // SPARQLBatch command
+    SPARQLBatch get_sparql_batch() const {
+        ASSERT(type == SPARQL_BATCH);
+
+        std::stringstream ss;
+        ss << data;
+
+        boost::archive::binary_iarchive ia(ss);
+        SPARQLBatch result;
+        ia >> result;
+        return result;
+    }
+
     // RDFLoad command
     RDFLoad get_rdf_load() const {
         ASSERT(type == DYNAMIC_LOAD);
@@ -1215,6 +1536,12 @@ public:
         return result;
     }
 
+    // SPARQLCancel command (the qid of parent query)
+    int get_cancel_qid() const {
+        ASSERT(type == SPARQL_CANCEL);
+        return std::stoi(data);
+    }
+
     string to_str() const {
 #if 1 // FIXME
         char *c_str = new char[sizeof(req_type) + data.length()];
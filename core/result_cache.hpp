@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2016 Shanghai Jiao Tong University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://ipads.se.sjtu.edu.cn/projects/wukong
+ *
+ */
+
+#pragma once
+
+#include <iterator>
+#include <list>
+#include <sstream>
+#include <string>
+#include <pthread.h>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+
+#include "global.hpp"
+#include "type.hpp"
+#include "store/vertex.hpp"
+
+// utils
+#include "assertion.hpp"
+#include "unit.hpp"
+
+#include "query.hpp"
+
+using namespace std;
+
+/**
+ * A result cache shared by all proxies on a server, which returns the results of
+ * repeated queries (e.g., instantiations of the same template with the same constants)
+ * without executing them again. Entries are evicted in LRU order once the memory
+ * budget (Global::result_cache_size_mb) is exceeded.
+ *
+ * With DYNAMIC_GSTORE, the loader invalidates all entries touching the predicates
+ * of newly inserted triples.
+ */
+class ResultCache {
+public:
+    // taken by a proxy before issuing a query, and used to insert its result later
+    struct ticket_t {
+        string key;
+        uint64_t version = 0ull;
+        set<ssid_t> preds;      // predicates (or index vertices) read by the query
+        bool any_pred = false;  // the query may read any predicate (e.g., <s> ?P ?O)
+    };
+
+private:
+    struct item_t {
+        ticket_t ticket;
+        SPARQLQuery::Result result;
+        uint64_t size = 0ull;  // memory footprint (bytes)
+    };
+
+    typedef list<item_t>::iterator item_iter_t;
+
+    list<item_t> lru;  // the most recently used item is at the front
+    boost::unordered_map<string, item_iter_t> items;
+
+    uint64_t used = 0ull;  // bytes
+
+    // bumped by each invalidation to reject the results of queries issued before it
+    volatile uint64_t version = 0ull;
+    pthread_spinlock_t lock;
+
+    uint64_t budget() { return MiB2B((uint64_t)Global::result_cache_size_mb); }
+
+    void collect_preds(const SPARQLQuery::PatternGroup &group, ticket_t &t) {
+        for (auto const &p : group.patterns) {
+            if (p.predicate < 0) {
+                t.any_pred = true;
+            } else if (p.predicate == PREDICATE_ID || p.predicate == TYPE_ID) {
+                if (is_tpid(p.subject))
+                    t.preds.insert(p.subject); // index vertex
+                else if (p.predicate == PREDICATE_ID)
+                    t.any_pred = true;  // all predicates of a normal vertex
+                t.preds.insert(p.predicate);
+            } else {
+                t.preds.insert(p.predicate);
+            }
+        }
+
+        for (auto const &g : group.unions)
+            collect_preds(g, t);
+        for (auto const &g : group.optional)
+            collect_preds(g, t);
+    }
+
+    uint64_t size_of(const item_t &item) {
+        const SPARQLQuery::Result &r = item.result;
+        return sizeof(item_t) + item.ticket.key.size()
+               + r.result_table.size() * sizeof(sid_t)
+               + r.attr_res_table.size() * sizeof(attr_t)
+               + (r.v2c_map.size() + r.required_vars.size()) * sizeof(int)
+               + item.ticket.preds.size() * sizeof(ssid_t);
+    }
+
+    void evict(item_iter_t it) {
+        used -= it->size;
+        items.erase(it->ticket.key);
+        lru.erase(it);
+    }
+
+public:
+    ResultCache() { pthread_spin_init(&lock, 0); }
+
+    static ResultCache &get_cache() {
+        static ResultCache cache;
+        return cache;
+    }
+
+    bool enabled() { return Global::result_cache_size_mb > 0; }
+
+    // Normalize the query (before planning) into a ticket.
+    // NOTE: variables are numbered by the parser in order of appearance,
+    // so the same query text (or template with the same constants) has the same key.
+    ticket_t make_ticket(SPARQLQuery &r) {
+        ticket_t t;
+
+        stringstream ss;
+        boost::archive::binary_oarchive oa(ss);
+        oa << r.pattern_group;
+        oa << r.orders;
+        oa << r.limit;
+        oa << r.offset;
+        oa << r.distinct;
+        oa << r.result.nvars;
+        oa << r.result.required_vars;
+        t.key = ss.str();
+
+        t.version = version;
+        collect_preds(r.pattern_group, t);
+        return t;
+    }
+
+    // Return true and fill @result if a usable entry exists.
+    // A blind entry (i.e., w/o result data) only serves blind queries.
+    bool lookup(const ticket_t &t, bool blind, SPARQLQuery::Result &result) {
+        if (!enabled()) return false;
+
+        bool found = false;
+        pthread_spin_lock(&lock);
+        auto it = items.find(t.key);
+        if (it != items.end() && (blind || !it->second->result.blind)) {
+            lru.splice(lru.begin(), lru, it->second); // move to front
+            result = it->second->result;
+            found = true;
+        }
+        pthread_spin_unlock(&lock);
+        return found;
+    }
+
+    void insert(const ticket_t &t, const SPARQLQuery::Result &result) {
+        if (!enabled() || result.status_code != SUCCESS) return;
+
+        item_t item;
+        item.ticket = t;
+        item.result = result;
+        item.size = size_of(item);
+        if (item.size > budget()) return;  // too large to cache
+
+        pthread_spin_lock(&lock);
+        if (t.version != version) { // stale result
+            pthread_spin_unlock(&lock);
+            return;
+        }
+
+        auto it = items.find(t.key);
+        if (it != items.end()) {
+            // keep the entry with result data
+            if (!it->second->result.blind && result.blind) {
+                pthread_spin_unlock(&lock);
+                return;
+            }
+            evict(it->second);
+        }
+
+        while (used + item.size > budget() && !lru.empty())
+            evict(std::prev(lru.end()));
+
+        lru.push_front(item);
+        items[t.key] = lru.begin();
+        used += item.size;
+        pthread_spin_unlock(&lock);
+    }
+
+    // Drop all entries that read any of the given predicates (or index vertices).
+    int invalidate(const boost::unordered_set<ssid_t> &preds) {
+        if (preds.empty()) return 0;
+
+        int cnt = 0;
+        pthread_spin_lock(&lock);
+        version++;
+        for (auto it = lru.begin(); it != lru.end();) {
+            bool hit = it->ticket.any_pred;
+            for (auto p = it->ticket.preds.begin(); !hit && p != it->ticket.preds.end(); p++)
+                hit = (preds.find(*p) != preds.end());
+
+            if (hit) {
+                auto victim = it++;
+                evict(victim);
+                cnt++;
+            } else {
+                ++it;
+            }
+        }
+        pthread_spin_unlock(&lock);
+        return cnt;
+    }
+
+    void clear() {
+        pthread_spin_lock(&lock);
+        version++;
+        lru.clear();
+        items.clear();
+        used = 0ull;
+        pthread_spin_unlock(&lock);
+    }
+
+    size_t size() { return items.size(); }
+
+    uint64_t mem_size() { return used; }
+};
@@ -34,11 +34,15 @@
 #include <boost/serialization/unordered_map.hpp>
 #include <boost/serialization/unordered_set.hpp>
 #include <tbb/concurrent_hash_map.h>
+#include "omp.h"
 
 #include "global.hpp"
 
 
 #include "store/gstore.hpp"
+#ifdef DYNAMIC_GSTORE
+#include "store/dynamic_gstore.hpp"
+#endif
 #include "comm/tcp_adaptor.hpp"
 
 using namespace std;
@@ -174,6 +178,21 @@ struct type_stat {
         return 1;
     }
 
+    // add up the counts of the same types
+    void merge(const type_stat &other) {
+        for (auto const &e : other.pstype)
+            for (auto const &tc : e.second)
+                insert_stype(e.first, tc.ty, tc.count);
+
+        for (auto const &e : other.potype)
+            for (auto const &tc : e.second)
+                insert_otype(e.first, tc.ty, tc.count);
+
+        for (auto const &e : other.fine_type)
+            for (auto const &tc : e.second)
+                insert_finetype(e.first.first, e.first.second, tc.ty, tc.count);
+    }
+
     template <typename Archive>
     void serialize(Archive &ar, const unsigned int version) {
         ar & pstype;
@@ -182,11 +201,54 @@ struct type_stat {
     }
 };
 
+// the changes of global statistics by dynamically loaded triples (see Stats::update_stat)
+struct stat_delta {
+    unordered_map<ssid_t, int> tyscount;
+    type_stat tystat;
+
+    uint64_t num_edges = 0;     // new edges
+    uint64_t num_skipped = 0;   // new edges w/ unknown types (not counted)
+
+    void merge(const stat_delta &other) {
+        for (auto const &c : other.tyscount)
+            tyscount[c.first] += c.second;
+        tystat.merge(other.tystat);
+        num_edges += other.num_edges;
+        num_skipped += other.num_skipped;
+    }
+
+    template <typename Archive>
+    void serialize(Archive &ar, const unsigned int version) {
+        ar & tyscount;
+        ar & tystat;
+        ar & num_edges;
+        ar & num_skipped;
+    }
+};
+
+// the sum of squared counts of sampled vertices for fine_type (see Stats::estimate_error)
+typedef unordered_map<pair<ssid_t, ssid_t>, unordered_map<ssid_t, double>,
+        boost::hash<pair<int, int>>> fine_sqsum_t;
+
+// the statistics generated by a thread (see Stats::generate_statistics),
+// where complex types are numbered by the thread itself
+struct stat_part {
+    unordered_map<ssid_t, int> tyscount;
+    type_stat tystat;
+    unordered_map<ssid_t, type_t> int2type;
+    unordered_map<type_t, ssid_t, type_t_hasher> type2int;
+    fine_sqsum_t fine_sqsum;
+};
+
 typedef tbb::concurrent_unordered_set<ssid_t> tbb_set;
 typedef tbb::concurrent_hash_map<type_t, ssid_t, type_t_hasher> tbb_map;
 
 class Stats {
 private:
+    // the planner reads global statistics while they are updated
+    // by dynamic loading (see update_stat)
+    pthread_rwlock_t rwlock;
+
     // after the master server get whole statistics,
     // this method is used to send it to all machines.
     void send_stat_to_all_machines(TCP_Adaptor *tcp_ad) {
@@ -248,9 +310,13 @@ public:
 
     int sid;
 
-    Stats(int sid) : sid(sid) { }
+    Stats(int sid) : sid(sid) { pthread_rwlock_init(&rwlock, NULL); }
+
+    Stats() { pthread_rwlock_init(&rwlock, NULL); }
 
-    Stats() { }
+    void read_lock() { pthread_rwlock_rdlock(&rwlock); }
+
+    void unlock() { pthread_rwlock_unlock(&rwlock); }
 
     // for debug usage
     void show_stat_info() {
@@ -425,11 +491,15 @@ public:
 
     }
 
+    // NOTE: a single server w/o TCP (i.e., @tcp_ad is NULL) gathers its own statistics
     void gather_stat(TCP_Adaptor *tcp_ad) {
+        ASSERT(tcp_ad != NULL || Global::num_servers == 1);
+
         std::stringstream ss;
         boost::archive::binary_oarchive oa(ss);
         oa << (*this);
-        tcp_ad->send(0, 0, ss.str());
+        if (tcp_ad != NULL)
+            tcp_ad->send(0, 0, ss.str());
 
         if (sid == 0) {
             vector<Stats> all_gather;
@@ -454,7 +524,7 @@ public:
             // receive from all proxies
             for (int i = 0; i < Global::num_servers; i++) {
                 std::string str;
-                str = tcp_ad->recv(0);
+                str = (tcp_ad != NULL) ? tcp_ad->recv(0) : ss.str();
                 Stats tmp_data;
                 std::stringstream s;
                 s << str;
@@ -576,7 +646,8 @@ public:
             logstream(LOG_INFO) << "global_tyscount[0]: " << global_tyscount[0] << LOG_endl;
         }
 
-        send_stat_to_all_machines(tcp_ad);
+        if (tcp_ad != NULL)
+            send_stat_to_all_machines(tcp_ad);
 
         logstream(LOG_INFO) << "#" << sid << ": load stats of DGraph is finished." << LOG_endl;
 
@@ -639,41 +710,37 @@ public:
         }
     }
 
-    ssid_t get_simple_type(type_t &type) {
-        auto iter = local_type2int.find(type);
+    // number the complex type w/ negative numbers in the given numbering
+    static ssid_t get_simple_type(type_t &type,
+                                  unordered_map<type_t, ssid_t, type_t_hasher> &type2int,
+                                  unordered_map<ssid_t, type_t> &int2type) {
+        auto iter = type2int.find(type);
 
-        if (iter == local_type2int.end()) {
-            ssid_t number = local_type2int.size();
+        if (iter == type2int.end()) {
+            ssid_t number = type2int.size();
             number ++;
             number = -number;
-            local_type2int[type] = number;
-            local_int2type[number] = type;
+            type2int[type] = number;
+            int2type[number] = type;
             return number;
         } else {
             return iter->second;
         }
     }
 
-    // prepare data for planner
-    void generate_statistics(GStore *gstore) {
-
-        // find if the same raw type have similar predicates
-        // unordered_map<ssid_t, unordered_set<type_t,type_t_hasher>> rawType_to_predicates;
-        // unordered_map<type_t, int, type_t_hasher> each_predicate_number;
+    ssid_t get_simple_type(type_t &type) {
+        return get_simple_type(type, local_type2int, local_int2type);
+    }
 
-#ifndef VERSATILE
-        logstream(LOG_ERROR) << "please turn off global_generate_statistics in config file"
-                             << "and use stat file cache instead"
-                             << " OR "
-                             << "turn on VERSATILE option in CMakefiles to generate statistics."
-                             << LOG_endl;
-        exit(-1);
-#endif
+    // only the vertices hashed to 1/@ratio are sampled
+    static inline bool is_sampled(sid_t vid, int ratio) {
+        return (ratio == 1) || (wukong::math::hash_u64(vid) % ratio == 0);
+    }
 
-        unordered_map<ssid_t, int> &tyscount = local_tyscount;
-        type_stat &ty_stat = local_tystat;
-        // for complex type vertex numbering
-        unordered_set<ssid_t> record_set;
+    // scan the keys in a bucket by thread @tid (see generate_statistics)
+    void scan_bucket(GStore *gstore, int tid, uint64_t bucket_id, int ratio, stat_part &part) {
+        unordered_map<ssid_t, int> &tyscount = part.tyscount;
+        type_stat &ty_stat = part.tystat;
 
         //use index_composition as type of no_type
         auto generate_no_type = [&](ssid_t id) -> ssid_t {
@@ -681,14 +748,14 @@ public:
             uint64_t psize1 = 0;
             unordered_set<int> index_composition;
 
-            edge_t *res1 = gstore->get_edges(0, id, PREDICATE_ID, OUT, psize1);
+            edge_t *res1 = gstore->get_edges(tid, id, PREDICATE_ID, OUT, psize1);
             for (uint64_t k = 0; k < psize1; k++) {
                 ssid_t pre = res1[k].val;
                 index_composition.insert(pre);
             }
 
             uint64_t psize2 = 0;
-            edge_t *res2 = gstore->get_edges(0, id, PREDICATE_ID, IN, psize2);
+            edge_t *res2 = gstore->get_edges(tid, id, PREDICATE_ID, IN, psize2);
             for (uint64_t k = 0; k < psize2; k++) {
                 ssid_t pre = res2[k].val;
                 index_composition.insert(-pre);
@@ -701,7 +768,7 @@ public:
             // if(index_composition.size() == 0){
             //     cout << "empty index, may be type" << endl;
             // }
-            return get_simple_type(type);
+            return get_simple_type(type, part.type2int, part.int2type);
         };
 
         //use type_composition as type of no_type
@@ -712,159 +779,521 @@ public:
                 type_composition.insert(res[i].val);
 
             type.set_type_composition(type_composition);
-            return get_simple_type(type);
+            return get_simple_type(type, part.type2int, part.int2type);
         };
 
-        // return success or not, because one id can only be recorded once
-        auto insert_no_type_count = [&](ssid_t id, ssid_t type) -> bool{
-            if (record_set.count(id) > 0) {
-                return false;
-            } else{
-                record_set.insert(id);
-
-                if (tyscount.find(type) == tyscount.end())
-                    tyscount[type] = 1;
-                else
-                    tyscount[type]++;
-                return true;
+        // count the types of neighbors (@res_type) by fine_type,
+        // as well as the squared counts for the error bounds of sampling
+        auto insert_finetypes = [&](ssid_t first, ssid_t second, vector<ssid_t> &res_type) {
+            sort(res_type.begin(), res_type.end());
+            for (size_t s = 0, e = 0; s < res_type.size(); s = e) {
+                while (e < res_type.size() && res_type[e] == res_type[s]) e++;
+                ty_stat.insert_finetype(first, second, res_type[s], e - s);
+                if (ratio > 1)
+                    part.fine_sqsum[make_pair(first, second)][res_type[s]] += double(e - s) * (e - s);
             }
         };
 
-        int percent_number = 1;
-        for (uint64_t bucket_id = 0; bucket_id < gstore->num_buckets + gstore->num_buckets_ext; bucket_id++) {
-            // print progress percent info
-            if (bucket_id * 1.0 / (gstore->num_buckets + gstore->num_buckets_ext) > percent_number * 1.0 / 10) {
-                logstream(LOG_INFO) << "#" << sid << ": already generate statistics " << percent_number << "0%" << LOG_endl;
-                percent_number ++;
+        uint64_t slot_id = bucket_id * gstore->ASSOCIATIVITY;
+        for (int i = 0; i < gstore->ASSOCIATIVITY - 1; i++, slot_id++) {
+            // skip empty slot
+            if (gstore->vertices[slot_id].key.is_empty()) continue;
+
+            sid_t vid = gstore->vertices[slot_id].key.vid;
+            sid_t pid = gstore->vertices[slot_id].key.pid;
+            dir_t dir = (dir_t)gstore->vertices[slot_id].key.dir;
+
+            uint64_t sz = gstore->vertices[slot_id].ptr.size;
+            uint64_t off = gstore->vertices[slot_id].ptr.off;
+            if (vid == PREDICATE_ID) continue; // skip for index vertex
+            if (!is_sampled(vid, ratio)) continue;
+
+            if (pid == PREDICATE_ID) {
+                // no_type is counted once at the key of its predicates
+                // (OUT, or IN if the vertex has no OUT edges)
+                uint64_t psize = 0, type_sz = 0;
+                if (dir == IN && gstore->get_edges_local(tid, vid, PREDICATE_ID, OUT, psize) != NULL)
+                    continue;
+
+                gstore->get_edges_local(tid, vid, TYPE_ID, OUT, type_sz);
+                if (type_sz == 0)
+                    tyscount[generate_no_type(vid)]++;
+                continue;
             }
 
-            uint64_t slot_id = bucket_id * gstore->ASSOCIATIVITY;
-            for (int i = 0; i < gstore->ASSOCIATIVITY - 1; i++, slot_id++) {
-                // skip empty slot
-                if (gstore->vertices[slot_id].key.is_empty()) continue;
-
-                sid_t vid = gstore->vertices[slot_id].key.vid;
-                sid_t pid = gstore->vertices[slot_id].key.pid;
-
-                uint64_t sz = gstore->vertices[slot_id].ptr.size;
-                uint64_t off = gstore->vertices[slot_id].ptr.off;
-                if (vid == PREDICATE_ID || pid == PREDICATE_ID)
-                    continue; // skip for index vertex
-
-                if (gstore->vertices[slot_id].key.dir == IN) {
-                    // for type derivation
-                    // get types of values found by key (Subjects)
-                    vector<ssid_t> res_type;
-                    for (uint64_t k = 0; k < sz; k++) {
-                        ssid_t sbid = gstore->edges[off + k].val;
-                        uint64_t type_sz = 0;
-                        edge_t *res = gstore->get_edges(0, sbid, TYPE_ID, OUT, type_sz);
-                        if (type_sz > 1) {
-                            ssid_t type = generate_multi_type(res, type_sz);
-                            res_type.push_back(type);
-                        } else if (type_sz == 0) {
-                            ssid_t type = generate_no_type(sbid);
-                            res_type.push_back(type);
-                        } else if (type_sz == 1) {
-                            res_type.push_back(res[0].val);
-                        } else {
-                            assert(false);
-                        }
-                    }
-
-                    // type for objects
-                    // get type of vid (Object)
+            if (dir == IN) {
+                // for type derivation
+                // get types of values found by key (Subjects)
+                vector<ssid_t> res_type;
+                for (uint64_t k = 0; k < sz; k++) {
+                    ssid_t sbid = gstore->edges[off + k].val;
                     uint64_t type_sz = 0;
-                    edge_t *res = gstore->get_edges_local(0, vid, TYPE_ID, OUT, type_sz);
-                    ssid_t type;
+                    edge_t *res = gstore->get_edges(tid, sbid, TYPE_ID, OUT, type_sz);
                     if (type_sz > 1) {
-                        type = generate_multi_type(res, type_sz);
+                        ssid_t type = generate_multi_type(res, type_sz);
+                        res_type.push_back(type);
+                    } else if (type_sz == 0) {
+                        ssid_t type = generate_no_type(sbid);
+                        res_type.push_back(type);
+                    } else if (type_sz == 1) {
+                        res_type.push_back(res[0].val);
                     } else {
-                        if (type_sz == 0) {
-                            type = generate_no_type(vid);
-                            insert_no_type_count(vid, type);
-                        } else {
-                            type = res[0].val;
-                        }
+                        assert(false);
                     }
+                }
 
-                    ty_stat.insert_otype(pid, type, 1);
-                    for (int j = 0; j < res_type.size(); j++)
-                        ty_stat.insert_finetype(pid, type, res_type[j], 1);
+                // type for objects
+                // get type of vid (Object)
+                uint64_t type_sz = 0;
+                edge_t *res = gstore->get_edges_local(tid, vid, TYPE_ID, OUT, type_sz);
+                ssid_t type;
+                if (type_sz > 1) {
+                    type = generate_multi_type(res, type_sz);
                 } else {
-                    // no_type only need to be counted in one direction (using OUT)
-                    // get types of values found by key (Objects)
-                    vector<ssid_t> res_type;
-                    for (uint64_t k = 0; k < sz; k++) {
-                        ssid_t obid = gstore->edges[off + k].val;
-                        uint64_t type_sz = 0;
-                        edge_t *res = gstore->get_edges(0, obid, TYPE_ID, OUT, type_sz);
-
-                        if (type_sz > 1) {
-                            ssid_t type = generate_multi_type(res, type_sz);
-                            res_type.push_back(type);
-                        } else if (type_sz == 0) {
-                            // in this situation, obid may be some TYPE
-                            if (pid != 1) {
-                                ssid_t type = generate_no_type(obid);
-                                res_type.push_back(type);
-                            }
-                        } else if (type_sz == 1) {
-                            res_type.push_back(res[0].val);
-                        } else {
-                            assert(false);
-                        }
+                    if (type_sz == 0) {
+                        type = generate_no_type(vid);
+                    } else {
+                        type = res[0].val;
                     }
+                }
 
-                    // type for subjects
-                    // get type of vid (Subject)
+                ty_stat.insert_otype(pid, type, 1);
+                insert_finetypes(pid, type, res_type);
+            } else {
+                // get types of values found by key (Objects)
+                vector<ssid_t> res_type;
+                for (uint64_t k = 0; k < sz; k++) {
+                    ssid_t obid = gstore->edges[off + k].val;
                     uint64_t type_sz = 0;
-                    edge_t *res = gstore->get_edges_local(0, vid, TYPE_ID, OUT, type_sz);
-                    ssid_t type;
+                    edge_t *res = gstore->get_edges(tid, obid, TYPE_ID, OUT, type_sz);
+
                     if (type_sz > 1) {
-                        type = generate_multi_type(res, type_sz);
-                    } else {
-                        if (type_sz == 0) {
-                            type = generate_no_type(vid);
-                            insert_no_type_count(vid, type);
-                        } else {
-                            type = res[0].val;
+                        ssid_t type = generate_multi_type(res, type_sz);
+                        res_type.push_back(type);
+                    } else if (type_sz == 0) {
+                        // in this situation, obid may be some TYPE
+                        if (pid != 1) {
+                            ssid_t type = generate_no_type(obid);
+                            res_type.push_back(type);
                         }
+                    } else if (type_sz == 1) {
+                        res_type.push_back(res[0].val);
+                    } else {
+                        assert(false);
                     }
+                }
 
-                    ty_stat.insert_stype(pid, type, 1);
-                    for (int j = 0; j < res_type.size(); j++)
-                        ty_stat.insert_finetype(type, pid, res_type[j], 1);
-
-                    // count type predicate
-                    if (pid == TYPE_ID) {
-                        // multi-type
-                        if (sz > 1) {
-                            type_t complex_type;
-                            unordered_set<int> type_composition;
-                            for (int i = 0; i < sz; i ++)
-                                type_composition.insert(gstore->edges[off + i].val);
-
-                            complex_type.set_type_composition(type_composition);
-                            ssid_t type_number = get_simple_type(complex_type);
-
-                            if (tyscount.find(type_number) == tyscount.end())
-                                tyscount[type_number] = 1;
-                            else
-                                tyscount[type_number]++;
-                        } else if (sz == 1) { // single type
-                            sid_t obid = gstore->edges[off].val;
-
-                            if (tyscount.find(obid) == tyscount.end())
-                                tyscount[obid] = 1;
-                            else
-                                tyscount[obid]++;
-                        }
+                // type for subjects
+                // get type of vid (Subject)
+                uint64_t type_sz = 0;
+                edge_t *res = gstore->get_edges_local(tid, vid, TYPE_ID, OUT, type_sz);
+                ssid_t type;
+                if (type_sz > 1) {
+                    type = generate_multi_type(res, type_sz);
+                } else {
+                    if (type_sz == 0) {
+                        type = generate_no_type(vid);
+                    } else {
+                        type = res[0].val;
+                    }
+                }
+
+                ty_stat.insert_stype(pid, type, 1);
+                insert_finetypes(type, pid, res_type);
+
+                // count type predicate
+                if (pid == TYPE_ID) {
+                    // multi-type
+                    if (sz > 1) {
+                        type_t complex_type;
+                        unordered_set<int> type_composition;
+                        for (int i = 0; i < sz; i ++)
+                            type_composition.insert(gstore->edges[off + i].val);
+
+                        complex_type.set_type_composition(type_composition);
+                        tyscount[get_simple_type(complex_type, part.type2int, part.int2type)]++;
+                    } else if (sz == 1) { // single type
+                        tyscount[gstore->edges[off].val]++;
                     }
                 }
             }
         }
+    }
+
+    /**
+     * log the error bounds (95% confidence) of the statistics estimated by sampling
+     *
+     * A count is estimated by C = X * R, where X = sum(c_i) of the sampled vertices
+     * (1/R of all), whose standard error is sqrt((1 - 1/R) * sum(c_i^2)) * R. So the
+     * relative error bound is 1.96 * sqrt((1 - 1/R) * sum(c_i^2)) / X, where c_i = 1
+     * for pstype, potype and tyscount (i.e., sum(c_i^2) = X).
+     */
+    void estimate_error(int ratio, const fine_sqsum_t &fine_sqsum) {
+        double f = 1.0 / ratio;
+        auto bound = [&](double x, double sqsum) -> double {
+            return 1.96 * sqrt((1 - f) * sqsum) / x;
+        };
+
+        auto report = [&](string name, vector<double> &bounds) {
+            if (bounds.empty()) return;
+            sort(bounds.begin(), bounds.end());
+            logstream(LOG_INFO) << "#" << sid << ": " << name << " of " << bounds.size()
+                                << " entries, relative error bound (95%) p50: "
+                                << bounds[bounds.size() / 2] * 100 << "%, p90: "
+                                << bounds[bounds.size() * 9 / 10] * 100 << "%" << LOG_endl;
+        };
+
+        vector<double> bounds;
+        for (auto const &c : local_tyscount)
+            if (c.second > 0) bounds.push_back(bound(c.second, c.second));
+        report("tyscount", bounds);
+
+        bounds.clear();
+        for (auto const &e : local_tystat.pstype)
+            for (auto const &tc : e.second)
+                if (tc.count > 0) bounds.push_back(bound(tc.count, tc.count));
+        report("pstype", bounds);
+
+        bounds.clear();
+        for (auto const &e : local_tystat.potype)
+            for (auto const &tc : e.second)
+                if (tc.count > 0) bounds.push_back(bound(tc.count, tc.count));
+        report("potype", bounds);
+
+        bounds.clear();
+        for (auto const &e : local_tystat.fine_type) {
+            auto iter = fine_sqsum.find(e.first);
+            if (iter == fine_sqsum.end()) continue;
+            for (auto const &tc : e.second) {
+                auto sq = iter->second.find(tc.ty);
+                if (tc.count > 0 && sq != iter->second.end())
+                    bounds.push_back(bound(tc.count, sq->second));
+            }
+        }
+        report("fine_type", bounds);
+    }
+
+    /**
+     * prepare data for planner
+     *
+     * The buckets are scanned by threads (Global::num_engines) in parallel, and the
+     * statistics of threads are merged at the end. W/ Global::stat_sample_ratio
+     * (R > 1), only the keys of 1/R vertices are scanned and the counts are scaled
+     * by R, which are estimated w/ error bounds (see estimate_error).
+     */
+    void generate_statistics(GStore *gstore) {
+
+        // find if the same raw type have similar predicates
+        // unordered_map<ssid_t, unordered_set<type_t,type_t_hasher>> rawType_to_predicates;
+        // unordered_map<type_t, int, type_t_hasher> each_predicate_number;
+
+#ifndef VERSATILE
+        logstream(LOG_ERROR) << "please turn off global_generate_statistics in config file"
+                             << "and use stat file cache instead"
+                             << " OR "
+                             << "turn on VERSATILE option in CMakefiles to generate statistics."
+                             << LOG_endl;
+        exit(-1);
+#endif
+
+        int nthreads = Global::num_engines;
+        int ratio = Global::stat_sample_ratio;
+        vector<stat_part> parts(nthreads);
+
+        // the buckets are assigned to threads by chunk
+        const uint64_t CHUNK_SIZE = 4096;
+        uint64_t num_buckets = gstore->num_buckets + gstore->num_buckets_ext;
+        uint64_t num_chunks = (num_buckets + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        uint64_t num_done = 0;
+        #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+        for (uint64_t c = 0; c < num_chunks; c++) {
+            int localtid = omp_get_thread_num();
+            uint64_t end = min((c + 1) * CHUNK_SIZE, num_buckets);
+            for (uint64_t bucket_id = c * CHUNK_SIZE; bucket_id < end; bucket_id++)
+                scan_bucket(gstore, localtid, bucket_id, ratio, parts[localtid]);
+
+            // print progress percent info
+            uint64_t done = __sync_add_and_fetch(&num_done, 1);
+            int percent = done * 10 / num_chunks;
+            if (percent > (done - 1) * 10 / num_chunks && percent < 10)
+                logstream(LOG_INFO) << "#" << sid << ": already generate statistics " << percent << "0%" << LOG_endl;
+        }
+
+        // merge the statistics of threads w/ the numbering of complex types of this server
+        fine_sqsum_t fine_sqsum;
+        for (auto &part : parts) {
+            auto transform = [&](ssid_t type) -> ssid_t {
+                return (type < 0) ? get_simple_type(part.int2type[type]) : type;
+            };
+
+            for (auto const &c : part.tyscount)
+                local_tyscount[transform(c.first)] += c.second;
+
+            for (auto const &e : part.tystat.pstype)
+                for (auto const &tc : e.second)
+                    local_tystat.insert_stype(e.first, transform(tc.ty), tc.count);
+
+            for (auto const &e : part.tystat.potype)
+                for (auto const &tc : e.second)
+                    local_tystat.insert_otype(e.first, transform(tc.ty), tc.count);
+
+            for (auto const &e : part.tystat.fine_type)
+                for (auto const &tc : e.second)
+                    local_tystat.insert_finetype(transform(e.first.first), transform(e.first.second),
+                                                 transform(tc.ty), tc.count);
+
+            for (auto const &e : part.fine_sqsum)
+                for (auto const &sq : e.second)
+                    fine_sqsum[make_pair(transform(e.first.first), transform(e.first.second))]
+                    [transform(sq.first)] += sq.second;
+        }
+        vector<stat_part>().swap(parts);
+
+        // scale the sampled counts
+        if (ratio > 1) {
+            estimate_error(ratio, fine_sqsum);
+
+            for (auto &c : local_tyscount)
+                c.second *= ratio;
+            for (auto &e : local_tystat.pstype)
+                for (auto &tc : e.second) tc.count *= ratio;
+            for (auto &e : local_tystat.potype)
+                for (auto &tc : e.second) tc.count *= ratio;
+            for (auto &e : local_tystat.fine_type)
+                for (auto &tc : e.second) tc.count *= ratio;
+        }
 
         logstream(LOG_INFO) << "server#" << sid << ": generating stats is finished." << endl;
     }
+
+    // the type of @type w/ the global numbering of complex types (0 if it is useless)
+    ssid_t get_global_type(const type_t &type) {
+        if (type.data_type && type.composition.size() == 1)
+            return *type.composition.begin();
+
+        auto iter = global_type2int.find(type);
+        if (iter != global_type2int.end())
+            return iter->second;
+
+        // w/o merging types, global_type2int is cleared (see gather_stat)
+        // but the (few) complex types are still numbered in global_int2type
+        if (global_useful_type.empty())
+            for (auto const &e : global_int2type)
+                if (e.second == type)
+                    return e.first;
+        return 0;
+    }
+
+    // get the type of vertex @vid like Planner::get_type
+    // @return: false if the type is unknown (i.e., remote vertex w/o RDMA)
+    bool get_global_type(GStore *gstore, int tid, sid_t vid, ssid_t &type) {
+        if (Partitioner::server_of(vid) != sid && !Global::use_rdma)
+            return false;
+
+        type_t vtype;
+        unordered_set<int> composition;
+        uint64_t sz = 0;
+        edge_t *res = gstore->get_edges(tid, vid, TYPE_ID, OUT, sz);
+        if (sz > 0) {
+            for (uint64_t k = 0; k < sz; k++)
+                composition.insert(res[k].val);
+            vtype.set_type_composition(composition);
+        } else {
+            // use index_composition as type of no_type
+            res = gstore->get_edges(tid, vid, PREDICATE_ID, OUT, sz);
+            for (uint64_t k = 0; k < sz; k++)
+                composition.insert(res[k].val);
+            res = gstore->get_edges(tid, vid, PREDICATE_ID, IN, sz);
+            for (uint64_t k = 0; k < sz; k++)
+                composition.insert(-res[k].val);
+            vtype.set_index_composition(composition);
+        }
+
+        type = get_global_type(vtype);
+        return true;
+    }
+
+#ifdef DYNAMIC_GSTORE
+    /**
+     * turn the new edges logged by dynamic loading into the changes of
+     * global statistics, in the same way as generate_statistics counts them
+     * (the log is cleared)
+     *
+     * NOTE: the statistics are approximate as the store is not scanned again,
+     * i.e., the edges loaded before are not moved when the type of a vertex is
+     * changed (only the count of vertices is moved), and the types of remote
+     * neighbors are unknown w/o RDMA (such edges are skipped)
+     */
+    stat_delta compute_delta(DynamicGStore *gstore, int tid) {
+        stat_delta delta;
+
+        // the type of vertices is looked up once
+        unordered_map<sid_t, ssid_t> types;
+        auto get_type = [&](sid_t vid, ssid_t &type) -> bool {
+            auto iter = types.find(vid);
+            if (iter != types.end()) {
+                type = iter->second;
+                return true;
+            }
+
+            if (!get_global_type(gstore, tid, vid, type))
+                return false;
+            types[vid] = type;
+            return true;
+        };
+
+        // the new types and the new (signed) predicates of local vertices,
+        // which tell the type of the vertex before loading
+        struct vertex_change {
+            unordered_set<int> types;
+            unordered_set<int> preds;
+        };
+        unordered_map<sid_t, vertex_change> changes;
+
+        for (auto &edges : gstore->new_edges) {
+            for (auto const &e : edges) {
+                const triple_t &t = e.triple;
+                delta.num_edges++;
+
+                // @v is the local vertex of the key, @u is its neighbor
+                sid_t v = (e.dir == OUT) ? t.s : t.o;
+                sid_t u = (e.dir == OUT) ? t.o : t.s;
+                vertex_change &vc = changes[v];
+                if (e.new_key)
+                    vc.preds.insert((e.dir == OUT) ? t.p : -t.p);
+
+                if (t.p == TYPE_ID) {
+                    vc.types.insert(t.o);
+                    continue;
+                }
+
+                ssid_t vtype, utype;
+                if (!get_type(v, vtype) || !get_type(u, utype)) {
+                    delta.num_skipped++;
+                    continue;
+                }
+
+                if (e.dir == OUT) {
+                    if (e.new_key) delta.tystat.insert_stype(t.p, vtype, 1);
+                    delta.tystat.insert_finetype(vtype, t.p, utype, 1);
+                } else {
+                    if (e.new_key) delta.tystat.insert_otype(t.p, vtype, 1);
+                    delta.tystat.insert_finetype(t.p, vtype, utype, 1);
+                }
+            }
+            vector<DynamicGStore::new_edge_t>().swap(edges);
+        }
+
+        // move the vertices from the old type to the new type (if changed)
+        for (auto const &c : changes) {
+            sid_t vid = c.first;
+            const vertex_change &vc = c.second;
+
+            ssid_t vtype;
+            get_type(vid, vtype);
+
+            // the type before loading, i.e., the (index_)composition w/o new ones
+            type_t old_type;
+            unordered_set<int> composition;
+            uint64_t sz = 0;
+            edge_t *res = gstore->get_edges_local(tid, vid, TYPE_ID, OUT, sz);
+            for (uint64_t k = 0; k < sz; k++)
+                if (vc.types.count(res[k].val) == 0)
+                    composition.insert(res[k].val);
+
+            bool typed = (composition.size() > 0);
+            if (typed) {
+                old_type.set_type_composition(composition);
+            } else {
+                res = gstore->get_edges_local(tid, vid, PREDICATE_ID, OUT, sz);
+                for (uint64_t k = 0; k < sz; k++)
+                    if (vc.preds.count(res[k].val) == 0)
+                        composition.insert(res[k].val);
+                res = gstore->get_edges_local(tid, vid, PREDICATE_ID, IN, sz);
+                for (uint64_t k = 0; k < sz; k++)
+                    if (vc.preds.count(-res[k].val) == 0)
+                        composition.insert(-res[k].val);
+                old_type.set_index_composition(composition);
+            }
+
+            // a new vertex has no key before loading
+            bool is_new = (composition.size() == 0);
+            ssid_t otype = is_new ? 0 : get_global_type(old_type);
+            if (is_new || otype != vtype) {
+                delta.tyscount[vtype]++;
+                if (!is_new) delta.tyscount[otype]--;
+            }
+
+            // the key of types is counted by pstype (see generate_statistics)
+            if (vc.types.size() > 0) {
+                delta.tystat.insert_stype(TYPE_ID, vtype, 1);
+                if (typed) delta.tystat.insert_stype(TYPE_ID, otype, -1);
+            }
+        }
+
+        return delta;
+    }
+
+    // add the changes to global statistics
+    void apply_delta(const stat_delta &delta) {
+        pthread_rwlock_wrlock(&rwlock);
+        for (auto const &c : delta.tyscount) {
+            int &count = global_tyscount[c.first];
+            count = max(count + c.second, 0);
+        }
+        global_tystat.merge(delta.tystat);
+        pthread_rwlock_unlock(&rwlock);
+    }
+
+    /**
+     * update global statistics by the triples dynamically loaded on all servers,
+     * which should be called by the leader proxy of every server after loading
+     *
+     * Instead of gathering all local statistics again (see gather_stat), only the
+     * changes are sent to the master server, which sends back the merged changes.
+     *
+     * NOTE: a single server w/o TCP (i.e., @tcp_ad is NULL) updates its own statistics
+     */
+    void update_stat(DynamicGStore *gstore, int tid, TCP_Adaptor *tcp_ad) {
+        ASSERT(tcp_ad != NULL || Global::num_servers == 1);
+        uint64_t t1 = timer::get_usec();
+
+        stat_delta delta = compute_delta(gstore, tid);
+        if (tcp_ad != NULL) {
+            if (sid == 0) {
+                // master server merges the changes and sends them to all servers
+                for (int i = 1; i < Global::num_servers; i++) {
+                    std::stringstream ss;
+                    ss << tcp_ad->recv(0);
+                    boost::archive::binary_iarchive ia(ss);
+                    stat_delta other;
+                    ia >> other;
+                    delta.merge(other);
+                }
+
+                std::stringstream ss;
+                boost::archive::binary_oarchive oa(ss);
+                oa << delta;
+                for (int i = 1; i < Global::num_servers; i++)
+                    tcp_ad->send(i, 0, ss.str());
+            } else {
+                std::stringstream ss;
+                boost::archive::binary_oarchive oa(ss);
+                oa << delta;
+                tcp_ad->send(0, 0, ss.str());
+
+                std::stringstream rs;
+                rs << tcp_ad->recv(0);
+                boost::archive::binary_iarchive ia(rs);
+                ia >> delta;
+            }
+        }
+        apply_delta(delta);
+
+        uint64_t t2 = timer::get_usec();
+        logstream(LOG_INFO) << "#" << sid << ": " << (t2 - t1) / 1000 << " ms for updating statistics by "
+                            << delta.num_edges << " new edges (" << delta.num_skipped
+                            << " edges w/ unknown types are skipped)" << LOG_endl;
+    }
+#endif // DYNAMIC_GSTORE
 };
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2016 Shanghai Jiao Tong University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://ipads.se.sjtu.edu.cn/projects/wukong
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+#include "type.hpp"
+
+// utils
+#include "assertion.hpp"
+
+using namespace std;
+
+/**
+ * A compressed bitmap of vertex IDs in the style of Roaring bitmap, used by the
+ * type and predicate index for O(1) membership tests and fast intersections.
+ *
+ * IDs are grouped into chunks by their high bits (ID >> 16). Each chunk is either
+ * a sorted array of the low 16 bits (sparse) or a bitmap of 2^16 bits (dense).
+ */
+class Bitmap {
+private:
+    static const int ARRAY_MAX = 4096;          // max #IDs of a sparse chunk
+    static const int NWORDS = (1 << 16) / 64;   // #words of a dense chunk
+
+    struct chunk_t {
+        uint64_t key;           // the high bits
+        uint32_t card = 0;      // #IDs
+        vector<uint16_t> vals;  // sorted low bits (sparse)
+        vector<uint64_t> words; // 2^16 bits (dense)
+
+        bool dense() const { return !words.empty(); }
+
+        bool contains(uint16_t v) const {
+            if (dense()) return (words[v >> 6] >> (v & 63)) & 1;
+            return binary_search(vals.begin(), vals.end(), v);
+        }
+
+        // convert to a dense chunk if there are too many IDs
+        void optimize() {
+            if (dense() || card <= ARRAY_MAX) return;
+            words.assign(NWORDS, 0);
+            for (auto v : vals) words[v >> 6] |= 1ull << (v & 63);
+            vector<uint16_t>().swap(vals);
+        }
+
+        void to_array() {
+            if (!dense() || card > ARRAY_MAX) return;
+            vals.clear();
+            for (int w = 0; w < NWORDS; w++)
+                for (uint64_t x = words[w]; x; x &= x - 1)
+                    vals.push_back(w * 64 + __builtin_ctzll(x));
+            vector<uint64_t>().swap(words);
+        }
+
+        template <typename F>
+        void for_each(F f) const {
+            uint64_t base = key << 16;
+            if (!dense()) {
+                for (auto v : vals) f((sid_t)(base + v));
+                return;
+            }
+            for (int w = 0; w < NWORDS; w++)
+                for (uint64_t x = words[w]; x; x &= x - 1)
+                    f((sid_t)(base + w * 64 + __builtin_ctzll(x)));
+        }
+    };
+
+    vector<chunk_t> chunks;  // sorted by key
+    uint64_t card = 0;
+
+    const chunk_t *find_chunk(uint64_t key) const {
+        auto it = lower_bound(chunks.begin(), chunks.end(), key,
+        [](const chunk_t &c, uint64_t k) { return c.key < k; });
+        return (it != chunks.end() && it->key == key) ? &*it : NULL;
+    }
+
+    static void intersect_chunk(const chunk_t &a, const chunk_t &b, chunk_t &r) {
+        r.key = a.key;
+        if (a.dense() && b.dense()) {
+            r.words.resize(NWORDS);
+            for (int w = 0; w < NWORDS; w++) {
+                r.words[w] = a.words[w] & b.words[w];
+                r.card += __builtin_popcountll(r.words[w]);
+            }
+            r.to_array();
+        } else if (a.dense() || b.dense()) {
+            const chunk_t &s = a.dense() ? b : a, &d = a.dense() ? a : b;
+            for (auto v : s.vals)
+                if (d.contains(v)) r.vals.push_back(v);
+            r.card = r.vals.size();
+        } else {
+            set_intersection(a.vals.begin(), a.vals.end(), b.vals.begin(), b.vals.end(),
+                             back_inserter(r.vals));
+            r.card = r.vals.size();
+        }
+    }
+
+public:
+    Bitmap() { }
+
+    // @ids: unsorted IDs are allowed
+    Bitmap(vector<sid_t> ids) {
+        sort(ids.begin(), ids.end());
+        ids.erase(unique(ids.begin(), ids.end()), ids.end());
+        for (auto id : ids) {
+            uint64_t key = (uint64_t)id >> 16;
+            if (chunks.empty() || chunks.back().key != key) {
+                if (!chunks.empty()) chunks.back().optimize();
+                chunks.push_back(chunk_t());
+                chunks.back().key = key;
+            }
+            chunks.back().vals.push_back((uint16_t)(id & 0xFFFF));
+            chunks.back().card++;
+        }
+        if (!chunks.empty()) chunks.back().optimize();
+        card = ids.size();
+    }
+
+    uint64_t size() const { return card; }
+
+    uint64_t bytes() const {
+        uint64_t sz = chunks.size() * sizeof(chunk_t);
+        for (auto const &c : chunks)
+            sz += c.vals.size() * sizeof(uint16_t) + c.words.size() * sizeof(uint64_t);
+        return sz;
+    }
+
+    bool contains(sid_t id) const {
+        const chunk_t *c = find_chunk((uint64_t)id >> 16);
+        return (c != NULL) && c->contains((uint16_t)(id & 0xFFFF));
+    }
+
+    // AND of two bitmaps
+    Bitmap intersect(const Bitmap &other) const {
+        Bitmap r;
+        auto i = chunks.begin(), j = other.chunks.begin();
+        while (i != chunks.end() && j != other.chunks.end()) {
+            if (i->key < j->key) { i++; continue; }
+            if (j->key < i->key) { j++; continue; }
+
+            chunk_t c;
+            intersect_chunk(*i, *j, c);
+            if (c.card > 0) {
+                r.card += c.card;
+                r.chunks.push_back(std::move(c));
+            }
+            i++; j++;
+        }
+        return r;
+    }
+
+    // append all IDs (in order) to out
+    void to_vector(vector<sid_t> &out) const {
+        out.reserve(out.size() + card);
+        for (auto const &c : chunks)
+            c.for_each([&](sid_t id) { out.push_back(id); });
+    }
+};
@@ -513,6 +513,7 @@ public:
         pthread_spin_init(&free_queue_lock, 0);
         lease = SEC(600);
         rdma_cache.set_lease(lease);
+        new_edges.resize(Global::num_threads);
     }
 
     ~DynamicGStore() {}
@@ -534,6 +535,26 @@ public:
         edge_allocator->print_memory_usage();
     }
 
+    /**
+     * The edges inserted by dynamic loading, which are consumed by the statistics
+     * of the planner (see Stats::update_stat) when the loading is finished.
+     * @new_key: the key (vid, pid, dir) of the edge is inserted together
+     */
+    struct new_edge_t {
+        triple_t triple;
+        dir_t dir;
+        bool new_key;
+
+        new_edge_t(const triple_t &triple, dir_t dir, bool new_key)
+            : triple(triple), dir(dir), new_key(new_key) { }
+    };
+    vector<vector<new_edge_t>> new_edges;  // per thread
+
+    inline void log_new_edge(const triple_t &triple, dir_t dir, bool new_key, int tid) {
+        if (Global::incremental_stats)
+            new_edges[tid].push_back(new_edge_t(triple, dir, new_key));
+    }
+
     void insert_triple_out(const triple_t &triple, bool check_dup, int tid) {
         bool dedup_or_isdup = check_dup;
         bool nodup = false;
@@ -543,7 +564,10 @@ public:
             dedup_or_isdup = true;
             ikey_t key = ikey_t(triple.s, triple.p, OUT);
             // <1> vid's type (7) [need dedup]
-            if (insert_vertex_edge(key, triple.o, dedup_or_isdup, tid)) {
+            bool new_key = insert_vertex_edge(key, triple.o, dedup_or_isdup, tid);
+            if (!dedup_or_isdup)
+                log_new_edge(triple, OUT, new_key, tid);
+            if (new_key) {
 #ifdef VERSATILE
                 key = ikey_t(triple.s, PREDICATE_ID, OUT);
                 // key and its buddy_key should be used to
@@ -571,7 +595,10 @@ public:
         } else {
             ikey_t key = ikey_t(triple.s, triple.p, OUT);
             // <6> vid's ngbrs w/ predicate (6) [need dedup]
-            if (insert_vertex_edge(key, triple.o, dedup_or_isdup, tid)) {
+            bool new_key = insert_vertex_edge(key, triple.o, dedup_or_isdup, tid);
+            if (!dedup_or_isdup)
+                log_new_edge(triple, OUT, new_key, tid);
+            if (new_key) {
                 key = ikey_t(0, triple.p, IN);
                 // key and its buddy_key should be used to
                 // identify the exist of corresponding index
@@ -607,7 +634,10 @@ public:
             return;
         ikey_t key = ikey_t(triple.o, triple.p, IN);
         // <1> vid's ngbrs w/ predicate (6) [need dedup]
-        if (insert_vertex_edge(key, triple.s, dedup_or_isdup, tid)) {
+        bool new_key = insert_vertex_edge(key, triple.s, dedup_or_isdup, tid);
+        if (!dedup_or_isdup)
+            log_new_edge(triple, IN, new_key, tid);
+        if (new_key) {
             // key doesn't exist before
             key = ikey_t(0, triple.p, OUT);
             // key and its buddy_key should be used
@@ -31,10 +31,25 @@ class GChecker {
     volatile uint64_t ivertex_num = 0;
     volatile uint64_t nvertex_num = 0;
 
+    // get the local index, where the compressed one is decoded into buf
+    // NOTE: not by the per-thread decoding of gstore, since the checker runs in parallel
+    //       (OpenMP) and holds several indexes at once
+    edge_t *get_index_local(sid_t pid, dir_t d, uint64_t &sz, vector<edge_t> &buf) {
+        const PackedList *packed = gstore->get_packed_index(pid, d);
+        if (packed == NULL)
+            return gstore->get_edges_local(0, 0, pid, d, sz);
+
+        sz = packed->size();
+        buf.resize(sz);
+        packed->decode(0, sz, buf.data());
+        return buf.data();
+    }
+
     void check2_idx_in(ikey_t key) {
         uint64_t vsz = 0;
         // get all local types
-        edge_t *vres = gstore->get_edges_local(0, 0, TYPE_ID, OUT, vsz);
+        vector<edge_t> vbuf;
+        edge_t *vres = get_index_local(TYPE_ID, OUT, vsz, vbuf);
         bool found = false;
         // check whether the pid exists or duplicate
         for (int i = 0; i < vsz; i++) {
@@ -50,7 +65,8 @@ class GChecker {
         if (!found) {
             uint64_t psz = 0;
             // get all local predicates
-            edge_t *pres = gstore->get_edges_local(0, 0, PREDICATE_ID, OUT, psz);
+            vector<edge_t> pbuf;
+            edge_t *pres = get_index_local(PREDICATE_ID, OUT, psz, pbuf);
             bool found = false;
             // check whether the pid exists or duplicate
             for (int i = 0; i < psz; i++) {
@@ -74,7 +90,8 @@ class GChecker {
 
             uint64_t vsz = 0;
             // get the vid refered which refered by the type/predicate
-            edge_t *vres = gstore->get_edges_local(0, 0, key.pid, IN, vsz);
+            vector<edge_t> vbuf;
+            edge_t *vres = get_index_local(key.pid, IN, vsz, vbuf);
             if (vsz == 0) {
                 logstream(LOG_ERROR) << "if " << key.pid << " is type, "
                                      << "in the value part of all local types [ 0 | TYPE_ID | OUT ]"
@@ -86,7 +103,8 @@ class GChecker {
                 found = false;
                 uint64_t sosz = 0;
                 // get all local objects/subjects
-                edge_t *sores = gstore->get_edges_local(0, 0, TYPE_ID, IN, sosz);
+                vector<edge_t> sobuf;
+                edge_t *sores = get_index_local(TYPE_ID, IN, sosz, sobuf);
                 for (int j = 0; j < sosz; j++) {
                     if (sores[j].val == vres[i].val && !found) {
                         found = true;
@@ -128,7 +146,8 @@ class GChecker {
     void check_idx_in(ikey_t key) {
         uint64_t vsz = 0;
         // get the vids which refered by index
-        edge_t *vres = gstore->get_edges_local(0, key.vid, key.pid, (dir_t)key.dir, vsz);
+        vector<edge_t> vbuf;
+        edge_t *vres = get_index_local(key.pid, (dir_t)key.dir, vsz, vbuf);
         for (int i = 0; i < vsz; i++) {
             uint64_t tsz = 0;
             // get the vids's type
@@ -167,7 +186,8 @@ class GChecker {
     void check2_idx_out(ikey_t key) {
         uint64_t psz = 0;
         // get all local predicates
-        edge_t *pres = gstore->get_edges_local(0, 0, PREDICATE_ID, OUT, psz);
+        vector<edge_t> pbuf;
+        edge_t *pres = get_index_local(PREDICATE_ID, OUT, psz, pbuf);
         bool found = false;
         // check whether the pid exists or duplicate
         for (int i = 0; i < psz; i++) {
@@ -186,12 +206,14 @@ class GChecker {
 
         uint64_t vsz = 0;
         // get the vid refered which refered by the predicate
-        edge_t *vres = gstore->get_edges_local(0, 0, key.pid, OUT, vsz);
+        vector<edge_t> vbuf;
+        edge_t *vres = get_index_local(key.pid, OUT, vsz, vbuf);
         for (int i = 0; i < vsz; i++) {
             found = false;
             uint64_t sosz = 0;
             // get all local objects/subjects
-            edge_t *sores = gstore->get_edges_local(0, 0, TYPE_ID, IN, sosz);
+            vector<edge_t> sobuf;
+            edge_t *sores = get_index_local(TYPE_ID, IN, sosz, sobuf);
             for (int j = 0; j < sosz; j++) {
                 if (sores[j].val == vres[i].val && !found) {
                     found = true;
@@ -232,7 +254,8 @@ class GChecker {
     void check_idx_out(ikey_t key) {
         uint64_t vsz = 0;
         // get the vids which refered by predicate index
-        edge_t *vres = gstore->get_edges_local(0, key.vid, key.pid, (dir_t)key.dir, vsz);
+        vector<edge_t> vbuf;
+        edge_t *vres = get_index_local(key.pid, (dir_t)key.dir, vsz, vbuf);
         for (int i = 0; i < vsz; i++)
             // check if the key generated by vid and pid exists
             if (gstore->get_vertex_local(0, ikey_t(vres[i].val, key.pid, IN)).key.is_empty())
@@ -272,7 +295,8 @@ class GChecker {
         found = false;
         uint64_t ossz = 0;
         // get all local subjects/objects
-        edge_t *osres = gstore->get_edges_local(0, 0, key.pid, IN, ossz);
+        vector<edge_t> osbuf;
+        edge_t *osres = get_index_local(key.pid, IN, ossz, osbuf);
         for (int i = 0; i < ossz; i++) {
             if (osres[i].val == key.vid && !found)
                 found = true;
@@ -296,7 +320,8 @@ class GChecker {
         for (int i = 0; i < tsz; i++) {
             uint64_t vsz = 0;
             // get the vids which refered by the type
-            edge_t *vres = gstore->get_edges_local(0, 0, tres[i].val, IN, vsz);
+            vector<edge_t> vbuf;
+            edge_t *vres = get_index_local(tres[i].val, IN, vsz, vbuf);
             bool found = false;
             for (int j = 0; j < vsz; j++) {
                 if (vres[j].val == key.vid && !found) {
@@ -324,7 +349,8 @@ class GChecker {
     void check_normal(ikey_t key, dir_t dir) {
         uint64_t vsz = 0;
         // get the vids which refered by the predicated
-        edge_t *vres = gstore->get_edges_local(0, 0, key.pid, dir, vsz);
+        vector<edge_t> vbuf;
+        edge_t *vres = get_index_local(key.pid, dir, vsz, vbuf);
         bool found = false;
         for (int i = 0; i < vsz; i++) {
             if (vres[i].val == key.vid && !found) {
@@ -384,6 +410,18 @@ public:
             }
         }
 
+        // the compressed indexes are stored out of the key/value pairs
+        if (index) {
+            vector<ikey_t> keys;
+            for (int d = 0; d < 2; d++)
+                for (auto const &e : gstore->packed_idx[d])
+                    keys.push_back(ikey_t(0, e.first, d));
+
+            #pragma omp parallel for num_threads(Global::num_engines)
+            for (size_t i = 0; i < keys.size(); i++)
+                check(keys[i], index, normal);
+        }
+
         logstream(LOG_INFO) << "Server#" << gstore->sid << " has checked "
                             << ivertex_num << " index vertices and "
                             << nvertex_num << " normal vertices." << LOG_endl;
@@ -28,6 +28,7 @@
 #include <iostream>
 #include <pthread.h>
 #include <boost/unordered_set.hpp>
+#include <boost/unordered_map.hpp>
 #include <tbb/concurrent_hash_map.h>
 #include <tbb/concurrent_unordered_set.h>
 #include <tbb/concurrent_unordered_map.h>
@@ -36,12 +37,17 @@
 #include <atomic>
 
 #include "global.hpp"
+#include "metrics.hpp"
 #include "rdma.hpp"
 #include "type.hpp"
+#include "partitioner.hpp"
 
 #include "store/vertex.hpp"
 #include "store/meta.hpp"
 #include "store/cache.hpp"
+#include "store/replica.hpp"
+#include "store/packed.hpp"
+#include "store/bitmap.hpp"
 #include "comm/tcp_adaptor.hpp"
 
 // utils
@@ -52,6 +58,13 @@
 
 using namespace std;
 
+// the remote accesses of a thread, used by query profiling and metrics
+struct access_stats_t {
+    uint64_t remote_reads = 0;  // #RDMA reads
+    uint64_t cache_lookups = 0; // #lookups of RDMA cache
+    uint64_t cache_hits = 0;    // #hits of RDMA cache
+};
+
 /**
  * Map the Graph model (e.g., vertex, edge, index) to KVS model (e.g., key, value)
  * Graph store adopts clustring chaining key/value store (see paper: DrTM SOSP'15)
@@ -172,6 +185,24 @@ protected:
 
     RDMA_Cache rdma_cache;
 
+    // edges too large for the RDMA buffer are fetched into it (per thread)
+    vector<vector<edge_t>> stages;
+
+    // the #RDMA reads and #hits of RDMA cache (per thread), for query profiling
+    vector<access_stats_t> access_stats;
+
+    // compressed predicate and type index (key: pid/tid), indexed by direction
+    bool compress_index = false;
+    boost::unordered_map<sid_t, PackedList> packed_idx[2];
+    // the compressed index is decoded into it (per thread),
+    // which is shrunk once it is much larger than the index being decoded
+    vector<vector<edge_t>> decodes;
+    static const uint64_t DECODE_SLACK = 1 << 16;  // #edges kept anyway
+
+    // bitmaps of predicate and type index (key: pid/tid), indexed by direction
+    bool bitmap_index = false;
+    boost::unordered_map<sid_t, Bitmap> bitmap_idx[2];
+
     // triples grouped by (predicate, direction), free after gstore init
     tbb_triple_hash_map triples_map;
     // attr triples grouped by (attr pred, direction), free after gstore init
@@ -265,11 +296,28 @@ protected:
         // the size of edges
         uint64_t r_sz = get_edge_sz(v);
         uint64_t buf_sz = mem->buffer_size();
-        ASSERT(r_sz < buf_sz); // enough space to host the edges
 
         RDMA &rdma = RDMA::get_rdma();
-        rdma.dev->RdmaRead(tid, dst_sid, buf, r_sz, r_off);
-        return (edge_t *)buf;
+        if (r_sz < buf_sz) { // enough space to host the edges
+            rdma.dev->RdmaRead(tid, dst_sid, buf, r_sz, r_off);
+            access_stats[tid].remote_reads++;
+            return (edge_t *)buf;
+        }
+
+        // fetch the edges by multiple RDMA reads (at most buf_sz bytes each),
+        // and copy them from the RDMA buffer to the staging buffer of the thread
+        vector<edge_t> &stage = stages[tid];
+        if (stage.size() * sizeof(edge_t) < r_sz) stage.resize(r_sz / sizeof(edge_t));
+
+        char *dst = (char *)stage.data();
+        uint64_t step = buf_sz - buf_sz % sizeof(edge_t);
+        for (uint64_t done = 0; done < r_sz; done += step) {
+            uint64_t sz = min(step, r_sz - done);
+            rdma.dev->RdmaRead(tid, dst_sid, buf, sz, r_off + done);
+            access_stats[tid].remote_reads++;
+            memcpy(dst + done, buf, sz);
+        }
+        return stage.data();
     }
 
     // Attention: not thread safe. The safety is guarenteed by caller
@@ -298,7 +346,7 @@ protected:
 
     // Get remote vertex of given key. This func will fail if RDMA is disabled.
     vertex_t get_vertex_remote(int tid, ikey_t key) {
-        int dst_sid = wukong::math::hash_mod(key.vid, Global::num_servers);
+        int dst_sid = Partitioner::server_of(key.vid);
         uint64_t bucket_id = bucket_remote(key, dst_sid);
         vertex_t vert;
 
@@ -306,8 +354,11 @@ protected:
         ASSERT(Global::use_rdma);
 
         // check cache
-        if (rdma_cache.lookup(key, vert))
+        access_stats[tid].cache_lookups++;
+        if (rdma_cache.lookup(key, vert)) {
+            access_stats[tid].cache_hits++;
             return vert;
+        }
 
         // get vertex by RDMA
         char *buf = mem->buffer(tid);
@@ -319,6 +370,7 @@ protected:
 
             RDMA &rdma = RDMA::get_rdma();
             rdma.dev->RdmaRead(tid, dst_sid, buf, sz, off);
+            access_stats[tid].remote_reads++;
             vertex_t *verts = (vertex_t *)buf;
             for (int i = 0; i < ASSOCIATIVITY; i++) {
                 if (i < ASSOCIATIVITY - 1) {
@@ -337,6 +389,13 @@ protected:
         }
     }
 
+    // the default (ignored) output of the type of edges, since a reference to NULL
+    // (i.e., *(int *)NULL) is undefined and its check is optimized away by compilers
+    static int &no_type() {
+        static __thread int type;
+        return type;
+    }
+
     // Get local vertex of given key.
     vertex_t get_vertex_local(int tid, ikey_t key) {
         uint64_t bucket_id = bucket_local(key);
@@ -363,7 +422,7 @@ protected:
     // Get remote edges according to given vid, pid, d.
     // @sz: size of return edges
     edge_t *get_edges_remote(int tid, sid_t vid, sid_t pid, dir_t d, uint64_t &sz,
-                             int &type = *(int *)NULL) {
+                             int &type = no_type()) {
         ikey_t key = ikey_t(vid, pid, d);
         vertex_t v = get_vertex_remote(tid, key);
 
@@ -373,7 +432,7 @@ protected:
         }
 
         // remote edges
-        int dst_sid = wukong::math::hash_mod(vid, Global::num_servers);
+        int dst_sid = Partitioner::server_of(vid);
         edge_t *edge_ptr = rdma_get_edges(tid, dst_sid, v);
         while (!edge_is_valid(v, edge_ptr)) { // check cache validation
             // invalidate cache and try again
@@ -383,15 +442,29 @@ protected:
         }
 
         sz = v.ptr.size;
-        if (&type != NULL)
-            type = v.ptr.type;
+        type = v.ptr.type;
         return edge_ptr;
     }
 
     // Get local edges according to given vid, pid, d.
     // @sz: size of return edges
     edge_t *get_edges_local(int tid, sid_t vid, sid_t pid, dir_t d, uint64_t &sz,
-                            int &type = *(int *)NULL) {
+                            int &type = no_type()) {
+        // compressed index, valid until the next decoding of the same thread
+        if (vid == 0 && compress_index) {
+            const PackedList *list = get_packed_index(pid, d);
+            if (list != NULL) {
+                vector<edge_t> &buf = decodes[tid];
+                if (buf.size() > max(DECODE_SLACK, 2 * list->size()))
+                    vector<edge_t>(list->size()).swap(buf);
+                else if (buf.size() < list->size())
+                    buf.resize(list->size());
+                list->decode(0, list->size(), buf.data());
+                sz = list->size();
+                return buf.data();
+            }
+        }
+
         ikey_t key = ikey_t(vid, pid, d);
         vertex_t v = get_vertex_local(tid, key);
 
@@ -404,8 +477,7 @@ protected:
         edge_t *edge_ptr = &(edges[v.ptr.off]);
 
         sz = v.ptr.size;
-        if (&type != NULL)
-            type = v.ptr.type;
+        type = v.ptr.type;
         return edge_ptr;
     }
 
@@ -740,8 +812,11 @@ protected:
             out_seg.num_edges = normal_cnt_map[pid].out.load();
             in_seg.num_edges = normal_cnt_map[pid].in.load();
 
-            idx_out_seg.num_edges += index_cnt_map[pid].out.load();
-            idx_in_seg.num_edges += index_cnt_map[pid].in.load();
+            // the compressed index is stored out of entry region
+            if (!compress_index) {
+                idx_out_seg.num_edges += index_cnt_map[pid].out.load();
+                idx_in_seg.num_edges += index_cnt_map[pid].in.load();
+            }
 
             if (attr_set.find(pid) != attr_set.end()) {
                 // attribute segment
@@ -976,6 +1051,9 @@ public:
     vertex_t *vertices;
     edge_t *edges;
 
+    // the replicas of hot vertices owned by other servers
+    ReplicaStore replicas;
+
     static const int ASSOCIATIVITY = 8;  // the associativity of slots in each bucket
 
     // Memory Usage (estimation):
@@ -1024,6 +1102,11 @@ public:
         vertices = (vertex_t *)(mem->kvstore());
         edges = (edge_t *)(mem->kvstore() + num_slots * sizeof(vertex_t));
 
+        stages.resize(Global::num_threads);
+        decodes.resize(Global::num_threads);
+        access_stats.resize(Global::num_threads);
+        add_metrics();
+
         pthread_spin_init(&bucket_ext_lock, 0);
         for (int i = 0; i < NUM_LOCKS; i++) {
             pthread_spin_init(&bucket_locks[i], 0);
@@ -1041,16 +1124,61 @@ public:
 
     // FIXME: refine return value with type of subject/object
     edge_t *get_edges(int tid, sid_t vid, sid_t pid, dir_t d, uint64_t &sz,
-                      int &type = *(int *)NULL) {
+                      int &type = no_type()) {
         // index vertex should be 0 and always local
         if (vid == 0)
             return get_edges_local(tid, 0, pid, d, sz);
 
         // normal vertex
-        if (wukong::math::hash_mod(vid, Global::num_servers) == sid)
+        if (Partitioner::server_of(vid) == sid)
             return get_edges_local(tid, vid, pid, d, sz, type);
-        else
-            return get_edges_remote(tid, vid, pid, d, sz, type);
+
+        // hot vertex replicated locally (attributes are not replicated)
+        if (replicas.is_hot(vid)) {
+            edge_t *edge_ptr = replicas.get_edges(ikey_t(vid, pid, d), sz);
+            if (edge_ptr != NULL) {
+                type = SID_t;
+                return edge_ptr;
+            }
+        }
+
+        return get_edges_remote(tid, vid, pid, d, sz, type);
+    }
+
+    access_stats_t &get_access_stats(int tid) { return access_stats[tid]; }
+
+    // export the remote accesses of all threads (summed lazily)
+    void add_metrics() {
+        auto sum = [this](uint64_t access_stats_t::*field) {
+            return [this, field]() {
+                double v = 0;
+                for (auto const &s : access_stats) v += s.*field;
+                return v;
+            };
+        };
+
+        Metrics &metrics = Metrics::get_metrics();
+        metrics.add_collector("wukong_gstore_remote_reads_total",
+                              "The number of RDMA reads issued by the gstore.", true,
+                              sum(&access_stats_t::remote_reads));
+        metrics.add_collector("wukong_rdma_cache_lookups_total",
+                              "The number of lookups of the RDMA cache.", true,
+                              sum(&access_stats_t::cache_lookups));
+        metrics.add_collector("wukong_rdma_cache_hits_total",
+                              "The number of hits of the RDMA cache.", true,
+                              sum(&access_stats_t::cache_hits));
+    }
+
+    // return NULL if the index is not compressed
+    const PackedList *get_packed_index(sid_t pid, dir_t d) {
+        auto it = packed_idx[d].find(pid);
+        return (it == packed_idx[d].end()) ? NULL : &it->second;
+    }
+
+    // return NULL if the index has no bitmap
+    const Bitmap *get_bitmap_index(sid_t pid, dir_t d) {
+        auto it = bitmap_idx[d].find(pid);
+        return (it == bitmap_idx[d].end()) ? NULL : &it->second;
     }
 
     void sync_metadata() {
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2016 Shanghai Jiao Tong University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://ipads.se.sjtu.edu.cn/projects/wukong
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+#include "type.hpp"
+#include "store/vertex.hpp"
+
+// utils
+#include "assertion.hpp"
+
+using namespace std;
+
+/**
+ * A compressed list of sorted (and unique) vertex IDs, e.g., the predicate and type index.
+ *
+ * The list is split into blocks of BLOCK_SIZE IDs. Each block keeps its first ID and
+ * packs the deltas of consecutive IDs with the minimum bit width of the block
+ * (i.e., delta + bit-packing, like PForDelta w/o exceptions). A block is decoded
+ * independently, so that a slice of the list is decoded w/o touching other blocks,
+ * and a membership test only decodes a single block.
+ */
+class PackedList {
+public:
+    static const int BLOCK_SIZE = 128;
+
+private:
+    struct block_t {
+        sid_t first;    // the first ID of the block
+        uint64_t off;   // the offset (in words) of packed deltas
+        int width;      // the bit width of deltas
+    };
+
+    uint64_t n = 0;
+    vector<block_t> blocks;
+    vector<uint32_t> words;  // packed deltas (2 words padded for decoding)
+
+    static int bit_width(uint64_t x) {
+        int w = 0;
+        while (x) { w++; x >>= 1; }
+        return w;
+    }
+
+    // read the delta at the bit position of the block (w/o bound check)
+    inline uint64_t extract(const uint32_t *w, uint64_t bit, int width) const {
+        w += bit >> 5;
+        int shift = bit & 31;
+        uint64_t x = ((uint64_t)w[0] | ((uint64_t)w[1] << 32)) >> shift;
+        if (shift + width > 64)
+            x |= (uint64_t)w[2] << (64 - shift);
+        return (width == 64) ? x : (x & ((1ull << width) - 1));
+    }
+
+    // decode the i-th block into out, and return the #IDs
+    inline int decode_block(uint64_t i, sid_t *out) const {
+        const block_t &b = blocks[i];
+        const uint32_t *w = words.data() + b.off;
+        int cnt = (int)min((uint64_t)BLOCK_SIZE, n - i * BLOCK_SIZE);
+
+        sid_t v = b.first;
+        out[0] = v;
+        uint64_t bit = 0;
+        for (int k = 1; k < cnt; k++, bit += b.width) {
+            v += extract(w, bit, b.width);
+            out[k] = v;
+        }
+        return cnt;
+    }
+
+public:
+    PackedList() { }
+
+    // @ids: sorted and unique
+    PackedList(const vector<sid_t> &ids) : n(ids.size()) {
+        for (uint64_t s = 0; s < n; s += BLOCK_SIZE) {
+            uint64_t e = min(n, s + BLOCK_SIZE);
+            uint64_t max_delta = 0;
+            for (uint64_t k = s + 1; k < e; k++) {
+                ASSERT(ids[k] > ids[k - 1]);
+                max_delta = max(max_delta, (uint64_t)(ids[k] - ids[k - 1]));
+            }
+
+            block_t b;
+            b.first = ids[s];
+            b.off = words.size();
+            b.width = bit_width(max_delta);
+            blocks.push_back(b);
+
+            uint64_t nbits = b.width * (e - s - 1);
+            words.resize(b.off + (nbits + 31) / 32, 0);
+            uint64_t bit = 0;
+            for (uint64_t k = s + 1; k < e; k++, bit += b.width) {
+                uint64_t delta = ids[k] - ids[k - 1];
+                for (int j = 0; j < b.width; j += 32 - ((bit + j) & 31)) {
+                    uint64_t pos = bit + j;
+                    words[b.off + (pos >> 5)] |= (uint32_t)((delta >> j) << (pos & 31));
+                }
+            }
+        }
+        words.resize(words.size() + 2, 0);
+    }
+
+    uint64_t size() const { return n; }
+
+    // the memory footprint (bytes) of the compressed list
+    uint64_t bytes() const {
+        return blocks.size() * sizeof(block_t) + words.size() * sizeof(uint32_t);
+    }
+
+    // decode the IDs in [lo, hi) into out
+    void decode(uint64_t lo, uint64_t hi, edge_t *out) const {
+        sid_t buf[BLOCK_SIZE];
+        hi = min(hi, n);
+        for (uint64_t i = lo / BLOCK_SIZE; i * BLOCK_SIZE < hi; i++) {
+            uint64_t base = i * BLOCK_SIZE;
+            int cnt = decode_block(i, buf);
+            uint64_t s = max(lo, base), e = min(hi, base + cnt);
+            for (uint64_t k = s; k < e; k++)
+                (out++)->val = buf[k - base];
+        }
+    }
+
+    // return the position of the ID, or -1 if not found (only decode a block)
+    int64_t find(sid_t id) const {
+        auto it = upper_bound(blocks.begin(), blocks.end(), id,
+        [](sid_t v, const block_t &b) { return v < b.first; });
+        if (it == blocks.begin()) return -1;
+
+        uint64_t i = (it - blocks.begin()) - 1;
+        sid_t buf[BLOCK_SIZE];
+        int cnt = decode_block(i, buf);
+        sid_t *p = lower_bound(buf, buf + cnt, id);
+        if (p == buf + cnt || *p != id) return -1;
+        return i * BLOCK_SIZE + (p - buf);
+    }
+
+    bool contains(sid_t id) const { return find(id) >= 0; }
+
+    /**
+     * Read the IDs of a list w/o decoding the whole list, where only the block of
+     * the current ID is decoded (i.e., once per block for a sequential scan).
+     */
+    class Reader {
+        const PackedList *list;
+        uint64_t block = UINT64_MAX;  // the decoded block
+        sid_t buf[BLOCK_SIZE];
+
+    public:
+        Reader(const PackedList *list = NULL) : list(list) { }
+
+        inline sid_t operator[](uint64_t k) {
+            uint64_t i = k / BLOCK_SIZE;
+            if (i != block) {
+                list->decode_block(i, buf);
+                block = i;
+            }
+            return buf[k - i * BLOCK_SIZE];
+        }
+    };
+};
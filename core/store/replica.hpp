@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2016 Shanghai Jiao Tong University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://ipads.se.sjtu.edu.cn/projects/wukong
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <boost/unordered_set.hpp>
+#include <tbb/concurrent_hash_map.h>
+
+#include "global.hpp"
+#include "type.hpp"
+#include "store/vertex.hpp"
+
+// utils
+#include "assertion.hpp"
+#include "logger2.hpp"
+
+using namespace std;
+
+/**
+ * Read-only replicas of the edges of hot (high-degree) vertices on all servers,
+ * so that the queries touching them are served locally instead of by a single
+ * server (and its NIC).
+ *
+ * The replicas are only written in batches (i.e., initial and dynamic loading):
+ * new edges are first buffered by insert() and then published by commit(),
+ * which swaps the whole edge list of each updated key. The stale lists are
+ * retired and reclaimed by epochs: each commit bumps the epoch, and each engine
+ * records the epoch at its quiescent point (i.e., between queries, see quiesce()),
+ * where it holds no edges from get_edges(). A list retired at epoch e is freed
+ * (by a later commit) once all engines have recorded e or a newer epoch.
+ */
+class ReplicaStore {
+private:
+    typedef tbb::concurrent_hash_map<ikey_t, vector<edge_t> *, ikey_Hasher> edges_map;
+    typedef tbb::concurrent_hash_map<ikey_t, vector<sid_t>, ikey_Hasher> pending_map;
+
+    boost::unordered_set<sid_t> hot_vids;  // fixed after initial loading
+    edges_map replicas;
+    pending_map pendings;
+
+    // for reclaiming the stale lists
+    atomic<uint64_t> epoch;                // bumped by each commit
+    vector<atomic<uint64_t>> quiescent;    // the epoch seen by each thread at its quiescent point
+    vector<pair<uint64_t, vector<edge_t> *>> retired;  // <epoch, stale list>
+
+    uint64_t num_edges = 0;
+
+    // append vals to (a copy of) the edge list of the key, and return the new list
+    // NOTE: the list is not sorted (same as the dynamic insertion of gstore)
+    vector<edge_t> *merge(vector<edge_t> *edges, vector<sid_t> &vals, bool check_dup) {
+        vector<edge_t> *merged = new vector<edge_t>();
+        if (edges != NULL) *merged = *edges;
+
+        boost::unordered_set<sid_t> exists;
+        if (check_dup)
+            for (auto const &e : *merged)
+                exists.insert(e.val);
+
+        for (auto const &v : vals) {
+            if (check_dup && !exists.insert(v).second) continue;
+            edge_t e;
+            e.val = v;
+            merged->push_back(e);
+        }
+        return merged;
+    }
+
+    // free the stale lists retired before the oldest epoch seen by all engines
+    void reclaim() {
+        uint64_t safe = epoch.load();
+        for (int i = 0; i < Global::num_engines; i++)
+            safe = min(safe, quiescent[Global::num_proxies + i].load());
+
+        size_t n = 0;
+        for (auto &r : retired) {
+            if (r.first <= safe)
+                delete r.second;
+            else
+                retired[n++] = r;
+        }
+        retired.resize(n);
+    }
+
+public:
+    ReplicaStore() : epoch(0), quiescent(Global::num_threads) { }
+
+    ~ReplicaStore() {
+        for (auto &e : replicas) delete e.second;
+        for (auto &r : retired) delete r.second;
+    }
+
+    bool empty() const { return hot_vids.empty(); }
+
+    size_t size() const { return hot_vids.size(); }
+
+    uint64_t get_num_edges() const { return num_edges; }
+
+    size_t get_num_retired() const { return retired.size(); }
+
+    // should be called before processing queries
+    void add_hot_vertex(sid_t vid) { hot_vids.insert(vid); }
+
+    bool is_hot(sid_t vid) const {
+        return !hot_vids.empty() && hot_vids.find(vid) != hot_vids.end();
+    }
+
+    // return NULL if the key is not replicated
+    edge_t *get_edges(ikey_t key, uint64_t &sz) {
+        edges_map::const_accessor a;
+        if (!replicas.find(a, key)) return NULL;
+
+        sz = a->second->size();
+        return a->second->data();
+    }
+
+    // called by the engine (tid) at the point w/o any edges from get_edges() held
+    void quiesce(int tid) {
+        uint64_t e = epoch.load();
+        if (quiescent[tid].load(memory_order_relaxed) != e)
+            quiescent[tid].store(e);
+    }
+
+    // buffer a new edge (thread safe)
+    void insert(ikey_t key, sid_t val) {
+        ASSERT(is_hot(key.vid));
+        pending_map::accessor a;
+        pendings.insert(a, key);
+        a->second.push_back(val);
+    }
+
+    // publish all buffered edges (by a single thread)
+    void commit(bool check_dup = false) {
+        reclaim();
+
+#ifdef VERSATILE
+        // the predicates of hot vertices, i.e., [vid|PREDICATE_ID|IN/OUT]
+        vector<pair<ikey_t, sid_t>> new_preds;
+        for (auto const &p : pendings) {
+            if (p.first.pid == PREDICATE_ID) continue;
+            edges_map::const_accessor a;
+            if (!replicas.find(a, p.first))
+                new_preds.push_back(make_pair(ikey_t(p.first.vid, PREDICATE_ID, p.first.dir),
+                                              p.first.pid));
+        }
+        for (auto const &p : new_preds)
+            insert(p.first, p.second);
+#endif
+
+        for (auto &p : pendings) {
+            edges_map::accessor a;
+            if (replicas.insert(a, p.first)) a->second = NULL;
+
+            vector<edge_t> *merged = merge(a->second, p.second, check_dup);
+            num_edges += merged->size();
+            if (a->second != NULL) {
+                num_edges -= a->second->size();
+                retired.push_back(make_pair(epoch.load() + 1, a->second));
+            }
+            a->second = merged;
+        }
+        pendings.clear();
+
+        // the stale lists may be still held by engines until they pass the new epoch
+        epoch++;
+    }
+};
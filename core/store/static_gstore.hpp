@@ -210,6 +210,14 @@ private:
         ASSERT(off <= segment.edge_start + segment.num_edges);
     }
 
+    // insert a compressed index (sorted) out of entry region
+    void insert_packed_idx(sid_t pid, const vector<sid_t> &vids, dir_t d) {
+        vector<sid_t> ids(vids);
+        sort(ids.begin(), ids.end());
+        ids.erase(unique(ids.begin(), ids.end()), ids.end());
+        packed_idx[d][pid] = PackedList(ids);
+    }
+
     /**
      * insert {predicate index OUT, t_set*, p_set*}
      * or {predicate index IN, type index, v_set*}
@@ -229,6 +237,14 @@ private:
             if (!success)
                 continue;
 
+            if (bitmap_index)
+                bitmap_idx[d][pid] = Bitmap(ca->second);
+
+            if (compress_index) {
+                insert_packed_idx(pid, ca->second, d);
+                continue;
+            }
+
             uint64_t sz = ca->second.size();
             ASSERT(sz <= segment.num_edges);
 
@@ -248,6 +264,14 @@ private:
         if (d == IN) {
             for (auto const &e : tidx_map) {
                 sid_t pid = e.first;
+                if (bitmap_index)
+                    bitmap_idx[IN][pid] = Bitmap(e.second);
+
+                if (compress_index) {
+                    insert_packed_idx(pid, e.second, IN);
+                    continue;
+                }
+
                 uint64_t sz = e.second.size();
                 ASSERT(sz <= segment.num_edges);
                 logger(LOG_DEBUG, "insert_tidx: pid: %lu, sz: %lu", pid, sz);
@@ -376,6 +400,14 @@ private:
 public:
     StaticGStore(int sid, Mem *mem): GStore(sid, mem) {
         pthread_spin_init(&entry_lock, 0);
+#ifdef USE_GPU
+        // GPU engines copy the index from the (uncompressed) segments
+        if (Global::compress_index)
+            logstream(LOG_WARNING) << "compressed index is disabled w/ GPU" << LOG_endl;
+#else
+        compress_index = Global::compress_index;
+#endif
+        bitmap_index = Global::enable_bitmap_index;
     }
 
     ~StaticGStore() {}
@@ -467,6 +499,42 @@ public:
         GStore::print_mem_usage();
         logstream(LOG_INFO) << "\tused: " << 100.0 * last_entry / num_entries
                             << " % (last edge position: " << last_entry << ")" << LOG_endl;
+
+        if (bitmap_index) {
+            uint64_t nbytes = 0, nids = 0;
+            for (int d = 0; d < 2; d++) {
+                for (auto const &e : bitmap_idx[d]) {
+                    nbytes += e.second.bytes();
+                    nids += e.second.size();
+                }
+            }
+            logstream(LOG_INFO) << "bitmap index: " << B2MiB(nbytes) << " MB ("
+                                << nids << " vertices)" << LOG_endl;
+        }
+
+        if (!compress_index) return;
+
+        // compression ratio and decoding throughput of the compressed index
+        uint64_t nedges = 0, nbytes = 0, max_sz = 0;
+        for (int d = 0; d < 2; d++) {
+            for (auto const &e : packed_idx[d]) {
+                nedges += e.second.size();
+                nbytes += e.second.bytes();
+                max_sz = max(max_sz, e.second.size());
+            }
+        }
+
+        vector<edge_t> buf(max_sz);
+        uint64_t start = timer::get_usec();
+        for (int d = 0; d < 2; d++)
+            for (auto const &e : packed_idx[d])
+                e.second.decode(0, e.second.size(), buf.data());
+        uint64_t time = max(timer::get_usec() - start, (uint64_t)1);
+
+        logstream(LOG_INFO) << "compressed index: " << B2MiB(nbytes) << " MB ("
+                            << nedges << " edges)" << LOG_endl;
+        logstream(LOG_INFO) << "\tratio: " << (nbytes ? (double)nedges * sizeof(edge_t) / nbytes : 0)
+                            << ", decode: " << nedges / time << " M edges/sec" << LOG_endl;
     }
 
 };
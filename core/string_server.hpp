@@ -63,6 +63,9 @@ public:
     uint64_t next_index_id;
     uint64_t next_normal_id;
 
+    // an empty string server filled by add() (e.g., w/ the generated data of benchmarks)
+    StringServer() : next_index_id(0), next_normal_id(0) { }
+
     StringServer(string dname) {
         uint64_t start = timer::get_usec();
 
@@ -34,6 +34,8 @@
 #include "console.hpp"
 #include "rdma.hpp"
 #include "stats.hpp"
+#include "partitioner.hpp"
+#include "metrics.hpp"
 
 #include "engine/engine.hpp"
 #include "comm/adaptor.hpp"
@@ -111,6 +113,9 @@ main(int argc, char *argv[])
     // load global configs
     load_config(string(argv[1]), world.size());
 
+    // set the partitioning of RDF graph (hashing by default)
+    Partitioner::init(Global::partition_file);
+
     // set the address file of host/cluster
     string host_fname = std::string(argv[2]);
 
@@ -200,7 +205,7 @@ main(int argc, char *argv[])
     }
     // create proxies and engines
     for (int tid = 0; tid < Global::num_proxies + Global::num_engines; tid++) {
-        Adaptor *adaptor = new Adaptor(tid, tcp_adaptor, rdma_adaptor);
+        Adaptor *adaptor = new Adaptor(sid, tid, tcp_adaptor, rdma_adaptor);
 
         // TID: proxy = [0, #proxies), engine = [#proxies, #proxies + #engines)
         if (tid < Global::num_proxies) {
@@ -224,6 +229,12 @@ main(int argc, char *argv[])
                            (void *)engines[tid - Global::num_proxies]);
     }
 
+    // export metrics by HTTP (one port per server, in case of co-located servers)
+    if (Global::metrics_port > 0) {
+        MetricsServer *metrics_server = new MetricsServer(sid, Global::metrics_port + sid);
+        metrics_server->start();
+    }
+
 #ifdef USE_GPU
     logstream(LOG_INFO) << "#" << sid
                         << " #threads:" << Global::num_threads
@@ -236,7 +247,7 @@ main(int argc, char *argv[])
     GPUCache gpu_cache(gpu_mem, dgraph.gstore->vertices, dgraph.gstore->edges,
                        static_cast<StaticGStore *>(dgraph.gstore)->get_rdf_seg_metas());
     GPUEngine gpu_engine(sid, WUKONG_GPU_AGENT_TID, gpu_mem, &gpu_cache, &stream_pool, &dgraph);
-    GPUAgent agent(sid, WUKONG_GPU_AGENT_TID, new Adaptor(WUKONG_GPU_AGENT_TID,
+    GPUAgent agent(sid, WUKONG_GPU_AGENT_TID, new Adaptor(sid, WUKONG_GPU_AGENT_TID,
                    tcp_adaptor, rdma_adaptor), &gpu_engine);
     pthread_create(&(threads[WUKONG_GPU_AGENT_TID]), NULL, agent_thread, (void *)&agent);
 #endif
@@ -0,0 +1,433 @@
+/*
+ * Copyright (c) 2016 Shanghai Jiao Tong University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://ipads.se.sjtu.edu.cn/projects/wukong
+ *
+ */
+
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <math.h>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <assert.h>
+#include <omp.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/**
+ * generate LUBM-like RDF data in id-format directly (see generate_data.cpp),
+ * w/o the raw LUBM data and the conversion
+ *
+ * It follows the schema, the IRIs and the sizes of LUBM (e.g., 15-25 departments per
+ * university), so that the LUBM queries (scripts/sparql_query/lubm) can run on the data.
+ * The degrees can be skewed by a Zipf distribution (e.g., the popularity of courses,
+ * advisors and universities granting degrees), where the most popular ones become hub
+ * vertices. The default skew (0) is uniform like LUBM.
+ *
+ * Universities are generated in parallel, each from its own seed (i.e., seed and the
+ * university number), and the IDs are assigned in the order of universities. So the
+ * output is deterministic by seed regardless of the number of threads.
+ *
+ * Output (the same as generate_data.cpp and add_attribute.cpp):
+ *   id_uni<N>.nt: the triples of university N (subject, predicate, object)
+ *   attr_uni<N>.nt: the attributes of university N (w/ option -a)
+ *   str_index, str_normal, str_attr_index: the ID-mapping tables
+ *
+ * A simple manual
+ *  $g++ -std=c++11 -O2 -fopenmp lubm_gen.cpp -o lubm_gen
+ *  $./lubm_gen -u 40 -s 1 -z 1.0 id_lubm_40
+ */
+
+using namespace std;
+
+/* logical we split id-mapping table to normal-vertex and index-vertex table,
+   but mapping all strings into the same id space. We reserve 2^NBITS_IDX ids
+   for index vertices. */
+enum { NBITS_IDX = 17 };
+
+#define RDF "<http://www.w3.org/1999/02/22-rdf-syntax-ns#"
+#define UB  "<http://swat.cse.lehigh.edu/onto/univ-bench.owl#"
+
+// index vertices (predicates and types), IDs are the positions
+enum {
+    P_PREDICATE = 0, P_TYPE,
+    P_SUB_ORG, P_WORKS_FOR, P_MEMBER_OF, P_TAKES_COURSE, P_TEACHER_OF,
+    P_ADVISOR, P_UG_DEGREE, P_DOC_DEGREE, P_NAME, P_EMAIL, P_TELEPHONE,
+    T_UNIV, T_DEPT, T_GROUP, T_FULL, T_ASSOC, T_ASSIST,
+    T_COURSE, T_GCOURSE, T_UGSTUDENT, T_GSTUDENT,
+    NUM_INDEX,
+    A_ID = NUM_INDEX  // attribute (int), the same as add_attribute.cpp
+};
+
+static const char *index_strs[] = {
+    "__PREDICATE__", RDF "type>",
+    UB "subOrganizationOf>", UB "worksFor>", UB "memberOf>", UB "takesCourse>",
+    UB "teacherOf>", UB "advisor>", UB "undergraduateDegreeFrom>",
+    UB "doctoralDegreeFrom>", UB "name>", UB "emailAddress>", UB "telephone>",
+    UB "University>", UB "Department>", UB "ResearchGroup>", UB "FullProfessor>",
+    UB "AssociateProfessor>", UB "AssistantProfessor>", UB "Course>",
+    UB "GraduateCourse>", UB "UndergraduateStudent>", UB "GraduateStudent>"
+};
+
+/**
+ * the literals shared by all universities (e.g., "Course0" is the name of a course
+ * in each department), which take the IDs after universities, so that a string
+ * is mapped to only one ID w/o a global dictionary. The max numbers follow the
+ * ranges of LUBM (e.g., at most 35 faculty teach at most 2 courses each).
+ */
+static const struct { const char *kind; int max; } shared_literals[] = {
+    { "Department", 25 },
+    { "FullProfessor", 10 },
+    { "AssociateProfessor", 14 },
+    { "AssistantProfessor", 11 },
+    { "Course", 70 },
+    { "GraduateCourse", 70 },
+    { "UndergraduateStudent", 490 },
+    { "GraduateStudent", 140 },
+};
+static const int NUM_SHARED_KINDS = sizeof(shared_literals) / sizeof(shared_literals[0]);
+
+static int num_univs = 1;
+static uint64_t seed = 0;
+static double skew = 0;         // 0 means uniform (i.e., LUBM)
+static bool with_attr = false;
+
+static int64_t univ_base;       // the ID of University0
+static int64_t phone_id;        // "xxx-xxx-xxxx"
+static int64_t shared_base[NUM_SHARED_KINDS];
+static int64_t next_normal_id;
+
+static inline int64_t univ_id(int u) { return univ_base + u; }
+
+static inline int64_t shared_id(int kind, int i) {
+    assert(i < shared_literals[kind].max);
+    return shared_base[kind] + i;
+}
+
+static inline string literal(const string &str) { return "\"" + str + "\""; }
+
+/**
+ * sample the rank in [0, n) w/ P(k) ~ 1 / (k + 1)^s, or uniformly if s is 0
+ */
+class Zipf {
+private:
+    vector<double> cdf;
+
+public:
+    Zipf(int n, double s) {
+        if (s == 0) return;
+        cdf.resize(n);
+        double sum = 0;
+        for (int k = 0; k < n; k++) {
+            sum += 1.0 / pow(k + 1, s);
+            cdf[k] = sum;
+        }
+        for (int k = 0; k < n; k++) cdf[k] /= sum;
+    }
+
+    int sample(mt19937_64 &rng, int n) {
+        if (cdf.empty()) return rng() % n;
+        double x = (rng() >> 11) * (1.0 / 9007199254740992.0);  // [0, 1)
+        return min((int)(lower_bound(cdf.begin(), cdf.end(), x) - cdf.begin()), n - 1);
+    }
+};
+
+static Zipf *univ_zipf;  // the universities granting degrees
+
+/**
+ * the data of a university, where the local vertices (i.e., the IRIs and literals
+ * only used by the university) are numbered from 0 and encoded as -(n + 1) until
+ * the IDs are assigned
+ */
+struct Univ {
+    int u;
+    mt19937_64 rng;
+
+    vector<string> strs;        // local vertices
+    vector<int64_t> triples;    // s, p, o
+    vector<int64_t> attrs;      // s, a, value
+
+    int64_t base = 0;           // the ID of local vertex 0
+
+    Univ(int u) : u(u), rng(seed * 1000003 + u) { }
+
+    int64_t local(const string &str) {
+        strs.push_back(str);
+        return -(int64_t)strs.size();
+    }
+
+    int64_t id_of(int64_t x) const { return (x < 0) ? base + (-x - 1) : x; }
+
+    void add(int64_t s, int64_t p, int64_t o) {
+        triples.push_back(s);
+        triples.push_back(p);
+        triples.push_back(o);
+    }
+
+    int rand_in(int lo, int hi) { return lo + (int)(rng() % (hi - lo + 1)); }
+
+    int64_t rand_univ() { return univ_id(univ_zipf->sample(rng, num_univs)); }
+
+    // the name of an entity is a shared literal, e.g., "Course0" (w/ the attribute ub:id 0)
+    void add_name(int64_t x, int kind, int i) {
+        add(x, P_NAME, shared_id(kind, i));
+        if (with_attr) {
+            attrs.push_back(x);
+            attrs.push_back(A_ID);
+            attrs.push_back(i);
+        }
+    }
+
+    // pick k distinct elements of v w/ skew
+    vector<int64_t> pick(const vector<int64_t> &v, int k, Zipf &zipf) {
+        vector<int64_t> r;
+        k = min(k, (int)v.size());
+        while ((int)r.size() < k) {
+            int64_t x = v[zipf.sample(rng, v.size())];
+            if (find(r.begin(), r.end(), x) == r.end()) r.push_back(x);
+        }
+        return r;
+    }
+
+    void gen_department(int d) {
+        string dept = "Department" + to_string(d) + ".University" + to_string(u) + ".edu";
+        string base = "<http://www." + dept + "/";
+        int64_t x = local("<http://www." + dept + ">");
+        add(x, P_TYPE, T_DEPT);
+        add(x, P_SUB_ORG, univ_id(u));
+        add_name(x, 0, d);
+
+        int ngroups = rand_in(10, 20);
+        for (int i = 0; i < ngroups; i++) {
+            int64_t g = local(base + "ResearchGroup" + to_string(i) + ">");
+            add(g, P_TYPE, T_GROUP);
+            add(g, P_SUB_ORG, x);
+        }
+
+        // faculty teach courses (1-2) and graduate courses (1-2)
+        vector<int64_t> faculty, courses, gcourses;
+        const char *ranks[] = { "FullProfessor", "AssociateProfessor", "AssistantProfessor" };
+        int64_t rank_types[] = { T_FULL, T_ASSOC, T_ASSIST };
+        int nranks[] = { rand_in(7, 10), rand_in(10, 14), rand_in(8, 11) };
+        for (int r = 0; r < 3; r++) {
+            for (int i = 0; i < nranks[r]; i++) {
+                string name = ranks[r] + to_string(i);
+                int64_t f = local(base + name + ">");
+                faculty.push_back(f);
+                add(f, P_TYPE, rank_types[r]);
+                add(f, P_WORKS_FOR, x);
+                add_name(f, 1 + r, i);
+                add(f, P_EMAIL, local(literal(name + "@" + dept)));
+                add(f, P_TELEPHONE, phone_id);
+                add(f, P_UG_DEGREE, rand_univ());
+                add(f, P_DOC_DEGREE, rand_univ());
+
+                for (int c = rand_in(1, 2); c > 0; c--) {
+                    int64_t cs = local(base + "Course" + to_string(courses.size()) + ">");
+                    add(cs, P_TYPE, T_COURSE);
+                    add_name(cs, 4, courses.size());
+                    add(f, P_TEACHER_OF, cs);
+                    courses.push_back(cs);
+                }
+                for (int c = rand_in(1, 2); c > 0; c--) {
+                    int64_t cs = local(base + "GraduateCourse" + to_string(gcourses.size()) + ">");
+                    add(cs, P_TYPE, T_GCOURSE);
+                    add_name(cs, 5, gcourses.size());
+                    add(f, P_TEACHER_OF, cs);
+                    gcourses.push_back(cs);
+                }
+            }
+        }
+
+        Zipf course_zipf(courses.size(), skew);
+        Zipf gcourse_zipf(gcourses.size(), skew);
+        Zipf faculty_zipf(faculty.size(), skew);
+
+        // undergraduate students (8-14 per faculty), 1/5 of them have an advisor
+        int nug = faculty.size() * rand_in(8, 14);
+        for (int i = 0; i < nug; i++) {
+            string name = "UndergraduateStudent" + to_string(i);
+            int64_t s = local(base + name + ">");
+            add(s, P_TYPE, T_UGSTUDENT);
+            add(s, P_MEMBER_OF, x);
+            add_name(s, 6, i);
+            add(s, P_EMAIL, local(literal(name + "@" + dept)));
+            add(s, P_TELEPHONE, phone_id);
+            for (auto c : pick(courses, rand_in(2, 4), course_zipf))
+                add(s, P_TAKES_COURSE, c);
+            if (rng() % 5 == 0)
+                add(s, P_ADVISOR, faculty[faculty_zipf.sample(rng, faculty.size())]);
+        }
+
+        // graduate students (3-4 per faculty)
+        int ngs = faculty.size() * rand_in(3, 4);
+        for (int i = 0; i < ngs; i++) {
+            string name = "GraduateStudent" + to_string(i);
+            int64_t s = local(base + name + ">");
+            add(s, P_TYPE, T_GSTUDENT);
+            add(s, P_MEMBER_OF, x);
+            add_name(s, 7, i);
+            add(s, P_EMAIL, local(literal(name + "@" + dept)));
+            add(s, P_TELEPHONE, phone_id);
+            for (auto c : pick(gcourses, rand_in(1, 3), gcourse_zipf))
+                add(s, P_TAKES_COURSE, c);
+            add(s, P_ADVISOR, faculty[faculty_zipf.sample(rng, faculty.size())]);
+            add(s, P_UG_DEGREE, rand_univ());
+        }
+    }
+
+    void generate() {
+        // NOTE: the university itself is not local (see univ_id)
+        add(univ_id(u), P_TYPE, T_UNIV);
+        add(univ_id(u), P_NAME, local(literal("University" + to_string(u))));
+        int ndepts = rand_in(15, 25);
+        for (int d = 0; d < ndepts; d++)
+            gen_department(d);
+    }
+
+    void write(const string &dname) {
+        ofstream ofile((dname + "/id_uni" + to_string(u) + ".nt").c_str());
+        for (size_t i = 0; i < triples.size(); i += 3)
+            ofile << id_of(triples[i]) << "\t" << triples[i + 1] << "\t"
+                  << id_of(triples[i + 2]) << "\n";
+
+        if (!with_attr) return;
+        ofstream attr_file((dname + "/attr_uni" + to_string(u) + ".nt").c_str());
+        for (size_t i = 0; i < attrs.size(); i += 3)
+            attr_file << id_of(attrs[i]) << "\t" << attrs[i + 1] << "\t"
+                      << 1 << "\t" << attrs[i + 2] << "\n";
+    }
+};
+
+static void usage(char *fn)
+{
+    cout << "usage: " << fn << " [options] dst_dir" << endl;
+    cout << "options:" << endl;
+    cout << "  -u num    : the number of universities (default: 1)" << endl;
+    cout << "  -s seed   : the seed of generation (default: 0)" << endl;
+    cout << "  -z skew   : the Zipf skew of degrees, 0 means uniform (default: 0)" << endl;
+    cout << "  -a        : generate attributes (i.e., ub:id)" << endl;
+    cout << "  -t num    : the number of threads (default: #cores)" << endl;
+}
+
+int
+main(int argc, char** argv)
+{
+    int nthreads = omp_get_max_threads();
+
+    int c;
+    while ((c = getopt(argc, argv, "u:s:z:at:h")) != -1) {
+        switch (c) {
+        case 'u': num_univs = atoi(optarg); break;
+        case 's': seed = strtoull(optarg, NULL, 10); break;
+        case 'z': skew = atof(optarg); break;
+        case 'a': with_attr = true; break;
+        case 't': nthreads = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            exit(-1);
+        }
+    }
+    if (optind != argc - 1 || num_univs <= 0 || skew < 0 || nthreads <= 0) {
+        usage(argv[0]);
+        exit(-1);
+    }
+    string ddir_name = argv[optind];
+
+    // create destination directory
+    if (mkdir(ddir_name.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) < 0) {
+        cout << "Error: Creating dst_dir (" << ddir_name << ") failed." << endl;
+        exit(-1);
+    }
+
+    /* build ID-mapping (str2id) table file for index (and attr) vertices */
+    {
+        ofstream f_index((ddir_name + "/str_index").c_str());
+        for (int i = 0; i < NUM_INDEX; i++)
+            f_index << index_strs[i] << "\t" << i << endl;
+
+        ofstream f_attr((ddir_name + "/str_attr_index").c_str());
+        if (with_attr)
+            f_attr << UB "id>" << "\t" << A_ID << "\t" << 1 << endl;
+    }
+
+    // the shared vertices (universities and literals) take the first IDs
+    ofstream f_normal((ddir_name + "/str_normal").c_str());
+    next_normal_id = 1 << NBITS_IDX; // reserve 2^NBITS_IDX ids for index vertices
+    univ_base = next_normal_id;
+    for (int u = 0; u < num_univs; u++)
+        f_normal << "<http://www.University" << u << ".edu>\t" << next_normal_id++ << "\n";
+    phone_id = next_normal_id;
+    f_normal << literal("xxx-xxx-xxxx") << "\t" << next_normal_id++ << "\n";
+    for (int k = 0; k < NUM_SHARED_KINDS; k++) {
+        shared_base[k] = next_normal_id;
+        for (int i = 0; i < shared_literals[k].max; i++)
+            f_normal << literal(shared_literals[k].kind + to_string(i)) << "\t"
+                     << next_normal_id++ << "\n";
+    }
+
+    univ_zipf = new Zipf(num_univs, skew);
+
+    // generate universities by batches in parallel, and assign IDs in order
+    uint64_t ntriples = 0, nattrs = 0;
+    int batch = nthreads * 4;
+    for (int start = 0; start < num_univs; start += batch) {
+        int end = min(start + batch, num_univs);
+        vector<Univ *> univs(end - start);
+
+        #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+        for (int u = start; u < end; u++) {
+            univs[u - start] = new Univ(u);
+            univs[u - start]->generate();
+        }
+
+        for (auto univ : univs) {
+            univ->base = next_normal_id;
+            for (size_t i = 0; i < univ->strs.size(); i++)
+                f_normal << univ->strs[i] << "\t" << next_normal_id++ << "\n";
+            ntriples += univ->triples.size() / 3;
+            nattrs += univ->attrs.size() / 3;
+        }
+
+        #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+        for (int i = 0; i < (int)univs.size(); i++) {
+            univs[i]->write(ddir_name);
+            delete univs[i];
+        }
+
+        cout << "Generate " << end << "/" << num_univs << " universities." << endl;
+    }
+    f_normal.close();
+
+    cout << "#total_vertex = " << (next_normal_id - (1 << NBITS_IDX)) + NUM_INDEX + with_attr << endl;
+    cout << "#normal_vertex = " << next_normal_id - (1 << NBITS_IDX) << endl;
+    cout << "#index_vertex = " << NUM_INDEX << endl;
+    cout << "#attr_vertex = " << (with_attr ? 1 : 0) << endl;
+    cout << "#triples = " << ntriples << ", #attributes = " << nattrs << endl;
+
+    return 0;
+}
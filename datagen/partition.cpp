@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2016 Shanghai Jiao Tong University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://ipads.se.sjtu.edu.cn/projects/wukong
+ *
+ */
+
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+
+/**
+ * compute a locality-aware partitioning of id-format RDF data (see generate_data.cpp),
+ * which co-locates subjects and objects linked with each other on the same server
+ * to reduce edge-cut (i.e., the edges replicated on two servers and the sub-queries
+ * sent across servers), while keeping the #edges on each server balanced.
+ *
+ * It starts from hashing (the default partitioning of Wukong) and moves vertices
+ * by label propagation, i.e., each vertex joins the server where most of its
+ * neighbors are, as long as the server is not overloaded.
+ *
+ * Only the vertices not placed by hashing are written to the output file as lines
+ * of "vid sid", which is used by Wukong via "global_partition_file" in config.
+ *
+ * A simple manual
+ *  $g++ -std=c++11 -O2 partition.cpp -o partition
+ *  $./partition id_lubm_40 4 id_lubm_40/partition_4
+ */
+
+using namespace std;
+
+enum { NBITS_IDX = 17 };  // the ids of index vertices (types and predicates) < 2^NBITS_IDX
+
+typedef uint64_t vid_t;
+
+static vector<vid_t> vids;    // dense index -> vid (sorted)
+static vector<uint64_t> offs; // CSR of the undirected graph
+static vector<uint32_t> nbrs;
+
+static inline uint32_t index_of(vid_t vid) {
+    return lower_bound(vids.begin(), vids.end(), vid) - vids.begin();
+}
+
+static void load_edges(string dname, vector<pair<vid_t, vid_t>> &edges) {
+    DIR *dir = opendir(dname.c_str());
+    if (dir == NULL) {
+        cout << "ERROR: failed to open directory " << dname << endl;
+        exit(-1);
+    }
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        string fname(ent->d_name);
+        if (fname.find("id_") != 0) continue;  // only ID-format data files
+
+        ifstream file((dname + "/" + fname).c_str());
+        vid_t s, p, o;
+        while (file >> s >> p >> o) {
+            // the edges to index vertices are replicated anyway
+            if (s < (1 << NBITS_IDX) || o < (1 << NBITS_IDX)) continue;
+            edges.push_back(make_pair(s, o));
+        }
+        cout << "load " << fname << ", #edges = " << edges.size() << endl;
+    }
+    closedir(dir);
+}
+
+static void build_graph(vector<pair<vid_t, vid_t>> &edges) {
+    for (auto const &e : edges) {
+        vids.push_back(e.first);
+        vids.push_back(e.second);
+    }
+    sort(vids.begin(), vids.end());
+    vids.erase(unique(vids.begin(), vids.end()), vids.end());
+
+    offs.assign(vids.size() + 1, 0);
+    for (auto const &e : edges) {
+        offs[index_of(e.first) + 1]++;
+        offs[index_of(e.second) + 1]++;
+    }
+    for (size_t i = 0; i < vids.size(); i++)
+        offs[i + 1] += offs[i];
+
+    vector<uint64_t> pos(offs.begin(), offs.end() - 1);
+    nbrs.resize(offs.back());
+    for (auto const &e : edges) {
+        uint32_t s = index_of(e.first), o = index_of(e.second);
+        nbrs[pos[s]++] = o;
+        nbrs[pos[o]++] = s;
+    }
+}
+
+// #edges across servers
+static uint64_t edge_cut(vector<int> &parts) {
+    uint64_t cut = 0;
+    for (size_t v = 0; v < vids.size(); v++)
+        for (uint64_t i = offs[v]; i < offs[v + 1]; i++)
+            if (parts[v] != parts[nbrs[i]]) cut++;
+    return cut / 2;  // each edge is counted on both sides
+}
+
+static void report(string tag, vector<int> &parts, int num_servers) {
+    uint64_t nedges = offs.back() / 2, cut = edge_cut(parts);
+    vector<uint64_t> loads(num_servers, 0);
+    for (size_t v = 0; v < vids.size(); v++)
+        loads[parts[v]] += offs[v + 1] - offs[v];
+
+    uint64_t max_load = *max_element(loads.begin(), loads.end());
+    cout << tag << ": edge-cut = " << (100.0 * cut / nedges) << "%"
+         << ", replication factor = " << ((double)(nedges + cut) / nedges)
+         << ", imbalance = " << ((double)max_load * num_servers / offs.back()) << endl;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        printf("usage: ./partition input_dir num_servers output_file [num_iterations] [slack]\n");
+        return -1;
+    }
+
+    string dname = argv[1];
+    int num_servers = atoi(argv[2]);
+    string oname = argv[3];
+    int num_iters = (argc > 4) ? atoi(argv[4]) : 10;
+    double slack = (argc > 5) ? atof(argv[5]) : 0.05;  // allowed load imbalance
+    assert(num_servers > 0 && num_servers < 0xFFFF);
+
+    vector<pair<vid_t, vid_t>> edges;
+    load_edges(dname, edges);
+    build_graph(edges);
+    edges.clear();
+    edges.shrink_to_fit();
+    cout << "#vertices = " << vids.size() << ", #edges = " << offs.back() / 2 << endl;
+    if (vids.empty()) return 0;
+
+    // start from hashing, the load of a server is the #edges of its vertices
+    vector<int> parts(vids.size());
+    vector<uint64_t> loads(num_servers, 0);
+    for (size_t v = 0; v < vids.size(); v++) {
+        parts[v] = vids[v] % num_servers;
+        loads[parts[v]] += offs[v + 1] - offs[v];
+    }
+    uint64_t capacity = (1.0 + slack) * offs.back() / num_servers + 1;
+    report("hash", parts, num_servers);
+
+    // balanced label propagation
+    vector<uint64_t> counts(num_servers, 0);
+    for (int it = 0; it < num_iters; it++) {
+        uint64_t moved = 0;
+        for (size_t v = 0; v < vids.size(); v++) {
+            uint64_t deg = offs[v + 1] - offs[v];
+            for (uint64_t i = offs[v]; i < offs[v + 1]; i++)
+                counts[parts[nbrs[i]]]++;
+
+            int cur = parts[v], best = cur;
+            for (int p = 0; p < num_servers; p++) {
+                if (p == cur || counts[p] <= counts[best]) continue;
+                if (loads[p] + deg > capacity) continue;  // keep balance
+                best = p;
+            }
+
+            for (uint64_t i = offs[v]; i < offs[v + 1]; i++)
+                counts[parts[nbrs[i]]] = 0;
+
+            if (best != cur) {
+                loads[cur] -= deg;
+                loads[best] += deg;
+                parts[v] = best;
+                moved++;
+            }
+        }
+        cout << "iteration " << it << ": moved " << moved << " vertices" << endl;
+        if (moved == 0) break;
+    }
+    report("locality", parts, num_servers);
+
+    // only keep the vertices not placed by hashing
+    ofstream ofs(oname.c_str());
+    uint64_t n = 0;
+    for (size_t v = 0; v < vids.size(); v++) {
+        if (parts[v] == (int)(vids[v] % num_servers)) continue;
+        ofs << vids[v] << " " << parts[v] << "\n";
+        n++;
+    }
+    ofs.close();
+    cout << "write " << n << " vertices to " << oname << endl;
+    return 0;
+}
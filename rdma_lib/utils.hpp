@@ -29,6 +29,7 @@
 #include <byteswap.h>
 #include <string.h>
 #include <errno.h>
+#include <assert.h>
 
 // time utilites
 #include <chrono>
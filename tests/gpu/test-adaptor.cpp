@@ -67,7 +67,7 @@ int main(int argc, char *argv[]) {
     // create proxies and engines
     vector<Adaptor *> adaptors;
     for (int tid = 0; tid < Global::num_threads; tid++) {
-        Adaptor *adaptor = new Adaptor(tid, nullptr, rdma_adaptor);
+        Adaptor *adaptor = new Adaptor(sid, tid, nullptr, rdma_adaptor);
         adaptors.push_back(adaptor);
     }
 
@@ -72,6 +72,56 @@ void * recv()
     msg = test_adaptor->recv(thread_id);
 }
 
+// run @num round-trips of msgs with @size bytes, and return the average latency (usec)
+uint64_t eval_latency(int num, int size)
+{
+    send_msg = string(size, 'a');
+
+    uint64_t sum = 0;
+    for (int i = 0; i < num; i++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        uint64_t start = timer::get_usec();
+        if (IS_MASTER(sid)) {
+            send(false);
+            recv();
+        } else {
+            recv();
+            send(true);
+        }
+        uint64_t end = timer::get_usec();
+        sum += (end - start);
+    }
+    return sum / num;
+}
+
+// stream @num msgs with @size bytes from master to slave, which acks the last one,
+// and return the throughput (msgs/sec)
+double eval_thpt(int num, int size)
+{
+    string msg(size, 'a');
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    uint64_t start = timer::get_usec();
+    if (IS_MASTER(sid)) {
+        string ack;
+        for (int i = 0; i < num; i++) {
+            // retry if the queue of socket is full
+            while (!test_adaptor->send(thread_id, slave_sid, thread_id, msg))
+                test_adaptor->tryrecv(thread_id, ack); // flush batched msgs
+        }
+        ack = test_adaptor->recv(thread_id);
+    } else {
+        string str;
+        for (int i = 0; i < num; i++)
+            str = test_adaptor->recv(thread_id);
+        test_adaptor->send(thread_id, master_sid, thread_id, string("ack"));
+        while (!test_adaptor->flush(thread_id)) ;
+    }
+    uint64_t end = timer::get_usec();
+
+    return 1000000.0 * num / (end - start);
+}
+
 // now only support two server to run the test
 int main(int argc, char *argv[])
 {
@@ -79,7 +129,11 @@ int main(int argc, char *argv[])
     network_desc.add_options()
     ("help,h", "help message about network test")
     ("num,n", value<int>()->default_value(100)->value_name("<num>"), "run <num> times")
-    ("size,s", value<int>()->default_value(1000)->value_name("<size>"), "set sending message <size>");
+    ("size,s", value<int>()->default_value(1000)->value_name("<size>"), "set sending message <size>")
+    ("thpt,t", "evaluate the throughput of messages from 64B to 16MB")
+    ("volume,v", value<int>()->default_value(256)->value_name("<MB>"), "send <MB> data for each message size (throughput)")
+    ("batch,b", value<int>()->default_value(1)->value_name("<num>"), "batch at most <num> small messages (throughput)")
+    ("pool,p", value<int>()->default_value(4)->value_name("<num>"), "use <num> sockets to each thread");
 
     variables_map network_vm;
     try {
@@ -100,10 +154,8 @@ int main(int argc, char *argv[])
 
     int num = network_vm["num"].as<int>();
     int size = network_vm["size"].as<int>();
-    // construct the send message
-    for (int i = 0; i < size; i++ ) {
-        send_msg += "a";
-    }
+    Global::tcp_batch_size = network_vm["batch"].as<int>();
+    Global::tcp_pool_size = network_vm["pool"].as<int>();
 
     boost::mpi::environment env(argc, argv);
     boost::mpi::communicator world;
@@ -113,25 +165,26 @@ int main(int argc, char *argv[])
     string host_fname = std::string(argv[1]);
     init_socket(host_fname);
 
-    int sum = 0;
-
-    // begin to elvation the latency
-    for (int i = 0; i < num; i++) {
-        MPI_Barrier(MPI_COMM_WORLD);
-        uint64_t start = timer::get_usec();
-        if (IS_MASTER(sid)) {
-            send(false);
-            recv();
-        } else {
-            recv();
-            send(true);
-        }
-        uint64_t end = timer::get_usec();
-        sum += (end - start);
+    if (!network_vm.count("thpt")) {
+        // begin to elvation the latency
+        uint64_t lat = eval_latency(num, size);
+        if (IS_MASTER(sid))
+            cout << " the average sending time " << lat << endl;
+        return 0;
     }
 
+    // begin to elvation the throughput
+    uint64_t volume = network_vm["volume"].as<int>() * 1024ull * 1024ull;
     if (IS_MASTER(sid))
-        cout << " the average sending time " << sum / num << endl;
+        cout << "size(B)\tmsgs/sec\tMB/sec\tlatency(usec)" << endl;
+    for (int sz = 64; sz <= 16 * 1024 * 1024; sz *= 4) {
+        int cnt = max(16, (int)min(volume / sz, (uint64_t)1000000));
+        double thpt = eval_thpt(cnt, sz);
+        uint64_t lat = eval_latency(min(num, cnt), sz);
+        if (IS_MASTER(sid))
+            cout << sz << "\t" << (uint64_t)thpt << "\t"
+                 << thpt * sz / (1024 * 1024) << "\t" << lat << endl;
+    }
 
     return 0;
 }
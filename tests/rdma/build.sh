@@ -0,0 +1,9 @@
+#!/bin/sh
+
+mkdir -p build;
+cd build;
+
+cmake ../;
+make;
+
+cd ../;
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2016 Shanghai Jiao Tong University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://ipads.se.sjtu.edu.cn/projects/wukong
+ *
+ */
+
+#include <boost/mpi.hpp>
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <vector>
+
+#include "global.hpp"
+#include "config.hpp"
+#include "mem.hpp"
+#include "rdma.hpp"
+
+// comm
+#include "comm/rdma_adaptor.hpp"
+
+// utils
+#include "logger2.hpp"
+#include "timer.hpp"
+#include "unit.hpp"
+
+using namespace std;
+using namespace boost::program_options;
+
+// the reader is thread 0 on server 0, and the rest servers are writers
+#define READER_SID 0
+#define READER_TID 0
+
+int main(int argc, char *argv[])
+{
+    boost::mpi::environment env(argc, argv);
+    boost::mpi::communicator world;
+    int sid = world.rank(); // server ID
+
+    if (argc < 3) {
+        cout << "usage: rdmatest <config_fname> <host_fname> [options]" << endl;
+        return -1;
+    }
+
+    options_description rdma_desc("rdma poll test:");
+    rdma_desc.add_options()
+    ("help,h", "help message about rdma poll test")
+    ("num,n", value<int>()->default_value(100000)->value_name("<num>"), "send <num> msgs per writer")
+    ("size,s", value<int>()->default_value(64)->value_name("<size>"), "set the <size> of msgs")
+    ("polls,p", value<int>()->default_value(1000000)->value_name("<polls>"), "run <polls> idle polls");
+
+    variables_map rdma_vm;
+    try {
+        store(parse_command_line(argc - 2, argv + 2, rdma_desc), rdma_vm);
+    } catch (...) { // something go wrong
+        cout << "Error: error to run" << endl;
+        cout << rdma_desc;
+        return -1;
+    }
+    notify(rdma_vm);
+
+    if (rdma_vm.count("help")) {
+        if (sid == READER_SID)
+            cout << rdma_desc;
+        return -1;
+    }
+
+    int num = rdma_vm["num"].as<int>();
+    int size = rdma_vm["size"].as<int>();
+    int npolls = rdma_vm["polls"].as<int>();
+
+    // load global configs
+    load_config(string(argv[1]), world.size());
+    if (Global::num_servers < 2) {
+        logstream(LOG_ERROR) << "at least 2 servers are required." << LOG_endl;
+        return -1;
+    }
+
+    // set the address file of host/cluster
+    string host_fname = std::string(argv[2]);
+
+    // allocate memory regions
+    vector<RDMA::MemoryRegion> mrs;
+    Mem *mem = new Mem(Global::num_servers, Global::num_threads);
+    RDMA::MemoryRegion mr_cpu = { RDMA::MemType::CPU, mem->address(), mem->size(), mem };
+    mrs.push_back(mr_cpu);
+
+    // init RDMA devices and connections
+    RDMA_init(Global::num_servers, Global::num_threads, sid, mrs, host_fname);
+    RDMA_Adaptor *rdma = new RDMA_Adaptor(sid, mrs, Global::num_servers, Global::num_threads);
+
+    // 1. the cost of polling (empty) ring buffers of all servers
+    if (sid == READER_SID) {
+        string data;
+        uint64_t start = timer::get_usec();
+        for (int i = 0; i < npolls; i++)
+            rdma->tryrecv(READER_TID, data);
+        uint64_t end = timer::get_usec();
+
+        logstream(LOG_INFO) << "idle poll: " << (1000.0 * (end - start) / npolls) << " nsec ("
+                            << Global::num_servers << " servers)" << LOG_endl;
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    // 2. the fairness of reader when all writers are flooding
+    if (sid != READER_SID) {
+        string msg(size, 'a');
+        for (int i = 0; i < num; i++)
+            while (!rdma->send(0, READER_SID, READER_TID, msg)) ;
+    } else {
+        uint64_t total = (uint64_t)num * (Global::num_servers - 1);
+        vector<uint64_t> cnts(Global::num_servers, 0); // #msgs in the first half
+
+        string data;
+        int src_sid;
+        uint64_t start = timer::get_usec();
+        for (uint64_t recv_cnt = 0; recv_cnt < total;) {
+            if (!rdma->tryrecv(READER_TID, data, src_sid))
+                continue;
+            if (recv_cnt < total / 2)
+                cnts[src_sid]++;
+            recv_cnt++;
+            data.clear();
+        }
+        uint64_t end = timer::get_usec();
+
+        // Jain's fairness index of writers (1 means perfectly fair)
+        double sum = 0.0, sqr_sum = 0.0;
+        for (int i = 0; i < Global::num_servers; i++) {
+            if (i == READER_SID) continue;
+            sum += cnts[i];
+            sqr_sum += (double)cnts[i] * cnts[i];
+            logstream(LOG_INFO) << "server " << i << ": " << cnts[i] << " msgs" << LOG_endl;
+        }
+
+        logstream(LOG_INFO) << "throughput: " << (1.0 * total / (end - start)) << "M msgs/sec" << LOG_endl;
+        logstream(LOG_INFO) << "fairness (first half): "
+                            << (sum * sum / ((Global::num_servers - 1) * sqr_sum)) << LOG_endl;
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    return 0;
+}
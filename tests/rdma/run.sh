@@ -0,0 +1,4 @@
+#!/bin/bash
+#e.g. ./run.sh 4 -n 100000 -s 64
+
+${WUKONG_ROOT}/deps/openmpi-1.6.5-install/bin/mpiexec -x CLASSPATH -x LD_LIBRARY_PATH -hostfile mpd.hosts -n $1 ./build/rdmatest config mpd.hosts ${@:2}
@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+
+#include "store/vertex.hpp"
+#include "store/bitmap.hpp"
+
+namespace test {
+
+TEST(Store, Bitmap) {
+  sid_t base = 1 << NBITS_IDX;
+  vector<sid_t> a, b;
+  for (sid_t i = 0; i < 100000; i += 2) a.push_back(base + i);   // dense chunks
+  for (sid_t i = 0; i < 100000; i += 30) b.push_back(base + i);  // sparse chunks
+  b.push_back(base + 30);  // duplicate
+
+  Bitmap ba(a), bb(b);
+  EXPECT_EQ(ba.size(), a.size());
+  EXPECT_EQ(bb.size(), b.size() - 1);
+  EXPECT_EQ(ba.contains(base + 4), true);
+  EXPECT_EQ(ba.contains(base + 5), false);
+  EXPECT_EQ(bb.contains(base + 60), true);
+  EXPECT_EQ(bb.contains(base + 61), false);
+
+  // the multiples of 30
+  Bitmap r = ba.intersect(bb);
+  EXPECT_EQ(r.size(), bb.size());
+  vector<sid_t> ids;
+  r.to_vector(ids);
+  EXPECT_EQ(ids.size(), r.size());
+  EXPECT_EQ(ids[0], base);
+  EXPECT_EQ(ids[1], base + 30);
+
+  vector<sid_t> odd = {base + 1, base + 3};
+  EXPECT_EQ(ba.intersect(Bitmap(odd)).size(), 0u);
+}
+
+}
@@ -0,0 +1,225 @@
+#include <gtest/gtest.h>
+#include <fstream>
+
+#include "global.hpp"
+#include "type.hpp"
+#include "store/vertex.hpp"
+#include "assertion.hpp"
+#include "comm/adaptor.hpp"
+#include "comm/pending.hpp"
+#include "engine/msgr.hpp"
+
+// count the allocations of large buffers to detect the copies of msgs
+static size_t large_allocs = 0;
+
+void *operator new(size_t sz) {
+  if (sz >= KiB2B(64)) large_allocs++;
+  void *p = malloc(sz);
+  if (p == NULL) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+
+namespace test {
+
+// the host file of a single server (over loopback)
+static string local_hosts() {
+  string fname = "/tmp/wukong-test-hosts";
+  ofstream file(fname);
+  file << "127.0.0.1" << endl;
+  return fname;
+}
+
+TEST(Comm, TCPZeroCopy) {
+  bool use_rdma = Global::use_rdma;
+  int num_servers = Global::num_servers, num_threads = Global::num_threads;
+  Global::use_rdma = false;
+  Global::num_servers = 1;
+  Global::num_threads = 2;
+
+  TCP_Adaptor tcp(0, local_hosts(), 19600, 1, 2);
+  Adaptor adaptor(0, 0, &tcp, NULL);
+  PendingMsgs pending(&adaptor);
+
+  // the buffer of msg is handed over to zeromq w/o copy
+  string msg(KiB2B(64), 'x');
+  size_t allocs = large_allocs;
+  ASSERT_TRUE(pending.send(0, 1, std::move(msg)));
+  EXPECT_EQ(large_allocs, allocs);
+  EXPECT_TRUE(msg.capacity() < KiB2B(64));
+
+  msg.assign(KiB2B(64), 'y');
+  allocs = large_allocs;
+  ASSERT_TRUE(pending.try_send(0, 1, std::move(msg)));
+  EXPECT_EQ(large_allocs, allocs);
+  EXPECT_TRUE(msg.capacity() < KiB2B(64));
+
+  EXPECT_TRUE(tcp.recv(1) == string(KiB2B(64), 'x'));
+  EXPECT_TRUE(tcp.recv(1) == string(KiB2B(64), 'y'));
+  EXPECT_EQ(pending.size(), 0u);
+
+  Global::use_rdma = use_rdma;
+  Global::num_servers = num_servers;
+  Global::num_threads = num_threads;
+}
+
+TEST(Comm, TCPBatch) {
+  int batch_size = Global::tcp_batch_size, pool_size = Global::tcp_pool_size;
+  Global::tcp_batch_size = 4;
+  Global::tcp_pool_size = 1;  // all threads share a socket to each destination
+
+  TCP_Adaptor tcp(0, local_hosts(), 19700, 1, 3);
+  string str;
+
+  // the small msgs to thread 0 are batched by thread 1 and 2
+  ASSERT_TRUE(tcp.send(1, 0, 0, string("a")));
+  ASSERT_TRUE(tcp.send(2, 0, 0, string("b")));
+  EXPECT_EQ(tcp.tryrecv(0, str), false);
+
+  // the shared batch is flushed by any thread that has batched msgs
+  EXPECT_EQ(tcp.flush(2), true);
+  ASSERT_TRUE(tcp.tryrecv(0, str));
+  EXPECT_TRUE(str == "a");
+  ASSERT_TRUE(tcp.tryrecv(0, str));
+  EXPECT_TRUE(str == "b");
+
+  // nothing to send by the other one
+  EXPECT_EQ(tcp.flush(1), true);
+  EXPECT_EQ(tcp.tryrecv(0, str), false);
+
+  Global::tcp_batch_size = batch_size;
+  Global::tcp_pool_size = pool_size;
+}
+
+// The RDMA adaptor of a single server with two threads, whose msgs are written
+// to the local ring buffers directly (w/o RDMA device).
+class LocalRDMA {
+private:
+  int num_servers, num_threads, num_proxies, num_engines;
+  int buf_size_mb, rbf_size_mb, memstore_size_gb;
+  bool use_rdma;
+
+public:
+  Mem *mem;
+  RDMA_Adaptor *rdma;
+
+  LocalRDMA()
+    : num_servers(Global::num_servers), num_threads(Global::num_threads),
+      num_proxies(Global::num_proxies), num_engines(Global::num_engines),
+      buf_size_mb(Global::rdma_buf_size_mb), rbf_size_mb(Global::rdma_rbf_size_mb),
+      memstore_size_gb(Global::memstore_size_gb), use_rdma(Global::use_rdma) {
+    Global::num_servers = 1;
+    Global::num_threads = 2;
+    Global::num_proxies = 1;
+    Global::num_engines = 1;
+    Global::rdma_buf_size_mb = 1;
+    Global::rdma_rbf_size_mb = 1;
+    Global::memstore_size_gb = 0;
+    Global::use_rdma = true;
+
+    mem = new Mem(1, 2);
+    vector<RDMA::MemoryRegion> mrs;
+    RDMA::MemoryRegion mr = { RDMA::MemType::CPU, mem->address(), mem->size(), mem };
+    mrs.push_back(mr);
+    rdma = new RDMA_Adaptor(0, mrs, 1, 2);
+  }
+
+  ~LocalRDMA() {
+    delete rdma;
+    delete mem;
+
+    Global::num_servers = num_servers;
+    Global::num_threads = num_threads;
+    Global::num_proxies = num_proxies;
+    Global::num_engines = num_engines;
+    Global::rdma_buf_size_mb = buf_size_mb;
+    Global::rdma_rbf_size_mb = rbf_size_mb;
+    Global::memstore_size_gb = memstore_size_gb;
+    Global::use_rdma = use_rdma;
+  }
+};
+
+TEST(Comm, DoorbellBuffer) {
+  LocalRDMA local;
+  Mem *mem = local.mem;
+
+  // the source of remote doorbells is apart from the RDMA buffers of threads
+  char *bufs = mem->buffer(0), *bufs_end = mem->buffer(0) + mem->buffer_size() * 2;
+  for (int tid = 0; tid < 2; tid++) {
+    char *dbl = mem->doorbell_buffer(tid);
+    EXPECT_TRUE(dbl + sizeof(uint64_t) <= bufs || dbl >= bufs_end);
+    EXPECT_TRUE(dbl + sizeof(uint64_t) <= mem->address() + mem->size());
+    EXPECT_EQ(mem->doorbell_buffer_offset(tid), (uint64_t)(dbl - mem->address()));
+  }
+  EXPECT_TRUE(mem->doorbell_buffer(1) - mem->doorbell_buffer(0) >= (int)sizeof(uint64_t));
+}
+
+TEST(Comm, PendingChunks) {
+  LocalRDMA local;
+  Adaptor adaptor(0, 0, NULL, local.rdma);
+  PendingMsgs pending(&adaptor);
+
+  // a msg larger than the ring buffer is sent in chunks,
+  // and the msg behind the chunks is pending
+  string large(MiB2B(2), 'a');
+  ASSERT_TRUE(pending.send(0, 1, string(large)));
+  EXPECT_EQ(pending.send(0, 1, string("b")), false);
+  EXPECT_EQ(local.rdma->sending(0, 0, 1), true);
+
+  // the pending msg is always retried while the head does not move
+  uint64_t head = local.rdma->ring_head(0, 1);
+  EXPECT_EQ(adaptor.send_stamp(0, 1), 0u);
+  pending.sweep();
+  EXPECT_EQ(local.rdma->ring_head(0, 1), head);
+  EXPECT_EQ(pending.size(), 1u);
+
+  // the rest chunks and the pending msg are sent once the reader moves the head
+  vector<string> msgs;
+  string str;
+  for (int i = 0; i < 1000 && msgs.size() < 2; i++) {
+    if (local.rdma->tryrecv(1, str))
+      msgs.push_back(str);
+    pending.sweep();
+  }
+  ASSERT_TRUE(msgs.size() == 2);
+  EXPECT_TRUE(msgs[0] == large);
+  EXPECT_TRUE(msgs[1] == "b");
+  EXPECT_EQ(pending.size(), 0u);
+  EXPECT_EQ(local.rdma->sending(0, 0, 1), false);
+  EXPECT_EQ(adaptor.send_stamp(0, 1), local.rdma->ring_head(0, 1) + 1);
+}
+
+TEST(Comm, PendingBacklog) {
+  LocalRDMA local;
+  Adaptor adaptor(0, 0, NULL, local.rdma);
+  Messenger msgr(0, 0, &adaptor);
+
+  // the ring buffer (1MB) is full of the msgs (1KB) to thread 1,
+  // and the rest ones are pending until backlogged
+  int nmsgs = 0;
+  while (!msgr.backlogged()) {
+    Bundle bundle(SPARQL_QUERY, string(KiB2B(1), 'a' + nmsgs % 26));
+    msgr.send_msg(bundle, 0, 1);
+    nmsgs++;
+  }
+  EXPECT_TRUE(msgr.pending_size() >= MAX_PENDING_MSGS);
+
+  // the reader moves the remote head lazily (every 1/8 ring buffer),
+  // and the pending msgs are drained in order
+  int cnt = 0;
+  string str;
+  for (int i = 0; i < 100 * nmsgs && cnt < nmsgs; i++) {
+    if (local.rdma->tryrecv(1, str)) {
+      Bundle bundle(str);
+      ASSERT_TRUE(bundle.data == string(KiB2B(1), 'a' + cnt % 26));
+      cnt++;
+    }
+    msgr.sweep_msgs();
+  }
+  EXPECT_EQ(cnt, nmsgs);
+  EXPECT_EQ(msgr.pending_size(), 0u);
+  EXPECT_EQ(msgr.backlogged(), false);
+}
+
+} // namespace test
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include "global.hpp"
+#include "type.hpp"
+#include "store/vertex.hpp"
+#include "assertion.hpp"
+#include "query.hpp"
+#include "feedback.hpp"
+
+namespace test {
+
+TEST(Core, CardFeedback) {
+  Global::plan_feedback_size = 2;
+  Global::plan_replan_factor = 4;
+  CardFeedback feedback;
+  CardFeedback::key_t k1 = {1, OUT, 0, 0}, k2 = {1, IN, 0, 0}, k3 = {2, OUT, 1, 3};
+  double sel;
+
+  // new selectivities change the version
+  EXPECT_EQ(feedback.lookup(k1, sel), false);
+  feedback.observe(1, OUT, 0, 0, 100, 100);
+  feedback.observe(1, OUT, 0, 0, 0, 100);  // no input (ignored)
+  EXPECT_EQ(feedback.version, 1u);
+  EXPECT_EQ(feedback.lookup(k1, sel), true);
+  EXPECT_DOUBLE_EQ(sel, 1.0);
+
+  // old observations are decayed, and the version is changed only if
+  // the selectivity is changed by plan_replan_factor
+  feedback.observe(1, OUT, 0, 0, 10, 100);  // (80 + 100) / (80 + 10)
+  EXPECT_EQ(feedback.version, 1u);
+  EXPECT_EQ(feedback.lookup(k1, sel), true);
+  EXPECT_DOUBLE_EQ(sel, 2.0);
+  feedback.observe(1, OUT, 0, 0, 10, 1000); // (144 + 1000) / (72 + 10)
+  EXPECT_EQ(feedback.version, 2u);
+  EXPECT_EQ(feedback.lookup(k1, sel), true);
+  EXPECT_DOUBLE_EQ(sel, 1144.0 / 82);
+  EXPECT_EQ(feedback.lookups, 4u);
+  EXPECT_EQ(feedback.hits, 3u);
+
+  // the plan is changed only by the selectivities it used
+  CardFeedback::snapshot_t used;
+  used[k1] = sel;
+  EXPECT_EQ(feedback.changed(used), false);
+  feedback.observe(2, OUT, 1, 3, 10, 10);
+  EXPECT_EQ(feedback.version, 3u);
+  EXPECT_EQ(feedback.changed(used), false);
+  used[k2] = -1;
+  feedback.observe(1, IN, 0, 0, 10, 10);  // evicts k1 (least recently observed)
+  EXPECT_EQ(feedback.version, 4u);
+  EXPECT_EQ(feedback.size(), 2u);
+  EXPECT_EQ(feedback.lookup(k1, sel), false);
+  EXPECT_EQ(feedback.lookup(k3, sel), true);
+  EXPECT_EQ(feedback.changed(used), true);
+
+  Global::plan_feedback_size = 4096;
+}
+
+TEST(Core, Cardinality) {
+  typedef SPARQLQuery::Cardinality Card;
+  SPARQLQuery::Pattern p0(1 << 17, 2, OUT, -1), p1(-1, 3, IN, -2), p2(-1, 4, OUT, -3);
+
+  // the steps of sub-queries are summed up
+  Card parent, sub1, sub2;
+  sub1.record(0, Card::FROM_CONST, p0, 1, 10);
+  sub1.record(1, Card::TO_UNKNOWN, p1, 10, 20);
+  sub2.record(1, Card::TO_UNKNOWN, p1, 5, 15);
+  parent.merge(sub1);
+  parent.merge(sub2);
+  ASSERT_TRUE(parent.steps.size() == 2u);
+  EXPECT_EQ(parent.steps[0].rows_in, 1u);
+  EXPECT_EQ(parent.steps[0].rows_out, 10u);
+  EXPECT_EQ(parent.steps[1].bind, Card::TO_UNKNOWN);
+  EXPECT_EQ(parent.steps[1].rows_in, 15u);
+  EXPECT_EQ(parent.steps[1].rows_out, 35u);
+
+  // the step is dropped if the participants recorded different patterns
+  Card sub3, sub4;
+  sub3.record(1, Card::TO_UNKNOWN, p2, 5, 5);
+  parent.merge(sub3);
+  EXPECT_EQ(parent.steps[1].bind, Card::CONFLICT);
+  sub4.record(1, Card::TO_UNKNOWN, p1, 5, 5);
+  parent.merge(sub4);
+  EXPECT_EQ(parent.steps[1].bind, Card::CONFLICT);
+  EXPECT_EQ(parent.steps[0].bind, Card::FROM_CONST);
+}
+
+}
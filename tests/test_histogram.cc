@@ -0,0 +1,57 @@
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+
+#include "histogram.hpp"
+
+namespace test {
+
+TEST(Utils, Histogram) {
+    Histogram h;
+    std::vector<uint64_t> vals;
+    for (uint64_t i = 0; i < 100000; i++) {
+        uint64_t v = (i * 2654435761ull) % 1000000;
+        vals.push_back(v);
+        h.record(v);
+    }
+    std::sort(vals.begin(), vals.end());
+
+    EXPECT_EQ(h.count(), vals.size());
+    EXPECT_EQ(h.min(), vals.front());
+    EXPECT_EQ(h.max(), vals.back());
+    for (double rate : {0.01, 0.5, 0.9, 0.99, 0.999, 1.0}) {
+        uint64_t exact = vals[std::min(vals.size() - 1, (size_t)(vals.size() * rate))];
+        uint64_t p = h.percentile(rate);
+        ASSERT_TRUE(p >= exact && p <= exact + exact / 128 + 1);
+    }
+
+    // small values are exact
+    Histogram s;
+    for (uint64_t v = 0; v < 200; v++) s.record(v);
+    EXPECT_EQ(s.percentile(0.5), 100u);
+
+    // merge and serialization
+    Histogram m;
+    std::stringstream ss;
+    {
+        boost::archive::binary_oarchive oa(ss);
+        oa << s;
+    }
+    {
+        boost::archive::binary_iarchive ia(ss);
+        ia >> m;
+    }
+    m.merge(s);
+    EXPECT_EQ(m.count(), 400u);
+    EXPECT_EQ(m.percentile(0.5), 100u);
+    EXPECT_EQ(m.max(), 199u);
+
+    m.reset();
+    EXPECT_EQ(m.count(), 0u);
+    EXPECT_EQ(m.percentile(0.99), 0u);
+}
+
+}
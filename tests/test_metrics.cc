@@ -0,0 +1,33 @@
+#include <gtest/gtest.h>
+
+#include "metrics.hpp"
+
+namespace test {
+
+TEST(Core, Metrics) {
+  Metrics &metrics = Metrics::get_metrics();
+  uint64_t bytes = metrics.get_counter(ADAPTOR_BYTES_SENT);  // by other tests
+  metrics.inc(0, ENGINE_QUERIES);
+  metrics.inc(1, ENGINE_QUERIES, 2);
+  metrics.inc(1, ADAPTOR_BYTES_SENT, 100);
+  metrics.inc(1 << 20, ENGINE_QUERIES);  // out of range (ignored)
+  EXPECT_EQ(metrics.get_counter(ENGINE_QUERIES), 3u);
+  EXPECT_EQ(metrics.get_counter(ADAPTOR_BYTES_SENT), bytes + 100);
+
+  metrics.record_exec(0, 10);
+  metrics.record_exec(1, 30);
+  EXPECT_EQ(metrics.get_exec_latency().count(), 2u);
+
+  // collectors of the same name are summed up
+  metrics.add_collector("test_depth", "A test gauge.", false, []() { return 2.0; });
+  metrics.add_collector("test_depth", "A test gauge.", false, []() { return 3.0; });
+
+  string text = metrics.export_text(7);
+  EXPECT_NE(text.find("wukong_engine_queries_total{sid=\"7\"} 3\n"), string::npos);
+  EXPECT_NE(text.find("test_depth{sid=\"7\"} 5\n"), string::npos);
+  EXPECT_NE(text.find("# TYPE test_depth gauge\n"), string::npos);
+  EXPECT_NE(text.find("wukong_engine_exec_usec_count{sid=\"7\"} 2\n"), string::npos);
+  EXPECT_EQ(metrics.export_text(7, false).find("# HELP"), string::npos);
+}
+
+}
@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+
+#include "store/packed.hpp"
+
+namespace test {
+
+TEST(Store, PackedList) {
+  // sorted IDs w/ various gaps across several blocks
+  vector<sid_t> ids;
+  sid_t id = 1 << NBITS_IDX;
+  for (int i = 0; i < 1000; i++) {
+    id += (i % 3 == 0) ? 1 : (i * 37 % 5000) + 1;
+    ids.push_back(id);
+  }
+  PackedList list(ids);
+  EXPECT_EQ(list.size(), ids.size());
+  EXPECT_LT(list.bytes(), ids.size() * sizeof(edge_t));
+
+  vector<edge_t> out(ids.size());
+  list.decode(0, ids.size(), out.data());
+  for (size_t i = 0; i < ids.size(); i++)
+    EXPECT_EQ(out[i].val, ids[i]);
+
+  // decode a slice across blocks
+  list.decode(100, 300, out.data());
+  EXPECT_EQ(out[0].val, ids[100]);
+  EXPECT_EQ(out[199].val, ids[299]);
+
+  // membership
+  EXPECT_EQ(list.find(ids[777]), 777);
+  EXPECT_EQ(list.find(ids[0] - 1), -1);
+  EXPECT_EQ(list.contains(ids[999] + 1), false);
+  EXPECT_EQ(list.contains(ids[3] + 1), false);
+
+  // read w/o decoding the whole list
+  PackedList::Reader reader(&list);
+  for (size_t i = 250; i < ids.size(); i++)
+    EXPECT_EQ(reader[i], ids[i]);
+  EXPECT_EQ(reader[5], ids[5]);
+}
+
+}
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include "store/replica.hpp"
+
+namespace test {
+
+TEST(Store, Replica) {
+  ReplicaStore replicas;
+  sid_t hub = 1 << NBITS_IDX;
+  ikey_t key(hub, 2, OUT);
+  uint64_t sz = 0;
+
+  // not replicated
+  EXPECT_EQ(replicas.is_hot(hub), false);
+  EXPECT_TRUE(replicas.get_edges(key, sz) == NULL);
+
+  // invisible until commit
+  replicas.add_hot_vertex(hub);
+  replicas.insert(key, 100);
+  replicas.insert(key, 101);
+  EXPECT_TRUE(replicas.get_edges(key, sz) == NULL);
+  replicas.commit();
+
+  edge_t *edges = replicas.get_edges(key, sz);
+  ASSERT_TRUE(edges != NULL);
+  EXPECT_EQ(sz, 2u);
+  EXPECT_EQ(edges[1].val, 101u);
+
+  // append w/ deduplication
+  replicas.insert(key, 101);
+  replicas.insert(key, 102);
+  replicas.commit(true);
+  edge_t *old = edges;
+  edges = replicas.get_edges(key, sz);
+  EXPECT_EQ(sz, 3u);
+  EXPECT_EQ(edges[2].val, 102u);
+
+  // the stale lists are still readable until all engines are quiescent
+  replicas.insert(key, 103);
+  replicas.commit();
+  EXPECT_EQ(old[1].val, 101u);
+  EXPECT_EQ(edges[2].val, 102u);
+  EXPECT_EQ(replicas.get_num_retired(), 2u);
+
+  // reclaimed by the next commit after the engine (tid 1) passes its quiescent point
+  replicas.quiesce(1);
+  replicas.insert(key, 104);
+  replicas.commit();
+  EXPECT_EQ(replicas.get_num_retired(), 1u);
+  edges = replicas.get_edges(key, sz);
+  EXPECT_EQ(sz, 5u);
+  EXPECT_EQ(edges[4].val, 104u);
+  EXPECT_EQ(replicas.get_edges(ikey_t(hub, 3, OUT), sz) == NULL, true);
+}
+
+}
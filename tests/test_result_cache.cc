@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include "result_cache.hpp"
+
+namespace test {
+
+static SPARQLQuery make_query(ssid_t s, ssid_t p) {
+  SPARQLQuery r;
+  r.pattern_group.patterns.push_back(SPARQLQuery::Pattern(s, p, OUT, -1));
+  r.result.nvars = 1;
+  r.result.required_vars.push_back(-1);
+  return r;
+}
+
+static SPARQLQuery::Result make_result(int nrows, bool blind) {
+  SPARQLQuery::Result res;
+  res.blind = blind;
+  res.set_col_num(1);
+  res.row_num = nrows;
+  if (!blind) res.result_table.assign(nrows, 1 << 17);
+  return res;
+}
+
+TEST(Store, ResultCache) {
+  Global::result_cache_size_mb = 1;
+  ResultCache cache;
+
+  SPARQLQuery q1 = make_query(1 << 17, 10);
+  SPARQLQuery q2 = make_query(1 << 18, 11);
+  ResultCache::ticket_t t1 = cache.make_ticket(q1);
+  ResultCache::ticket_t t2 = cache.make_ticket(q2);
+  EXPECT_NE(t1.key, t2.key);
+  EXPECT_EQ(t1.key, cache.make_ticket(q1).key);
+
+  // test lookup, not found case
+  SPARQLQuery::Result res;
+  EXPECT_EQ(cache.lookup(t1, true, res), false);
+
+  // test insert, a blind entry only serves blind queries
+  cache.insert(t1, make_result(10, true));
+  EXPECT_EQ(cache.lookup(t1, true, res), true);
+  EXPECT_EQ(res.row_num, 10);
+  EXPECT_EQ(cache.lookup(t1, false, res), false);
+
+  cache.insert(t1, make_result(10, false));
+  EXPECT_EQ(cache.lookup(t1, false, res), true);
+  EXPECT_EQ(res.result_table.size(), 10);
+
+  // test invalidate, only the entry reading the predicate is dropped
+  cache.insert(t2, make_result(5, false));
+  boost::unordered_set<ssid_t> preds = {10};
+  EXPECT_EQ(cache.invalidate(preds), 1);
+  EXPECT_EQ(cache.lookup(t1, true, res), false);
+  EXPECT_EQ(cache.lookup(t2, true, res), true);
+
+  // test insert, the result of a query issued before invalidation is rejected
+  cache.insert(t1, make_result(10, false));
+  EXPECT_EQ(cache.lookup(t1, true, res), false);
+
+  // test LRU eviction
+  cache.clear();
+  t1 = cache.make_ticket(q1);
+  t2 = cache.make_ticket(q2);
+  int nrows = MiB2B(1) / sizeof(sid_t) * 2 / 3;
+  cache.insert(t1, make_result(nrows, false));
+  cache.insert(t2, make_result(nrows, false));
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_EQ(cache.lookup(t1, true, res), false);
+  EXPECT_EQ(cache.lookup(t2, true, res), true);
+  EXPECT_LE(cache.mem_size(), MiB2B(1));
+
+  Global::result_cache_size_mb = 0;
+}
+
+}
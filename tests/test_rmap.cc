@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include "global.hpp"
+#include "type.hpp"
+#include "store/vertex.hpp"
+#include "assertion.hpp"
+#include "query.hpp"
+#include "engine/rmap.hpp"
+
+namespace test {
+
+static SPARQLQuery make_parent(int qid, int root_pqid) {
+  SPARQLQuery r;
+  r.qid = qid;
+  r.root_pqid = root_pqid;
+  r.limit = 1;  // LIMIT pushdown
+  return r;
+}
+
+static SPARQLQuery make_reply(int pqid, int root_pqid) {
+  SPARQLQuery r;
+  r.pqid = pqid;
+  r.root_pqid = root_pqid;
+  r.result.col_num = 1;
+  r.result.result_table.push_back(1 << NBITS_IDX);
+  r.result.update_nrows();
+  return r;
+}
+
+TEST(Engine, RMap) {
+  RMap rmap;
+
+  // the parents (of two root queries) finish early by LIMIT
+  for (int root = 1; root <= 2; root++) {
+    SPARQLQuery parent = make_parent(10 * root, root);
+    rmap.put_parent_request(parent, 3);
+
+    SPARQLQuery reply = make_reply(10 * root, root);
+    EXPECT_EQ(rmap.put_reply(reply), true);
+    EXPECT_EQ(rmap.is_ready(10 * root), true);
+    EXPECT_EQ(rmap.get_outstanding(10 * root), 2);
+    EXPECT_EQ(rmap.get_reply(10 * root).result.get_row_num(), 1);
+  }
+  EXPECT_EQ(rmap.get_orphans(), 2u);
+
+  // late replies are dropped
+  SPARQLQuery late = make_reply(10, 1);
+  EXPECT_EQ(rmap.put_reply(late), false);
+  EXPECT_EQ(rmap.get_orphans(), 2u);
+
+  // the root query is cancelled, and its sub-queries never reply
+  SPARQLQuery pending = make_parent(11, 1);
+  rmap.put_parent_request(pending, 2);
+  EXPECT_EQ(rmap.purge(1), 1);
+  EXPECT_EQ(rmap.get_orphans(), 1u);
+
+  // the other root query is not affected
+  late = make_reply(20, 2);
+  EXPECT_EQ(rmap.put_reply(late), false);
+  late = make_reply(20, 2);
+  EXPECT_EQ(rmap.put_reply(late), false);
+  EXPECT_EQ(rmap.get_orphans(), 0u);
+}
+
+}
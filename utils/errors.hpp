@@ -39,11 +39,12 @@ enum {
     SETTING_ERROR,
     FIRST_PATTERN_ERROR,
     UNKNOWN_FILTER,
+    QUERY_TIMEOUT,
     ERROR_LAST
 };
 
 // error_messages
-const char *err_msgs[ERROR_LAST] = {
+static const char *err_msgs[ERROR_LAST] = {
     "Everythong is ok",
     "Something wrong happened",
     "Something wrong in the query syntax, fail to parse!",
@@ -56,7 +57,8 @@ const char *err_msgs[ERROR_LAST] = {
     "Tripple pattern should not start from unknown subject.",
     "You may change SETTING files to avoid this error. (e.g. global.hpp/config/...)",
     "Const_X_X or index_X_X must be the first pattern.",
-    "Unsupported filter type."};
+    "Unsupported filter type.",
+    "Query is cancelled since it exceeds the deadline."};
 
 // An exception
 struct WukongException : public exception {
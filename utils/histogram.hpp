@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2016 Shanghai Jiao Tong University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://ipads.se.sjtu.edu.cn/projects/wukong
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/utility.hpp>
+#include <boost/serialization/split_member.hpp>
+
+/**
+ * A constant-memory histogram of latencies in the style of HdrHistogram.
+ *
+ * Values are counted in log-linear buckets: values below 2^SUB_BITS are exact,
+ * and larger values are bucketed by their top SUB_BITS bits, so the relative
+ * error of any reported percentile is below 1 / 2^(SUB_BITS - 1) (< 0.8%).
+ * Values above MAX_VALUE (about 12 days in usec) are clamped.
+ *
+ * Histograms are merged by adding counts, and only non-empty buckets
+ * are serialized.
+ */
+class Histogram {
+private:
+    static const int SUB_BITS = 8;
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int HALF_COUNT = SUB_COUNT / 2;
+    static const int MAX_BITS = 40;
+    static const uint64_t MAX_VALUE = (1ull << MAX_BITS) - 1;
+    static const int NBUCKETS = SUB_COUNT + (MAX_BITS - SUB_BITS) * HALF_COUNT;
+
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t min_val = UINT64_MAX;
+    uint64_t max_val = 0;
+
+    static int index_of(uint64_t v) {
+        if (v < SUB_COUNT) return (int)v;
+        int e = (63 - __builtin_clzll(v)) - (SUB_BITS - 1);  // (v >> e) in [HALF, SUB)
+        return SUB_COUNT + (e - 1) * HALF_COUNT + (int)((v >> e) - HALF_COUNT);
+    }
+
+    // the highest value counted in the bucket
+    static uint64_t value_of(int idx) {
+        if (idx < SUB_COUNT) return idx;
+        int e = (idx - SUB_COUNT) / HALF_COUNT + 1;
+        uint64_t m = (idx - SUB_COUNT) % HALF_COUNT + HALF_COUNT;
+        return ((m + 1) << e) - 1;
+    }
+
+    friend class boost::serialization::access;
+
+    template <typename Archive>
+    void save(Archive &ar, const unsigned int version) const {
+        std::vector<std::pair<int, uint64_t>> buckets;
+        for (int i = 0; i < (int)counts.size(); i++)
+            if (counts[i] > 0) buckets.push_back(std::make_pair(i, counts[i]));
+        ar << buckets;
+        ar << total;
+        ar << sum;
+        ar << min_val;
+        ar << max_val;
+    }
+
+    template <typename Archive>
+    void load(Archive &ar, const unsigned int version) {
+        std::vector<std::pair<int, uint64_t>> buckets;
+        ar >> buckets;
+        counts.assign(NBUCKETS, 0);
+        for (auto const &b : buckets) counts[b.first] = b.second;
+        ar >> total;
+        ar >> sum;
+        ar >> min_val;
+        ar >> max_val;
+    }
+
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+public:
+    Histogram() : counts(NBUCKETS, 0) { }
+
+    void record(uint64_t v) {
+        v = std::min(v, (uint64_t)MAX_VALUE);
+        counts[index_of(v)]++;
+        total++;
+        sum += v;
+        min_val = std::min(min_val, v);
+        max_val = std::max(max_val, v);
+    }
+
+    void merge(const Histogram &other) {
+        for (int i = 0; i < NBUCKETS; i++)
+            counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        min_val = std::min(min_val, other.min_val);
+        max_val = std::max(max_val, other.max_val);
+    }
+
+    void reset() {
+        std::fill(counts.begin(), counts.end(), 0);
+        total = sum = max_val = 0;
+        min_val = UINT64_MAX;
+    }
+
+    uint64_t count() const { return total; }
+
+    uint64_t get_sum() const { return sum; }
+
+    uint64_t min() const { return total ? min_val : 0; }
+
+    uint64_t max() const { return max_val; }
+
+    double mean() const { return total ? (double)sum / total : 0.0; }
+
+    // the value at the given rate (e.g., 0.99 for p99), same as the
+    // (total * rate)-th value (0-based) of all sorted values
+    uint64_t percentile(double rate) const {
+        if (total == 0) return 0;
+
+        uint64_t rank = std::min(total, (uint64_t)(total * rate) + 1);
+        uint64_t acc = 0;
+        for (int i = 0; i < NBUCKETS; i++) {
+            acc += counts[i];
+            if (acc >= rank)
+                return std::max(min_val, std::min(value_of(i), max_val));
+        }
+        return max_val;
+    }
+};
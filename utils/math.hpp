@@ -188,7 +188,7 @@ class tuple {
 public:
     bool static binary_search_tuple(int N, std::vector<sid_t> &vec,
                                     std::vector<sid_t> &target) {
-        binary_search_tuple_recursive(N, vec, target, 0, vec.size() / N);
+        return binary_search_tuple_recursive(N, vec, target, 0, vec.size() / N);
     }
 
     void static qsort_tuple(int N, std::vector<sid_t>& vec) {
@@ -40,6 +40,12 @@ public:
         return ((tp.tv_sec * 1000 * 1000) + (tp.tv_nsec / 1000));
     }
 
+    static uint64_t get_nsec() {
+        struct timespec tp;
+        clock_gettime(CLOCK_MONOTONIC, &tp);
+        return ((tp.tv_sec * 1000 * 1000 * 1000) + tp.tv_nsec);
+    }
+
     /* use select to delay the thread
        beacause sleep or usleep is no accurate */
     static void cpu_relax(const long usec, const long sec = 0) {